@@ -13,6 +13,7 @@
 #include <crag/Crag.h>
 #include <crag/CragStackCombiner.h>
 #include <crag/DownSampler.h>
+#include <crag/Parallel.h>
 #include <crag/PlanarAdjacencyAnnotator.h>
 #include <features/FeatureWeights.h>
 #include <io/CragImport.h>
@@ -35,7 +36,8 @@ util::ProgramOption optionSupervoxels(
 
 util::ProgramOption optionMergeHistory(
 		util::_long_name        = "mergeHistory",
-		util::_description_text = "A file containing lines 'a b c' to indicate that regions a and b merged into region c.");
+		util::_description_text = "A file containing lines 'a b c' to indicate that regions a and b merged into region c, or a "
+		                          "binary merge history written by merge_tree with option binaryMergeHistory.");
 
 util::ProgramOption optionCandidateSegmentation(
 		util::_long_name        = "candidateSegmentation",
@@ -151,6 +153,58 @@ collectLeafNodes(const Crag& crag, Crag::Node n) {
 	return leafNodes;
 }
 
+/**
+ * Read numSections CRAGs with readSection(i, crag, volumes), downsample them if
+ * requested, and combine them into crag and volumes. The sections are read and
+ * downsampled in parallel, the combined CRAG does not depend on the number of
+ * threads. Returns true if the sections have been downsampled.
+ */
+template <typename ReadSection>
+bool
+readSections(
+		std::size_t  numSections,
+		ReadSection  readSection,
+		Crag&        crag,
+		CragVolumes& volumes) {
+
+	std::vector<std::unique_ptr<Crag>> crags(numSections);
+	std::vector<std::unique_ptr<CragVolumes>> cragsVolumes(numSections);
+
+	{
+		UTIL_TIME_SCOPE("read CRAG sections");
+
+		parallelFor(numSections, [&](std::size_t i) {
+
+			std::unique_ptr<Crag> sectionCrag(new Crag());
+			std::unique_ptr<CragVolumes> sectionVolumes(new CragVolumes(*sectionCrag));
+
+			readSection(i, *sectionCrag, *sectionVolumes);
+
+			if (optionDownsampleCrag) {
+
+				std::unique_ptr<Crag> downSampledCrag(new Crag());
+				std::unique_ptr<CragVolumes> downSampledVolumes(new CragVolumes(*downSampledCrag));
+
+				DownSampler downSampler(optionMinCandidateSize.as<int>());
+				downSampler.process(*sectionCrag, *sectionVolumes, *downSampledCrag, *downSampledVolumes);
+
+				// replace the volumes first, they refer to their CRAG
+				sectionVolumes = std::move(downSampledVolumes);
+				sectionCrag    = std::move(downSampledCrag);
+			}
+
+			crags[i]        = std::move(sectionCrag);
+			cragsVolumes[i] = std::move(sectionVolumes);
+		});
+	}
+
+	// combine crags
+	CragStackCombiner combiner;
+	combiner.combine(crags, cragsVolumes, crag, volumes);
+
+	return optionDownsampleCrag.as<bool>();
+}
+
 int main(int argc, char** argv) {
 
 	UTIL_TIME_SCOPE("main");
@@ -188,51 +242,18 @@ int main(int argc, char** argv) {
 
 				std::vector<std::string> files = getImageFiles(mergeTreePath);
 
-				// process one image after another
-				std::vector<std::unique_ptr<Crag>> crags(files.size());
-				std::vector<std::unique_ptr<CragVolumes>> cragsVolumes;
-				for (auto& c : crags) {
-					c = std::unique_ptr<Crag>(new Crag);
-					cragsVolumes.push_back(std::unique_ptr<CragVolumes>(new CragVolumes(*c)));
-				}
-
-				int i = 0;
-				for (std::string file : files) {
-					
-					LOG_USER(logger::out) << "reading crag from " << file << std::endl;
+				LOG_USER(logger::out) << "reading " << files.size() << " crags from " << mergeTreePath << std::endl;
 
-					import.readCrag(file, *crags[i], *cragsVolumes[i], resolution, offset + util::point<float, 3>(0, 0, resolution.z()*i));
-					i++;
-				}
-
-				if (optionDownsampleCrag) {
-
-					UTIL_TIME_SCOPE("downsample CRAG");
-
-					DownSampler downSampler(optionMinCandidateSize.as<int>());
-
-					std::vector<std::unique_ptr<Crag>> downSampledCrags(crags.size());
-					std::vector<std::unique_ptr<CragVolumes>> downSampledVolumes(crags.size());
-
-					for (int i = 0; i < crags.size(); i++) {
-
-						downSampledCrags[i]   = std::unique_ptr<Crag>(new Crag());
-						downSampledVolumes[i] = std::unique_ptr<CragVolumes>(new CragVolumes(*downSampledCrags[i]));
-
-						downSampler.process(*crags[i], *cragsVolumes[i], *downSampledCrags[i], *downSampledVolumes[i]);
-					}
-
-					std::swap(cragsVolumes, downSampledVolumes);
-					std::swap(crags, downSampledCrags);
-
-					// prevent another downsampling on the candidates added by 
-					// the combiner
-					alreadyDownsampled = true;
-				}
+				// read and downsample the sections in parallel, prevent another
+				// downsampling on the candidates added by the combiner
+				alreadyDownsampled = readSections(
+						files.size(),
+						[&](std::size_t i, Crag& sectionCrag, CragVolumes& sectionVolumes) {
 
-				// combine crags
-				CragStackCombiner combiner;
-				combiner.combine(crags, cragsVolumes, *crag, *volumes);
+							import.readCrag(files[i], sectionCrag, sectionVolumes, resolution, offset + util::point<float, 3>(0, 0, resolution.z()*i));
+						},
+						*crag,
+						*volumes);
 
 			} else {
 
@@ -254,7 +275,8 @@ int main(int argc, char** argv) {
 					for (boost::filesystem::directory_iterator i(mergeHistoryPath); i != boost::filesystem::directory_iterator(); i++)
 						if (!boost::filesystem::is_directory(*i) && (
 							i->path().extension() == ".txt" ||
-							i->path().extension() == ".dat"
+							i->path().extension() == ".dat" ||
+							i->path().extension() == ".bin"
 						))
 							mhFiles.push_back(i->path().native());
 					std::sort(mhFiles.begin(), mhFiles.end());
@@ -262,50 +284,20 @@ int main(int argc, char** argv) {
 					// get all supervoxel files
 					std::vector<std::string> svFiles = getImageFiles(optionSupervoxels);
 
-					// process one image after another
-					std::vector<std::unique_ptr<Crag>> crags(mhFiles.size());
-					std::vector<std::unique_ptr<CragVolumes>> cragsVolumes;
-					for (auto& c : crags) {
-						c = std::unique_ptr<Crag>(new Crag);
-						cragsVolumes.push_back(std::unique_ptr<CragVolumes>(new CragVolumes(*c)));
-					}
-
-					for (int i = 0; i < mhFiles.size(); i++) {
-						
-						LOG_USER(logger::out) << "reading crag from supervoxel file " << svFiles[i] << " and merge history " << mhFiles[i] << std::endl;
-
-						Costs mergeCosts(*crags[i]);
-						import.readCragFromMergeHistory(svFiles[i], mhFiles[i], *crags[i], *cragsVolumes[i], resolution, offset + util::point<float, 3>(0, 0, resolution.z()*i), mergeCosts);
-					}
-
-					if (optionDownsampleCrag) {
-
-						UTIL_TIME_SCOPE("downsample CRAG");
-
-						DownSampler downSampler(optionMinCandidateSize.as<int>());
-
-						std::vector<std::unique_ptr<Crag>> downSampledCrags(crags.size());
-						std::vector<std::unique_ptr<CragVolumes>> downSampledVolumes(crags.size());
-
-						for (int i = 0; i < crags.size(); i++) {
-
-							downSampledCrags[i]   = std::unique_ptr<Crag>(new Crag());
-							downSampledVolumes[i] = std::unique_ptr<CragVolumes>(new CragVolumes(*downSampledCrags[i]));
-
-							downSampler.process(*crags[i], *cragsVolumes[i], *downSampledCrags[i], *downSampledVolumes[i]);
-						}
-
-						std::swap(cragsVolumes, downSampledVolumes);
-						std::swap(crags, downSampledCrags);
+					LOG_USER(logger::out) << "reading " << mhFiles.size() << " crags from supervoxels " << optionSupervoxels.as<std::string>() << " and merge histories " << mergeHistoryPath << std::endl;
 
-						// prevent another downsampling on the candidates added by 
-						// the combiner
-						alreadyDownsampled = true;
-					}
+					// read and downsample the sections in parallel, prevent
+					// another downsampling on the candidates added by the
+					// combiner
+					alreadyDownsampled = readSections(
+							mhFiles.size(),
+							[&](std::size_t i, Crag& sectionCrag, CragVolumes& sectionVolumes) {
 
-					// combine crags
-					CragStackCombiner combiner;
-					combiner.combine(crags, cragsVolumes, *crag, *volumes);
+								Costs mergeCosts(sectionCrag);
+								import.readCragFromMergeHistory(svFiles[i], mhFiles[i], sectionCrag, sectionVolumes, resolution, offset + util::point<float, 3>(0, 0, resolution.z()*i), mergeCosts);
+							},
+							*crag,
+							*volumes);
 
 				} else {
 
@@ -13,7 +13,7 @@
 #include <util/helpers.hpp>
 #include <util/timing.h>
 #include <util/assert.h>
-#include <io/Hdf5CragStore.h>
+#include <io/CragStoreFactory.h>
 #include <io/Hdf5VolumeStore.h>
 #include <io/SolutionImageWriter.h>
 #include <features/FeatureExtractor.h>
@@ -65,7 +65,7 @@ util::ProgramOption optionDryRun(
 		util::_long_name        = "dryRun",
 		util::_description_text = "Compute the costs and store them, but do not run the solver.");
 
-inline double dot(const std::vector<double>& a, const std::vector<double>& b) {
+inline double dot(const std::vector<double>& a, const FeatureRow& b) {
 
 	UTIL_ASSERT_REL(a.size(), ==, b.size());
 
@@ -101,19 +101,19 @@ int main(int argc, char** argv) {
 
 		LOG_USER(logger::out) << "reading CRAG and volumes" << std::endl;
 
-		Hdf5CragStore cragStore(optionProjectFile.as<std::string>());
-		cragStore.retrieveCrag(crag);
-		cragStore.retrieveVolumes(volumes);
+		std::unique_ptr<CragStore> cragStore(CragStoreFactory::createCragStore(optionProjectFile.as<std::string>()));
+		cragStore->retrieveCrag(crag);
+		cragStore->retrieveVolumes(volumes);
 
 		LOG_USER(logger::out) << "reading features" << std::endl;
 
-		cragStore.retrieveNodeFeatures(crag, nodeFeatures);
-		cragStore.retrieveEdgeFeatures(crag, edgeFeatures);
+		cragStore->retrieveNodeFeatures(crag, nodeFeatures);
+		cragStore->retrieveEdgeFeatures(crag, edgeFeatures);
 
 		LOG_USER(logger::out) << "computing costs" << std::endl;
 
 		FeatureWeights weights;
-		cragStore.retrieveFeatureWeights(weights);
+		cragStore->retrieveFeatureWeights(weights);
 
 		Costs costs(crag);
 
@@ -156,7 +156,7 @@ int main(int argc, char** argv) {
 		}
 
 		if (!optionReadOnly)
-			cragStore.saveCosts(crag, costs, "costs");
+			cragStore->saveCosts(crag, costs, "costs");
 
 		if (optionDryRun)
 			return 0;
@@ -180,7 +180,7 @@ int main(int argc, char** argv) {
 		LOG_USER(logger::out) << "storing solution" << std::endl;
 
 		if (!optionReadOnly)
-			cragStore.saveSolution(crag, solution, "solution");
+			cragStore->saveSolution(crag, solution, "solution");
 
 		if (optionExportSolution) {
 
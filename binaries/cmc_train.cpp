@@ -12,7 +12,7 @@
 #include <util/exceptions.h>
 #include <util/timing.h>
 #include <io/CragImport.h>
-#include <io/Hdf5CragStore.h>
+#include <io/CragStoreFactory.h>
 #include <io/Hdf5VolumeStore.h>
 #include <io/vectors.h>
 #include <io/SolutionImageWriter.h>
@@ -134,7 +134,7 @@ int main(int argc, char** argv) {
 		util::ProgramOptions::init(argc, argv);
 		logger::LogManager::init();
 
-		std::shared_ptr<CragStore> cragStore = std::make_shared<Hdf5CragStore>(optionProjectFile.as<std::string>());
+		std::shared_ptr<CragStore> cragStore(CragStoreFactory::createCragStore(optionProjectFile.as<std::string>()));
 		Hdf5VolumeStore volumeStore(optionProjectFile.as<std::string>());
 
 		LOG_USER(logger::out) << "reading ground-truth" << std::endl;
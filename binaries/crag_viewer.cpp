@@ -2,7 +2,7 @@
  * This programs visualizes a CRAG stored in an hdf5 file.
  */
 
-#include <io/Hdf5CragStore.h>
+#include <io/CragStoreFactory.h>
 #include <io/Hdf5VolumeStore.h>
 #include <util/ProgramOptions.h>
 #include <util/string.h>
@@ -200,10 +200,10 @@ int main(int argc, char** argv) {
 		util::ProgramOptions::init(argc, argv);
 		logger::LogManager::init();
 
-		// create hdf5 stores
+		// create stores
 
-		Hdf5CragStore   cragStore(optionProjectFile.as<std::string>());
-		Hdf5VolumeStore volumeStore(optionProjectFile.as<std::string>());
+		std::unique_ptr<CragStore> cragStore(CragStoreFactory::createCragStore(optionProjectFile.as<std::string>()));
+		Hdf5VolumeStore            volumeStore(optionProjectFile.as<std::string>());
 
 		// get crag and volumes
 
@@ -212,8 +212,8 @@ int main(int argc, char** argv) {
 
 		try {
 
-			cragStore.retrieveCrag(crag);
-			cragStore.retrieveVolumes(volumes);
+			cragStore->retrieveCrag(crag);
+			cragStore->retrieveVolumes(volumes);
 
 		} catch (std::exception& e) {
 
@@ -266,12 +266,12 @@ int main(int argc, char** argv) {
 		std::shared_ptr<CragSolution>          viewSolution;
 
 		for (std::string name : split(optionOverlay, ','))
-			overlays.push_back(getOverlay(name, crag, volumes, cragStore, volumeStore, supervoxels));
+			overlays.push_back(getOverlay(name, crag, volumes, *cragStore, volumeStore, supervoxels));
 
 		if (optionShowSolution) {
 
 			viewSolution = std::make_shared<CragSolution>(crag);
-			cragStore.retrieveSolution(crag, *viewSolution, optionShowSolution.as<std::string>());
+			cragStore->retrieveSolution(crag, *viewSolution, optionShowSolution.as<std::string>());
 		}
 
 		bool showSolutionCandidates = false;
@@ -280,7 +280,7 @@ int main(int argc, char** argv) {
 			if (!overlaySolution) {
 
 				overlaySolution = std::make_shared<CragSolution>(crag);
-				cragStore.retrieveSolution(crag, *overlaySolution, optionCandidates.as<std::string>());
+				cragStore->retrieveSolution(crag, *overlaySolution, optionCandidates.as<std::string>());
 			}
 
 			showSolutionCandidates = true;
@@ -295,8 +295,8 @@ int main(int argc, char** argv) {
 
 			LOG_USER(logger::out) << "reading features..." << std::flush;
 
-			cragStore.retrieveNodeFeatures(crag, nodeFeatures);
-			cragStore.retrieveEdgeFeatures(crag, edgeFeatures);
+			cragStore->retrieveNodeFeatures(crag, nodeFeatures);
+			cragStore->retrieveEdgeFeatures(crag, edgeFeatures);
 
 			LOG_USER(logger::out) << "done." << std::endl;
 
@@ -311,7 +311,7 @@ int main(int argc, char** argv) {
 
 		try {
 
-			cragStore.retrieveCosts(crag, costs, optionShowCosts);
+			cragStore->retrieveCosts(crag, costs, optionShowCosts);
 
 		} catch (std::exception& e) {
 
@@ -324,7 +324,7 @@ int main(int argc, char** argv) {
 
 		try {
 
-			cragStore.retrieveVolumeRays(*rays);
+			cragStore->retrieveVolumeRays(*rays);
 
 		} catch (std::exception& e) {
 
@@ -22,6 +22,7 @@
 #include <mergetree/MultiplyMinRegionSize.h>
 #include <mergetree/MultiplySizeDifference.h>
 #include <mergetree/RandomPerturbation.h>
+#include <io/MergeHistory.h>
 #include <io/volumes.h>
 
 util::ProgramOption optionSource(
@@ -55,6 +56,10 @@ util::ProgramOption optionMergeHistory(
 		util::_description_text = "A file to write the region adjacency graph and merge history after merging.",
 		util::_default_value    = "merge_history.txt");
 
+util::ProgramOption optionBinaryMergeHistory(
+		util::_long_name        = "binaryMergeHistory",
+		util::_description_text = "Write the merge history in a binary format, which is faster to read than the text format.");
+
 util::ProgramOption optionSmooth(
 		util::_long_name        = "smooth",
 		util::_description_text = "Smooth the input image with a Gaussian kernel of the given stddev.");
@@ -287,7 +292,18 @@ int main(int optionc, char** optionv) {
 
 		LOG_USER(logger::out) << "writing merge history..." << std::endl;
 
-		merging.storeMergeHistory(optionMergeHistory.as<std::string>());
+		if (optionBinaryMergeHistory) {
+
+			std::vector<int>   merges;
+			std::vector<float> scores;
+			merging.getMergeHistory(merges, scores);
+
+			MergeHistory::write(optionMergeHistory.as<std::string>(), merges, scores);
+
+		} else {
+
+			merging.storeMergeHistory(optionMergeHistory.as<std::string>());
+		}
 
 	} catch (Exception& e) {
 
@@ -0,0 +1,120 @@
+#include <set>
+#include <tests.h>
+#include <crag/LeafAdjacencyPropagator.h>
+#include <crag/PlanarAdjacencyAnnotator.h>
+#include <io/CragImport.h>
+
+typedef std::map<std::pair<int, int>, std::vector<int64_t>> Adjacencies;
+
+Adjacencies
+annotateAdjacencies(
+		const ExplicitVolume<int>&             supervoxels,
+		PlanarAdjacencyAnnotator::Neighborhood neighborhood,
+		int                                    tileSize) {
+
+	Crag        crag;
+	CragVolumes volumes(crag);
+
+	CragImport import;
+	import.readSupervoxels(supervoxels, crag, volumes, util::point<float, 3>(1, 1, 1), util::point<float, 3>(0, 0, 0));
+
+	optionAdjacencyTileSize.setValue(tileSize);
+
+	PlanarAdjacencyAnnotator annotator(neighborhood);
+	annotator.annotate(crag, volumes);
+
+	Adjacencies adjacencies;
+	for (Crag::CragEdge e : crag.edges()) {
+
+		std::vector<int64_t>& ids = adjacencies[std::make_pair(
+				std::min(crag.id(e.u()), crag.id(e.v())),
+				std::max(crag.id(e.u()), crag.id(e.v())))];
+
+		for (vigra::GridGraph<3>::Edge edge : crag.getAffiliatedEdges(e))
+			ids.push_back(crag.getGridGraph().id(edge));
+	}
+
+	return adjacencies;
+}
+
+void adjacency_annotator() {
+
+	ExplicitVolume<int> supervoxels(23, 17, 5);
+
+	for (unsigned int z = 0; z < supervoxels.depth();  z++)
+	for (unsigned int y = 0; y < supervoxels.height(); y++)
+	for (unsigned int x = 0; x < supervoxels.width();  x++)
+		supervoxels(x, y, z) = (x + 2*y)/5 + 10*(z/2) + 1;
+
+	for (auto neighborhood : { PlanarAdjacencyAnnotator::Direct, PlanarAdjacencyAnnotator::Indirect }) {
+
+		Adjacencies whole = annotateAdjacencies(supervoxels, neighborhood, 256);
+		Adjacencies tiled = annotateAdjacencies(supervoxels, neighborhood, 3);
+
+		BOOST_CHECK(!whole.empty());
+		BOOST_CHECK(whole == tiled);
+	}
+
+	// each pair of direct neighbors with different labels is one affiliated 
+	// edge
+	Adjacencies direct = annotateAdjacencies(supervoxels, PlanarAdjacencyAnnotator::Direct, 4);
+
+	std::size_t expected = 0;
+	for (unsigned int z = 0; z < supervoxels.depth();  z++)
+	for (unsigned int y = 0; y < supervoxels.height(); y++)
+	for (unsigned int x = 0; x < supervoxels.width();  x++) {
+
+		if (x + 1 < supervoxels.width()  && supervoxels(x, y, z) != supervoxels(x + 1, y, z))
+			expected++;
+		if (y + 1 < supervoxels.height() && supervoxels(x, y, z) != supervoxels(x, y + 1, z))
+			expected++;
+		if (z + 1 < supervoxels.depth()  && supervoxels(x, y, z) != supervoxels(x, y, z + 1))
+			expected++;
+	}
+
+	std::size_t found = 0;
+	for (auto& p : direct)
+		found += p.second.size();
+
+	BOOST_CHECK_EQUAL(found, expected);
+
+	optionAdjacencyTileSize.setValue(256);
+
+	// propagation of leaf adjacencies in two subset trees
+	//
+	//       7         9
+	//      / \       / \
+	//     6   2     8   5
+	//    / \       / \
+	//   0   1     3   4
+	//
+	// with leaf adjacencies 0-1-2-3-4-5
+	Crag        crag;
+	CragVolumes volumes(crag);
+
+	for (int i = 0; i < 10; i++)
+		crag.addNode();
+
+	int arcs[][2] = { {0, 6}, {1, 6}, {6, 7}, {2, 7}, {3, 8}, {4, 8}, {8, 9}, {5, 9} };
+	for (auto& arc : arcs)
+		crag.addSubsetArc(crag.nodeFromId(arc[0]), crag.nodeFromId(arc[1]));
+	for (int i = 0; i < 5; i++)
+		crag.addAdjacencyEdge(crag.nodeFromId(i), crag.nodeFromId(i + 1));
+
+	LeafAdjacencyPropagator propagator;
+	propagator.annotate(crag, volumes);
+
+	std::set<std::pair<int, int>> edges;
+	for (Crag::CragEdge e : crag.edges())
+		edges.insert(std::make_pair(
+				std::min(crag.id(e.u()), crag.id(e.v())),
+				std::max(crag.id(e.u()), crag.id(e.v()))));
+
+	std::set<std::pair<int, int>> expectedEdges = {
+		{0, 1}, {1, 2}, {2, 3}, {3, 4}, {4, 5},
+		{2, 6}, {3, 7}, {2, 8}, {5, 8}, {7, 8}, {2, 9}, {7, 9}
+	};
+
+	BOOST_CHECK_EQUAL(crag.edges().size(), expectedEdges.size());
+	BOOST_CHECK(edges == expectedEdges);
+}
@@ -0,0 +1,65 @@
+#include <tests.h>
+#include <crag/Crag.h>
+#include <crag/CragBuilder.h>
+
+void crag_builder() {
+
+	Crag crag;
+
+	// one node that exists already
+	Crag::CragNode a = crag.addNode(Crag::SliceNode);
+
+	CragBuilder builder(crag);
+
+	CragBuilder::Slot sa = builder.existing(a);
+	CragBuilder::Slot first = builder.addNodes(9, Crag::SliceNode);
+	CragBuilder::Slot root  = builder.addNode(Crag::AssignmentNode);
+
+	BOOST_CHECK_EQUAL(builder.numSlots(), 11);
+	BOOST_CHECK_EQUAL(first, 1);
+
+	// a chain of adjacency edges, all nodes under one root
+	builder.addAdjacencyEdge(sa, first);
+	for (int i = first; i < first + 8; i++)
+		builder.addAdjacencyEdge(i, i + 1);
+	builder.addSubsetArc(sa, root);
+	for (int i = first; i < first + 9; i++)
+		builder.addSubsetArc(i, root);
+
+	std::vector<Crag::CragNode> nodes = builder.build();
+
+	BOOST_CHECK_EQUAL(nodes.size(), 11);
+	BOOST_CHECK(nodes[sa] == a);
+	BOOST_CHECK_EQUAL(crag.nodes().size(), 11);
+	BOOST_CHECK_EQUAL(crag.edges().size(), 9);
+	BOOST_CHECK_EQUAL(crag.arcs().size(),  10);
+	BOOST_CHECK_EQUAL(crag.type(nodes[first]), Crag::SliceNode);
+	BOOST_CHECK_EQUAL(crag.type(nodes[root]),  Crag::AssignmentNode);
+	BOOST_CHECK(crag.isRootNode(nodes[root]));
+	BOOST_CHECK_EQUAL(crag.getLevel(nodes[root]), 1);
+	BOOST_CHECK(crag.findEdge(nodes[first + 3], nodes[first + 4]) != lemon::INVALID);
+
+	// erase some nodes and compact the ids
+	crag.erase(nodes[first + 1]);
+	crag.erase(nodes[first + 5]);
+
+	Crag compact;
+	std::vector<int> idMap = CragBuilder::compact(crag, compact);
+
+	BOOST_CHECK_EQUAL(compact.nodes().size(), 9);
+	BOOST_CHECK_EQUAL(compact.edges().size(), crag.edges().size());
+	BOOST_CHECK_EQUAL(compact.arcs().size(),  crag.arcs().size());
+	BOOST_CHECK_EQUAL(compact.getAdjacencyGraph().maxNodeId(), 8);
+
+	BOOST_CHECK_EQUAL(idMap[crag.id(nodes[first + 1])], -1);
+	BOOST_CHECK_EQUAL(idMap[crag.id(nodes[first + 5])], -1);
+
+	for (Crag::CragNode n : crag.nodes()) {
+
+		Crag::CragNode m = compact.nodeFromId(idMap[crag.id(n)]);
+
+		BOOST_CHECK_EQUAL(crag.type(n), compact.type(m));
+		BOOST_CHECK_EQUAL(crag.isRootNode(n), compact.isRootNode(m));
+		BOOST_CHECK_EQUAL(crag.adjEdges(n).size(), compact.adjEdges(m).size());
+	}
+}
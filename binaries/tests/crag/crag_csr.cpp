@@ -0,0 +1,78 @@
+#include <tests.h>
+#include <crag/Crag.h>
+#include <crag/CragCsr.h>
+
+void crag_csr() {
+
+	Crag crag;
+
+	int numNodes = 10;
+	for (int i = 0; i < numNodes; i++)
+		crag.addNode();
+
+	// a chain of adjacency edges
+	for (int i = 0; i < numNodes - 1; i++)
+		crag.addAdjacencyEdge(
+				crag.nodeFromId(i),
+				crag.nodeFromId(i + 1));
+
+	// two trees: 0,1,2 -> 3 -> 4 and 5,6 -> 7
+	crag.addSubsetArc(crag.nodeFromId(0), crag.nodeFromId(3));
+	crag.addSubsetArc(crag.nodeFromId(1), crag.nodeFromId(3));
+	crag.addSubsetArc(crag.nodeFromId(2), crag.nodeFromId(3));
+	crag.addSubsetArc(crag.nodeFromId(3), crag.nodeFromId(4));
+	crag.addSubsetArc(crag.nodeFromId(5), crag.nodeFromId(7));
+	crag.addSubsetArc(crag.nodeFromId(6), crag.nodeFromId(7));
+
+	// remove a node to get non-contiguous ids
+	crag.erase(crag.nodeFromId(8));
+
+	CragCsr csr(crag);
+
+	BOOST_CHECK_EQUAL(csr.numNodes(), crag.nodes().size());
+	BOOST_CHECK_EQUAL(csr.numEdges(), crag.edges().size());
+	BOOST_CHECK_EQUAL(csr.numArcs(),  crag.arcs().size());
+
+	for (Crag::CragNode n : crag.nodes()) {
+
+		int i = csr.index(n);
+
+		BOOST_CHECK(csr.node(i) == n);
+		BOOST_CHECK_EQUAL(csr.nodeId(i), crag.id(n));
+		BOOST_CHECK_EQUAL(csr.nodeType(i), crag.type(n));
+		BOOST_CHECK_EQUAL(csr.isLeafNode(i), crag.isLeafNode(n));
+		BOOST_CHECK_EQUAL(csr.isRootNode(i), crag.isRootNode(n));
+		BOOST_CHECK_EQUAL(csr.adjEdges(i).size(), crag.adjEdges(n).size());
+		BOOST_CHECK_EQUAL(csr.children(i).size(), crag.inArcs(n).size());
+		BOOST_CHECK_EQUAL(csr.parents(i).size(),  crag.outArcs(n).size());
+
+		for (Crag::CragArc a : crag.inArcs(n)) {
+
+			int child = csr.index(a.source());
+			bool found = false;
+			for (int c : csr.children(i))
+				found |= (c == child);
+			BOOST_CHECK(found);
+		}
+
+		for (std::size_t j = 0; j < csr.adjEdges(i).size(); j++) {
+
+			int e = csr.adjEdges(i)[j];
+			int m = csr.neighbors(i)[j];
+
+			BOOST_CHECK(csr.u(e) == i || csr.v(e) == i);
+			BOOST_CHECK_EQUAL(csr.u(e) == i ? csr.v(e) : csr.u(e), m);
+		}
+	}
+
+	for (Crag::CragEdge e : crag.edges()) {
+
+		int i = csr.index(e);
+
+		BOOST_CHECK_EQUAL(csr.edgeId(i), crag.id(e));
+		BOOST_CHECK_EQUAL(csr.edgeType(i), crag.type(e));
+		BOOST_CHECK_EQUAL(csr.nodeId(csr.u(i)), crag.id(e.u()));
+		BOOST_CHECK_EQUAL(csr.nodeId(csr.v(i)), crag.id(e.v()));
+		BOOST_CHECK_EQUAL(csr.isLeafEdge(i), crag.isLeafEdge(e));
+	}
+}
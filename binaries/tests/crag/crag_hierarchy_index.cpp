@@ -0,0 +1,115 @@
+#include <tests.h>
+#include <crag/Crag.h>
+#include <crag/CragHierarchyIndex.h>
+
+namespace crag_hierarchy_index_case {
+
+void
+recLeafNodes(const Crag& crag, Crag::CragNode n, std::set<Crag::CragNode>& leafNodes) {
+
+	if (crag.isLeafNode(n))
+		leafNodes.insert(n);
+	else
+		for (Crag::CragArc a : crag.inArcs(n))
+			recLeafNodes(crag, a.source(), leafNodes);
+}
+
+void
+recDescendants(const Crag& crag, Crag::CragNode n, std::set<Crag::CragNode>& descendants) {
+
+	descendants.insert(n);
+	for (Crag::CragArc a : crag.inArcs(n))
+		recDescendants(crag, a.source(), descendants);
+}
+
+} using namespace crag_hierarchy_index_case;
+
+void crag_hierarchy_index() {
+
+	Crag crag;
+
+	// 8 leaf nodes in a chain of adjacency edges
+	std::vector<Crag::CragNode> n;
+	for (int i = 0; i < 8; i++)
+		n.push_back(crag.addNode());
+	for (int i = 0; i < 7; i++)
+		crag.addAdjacencyEdge(n[i], n[i+1]);
+
+	// a binary tree over the leaf nodes
+	for (int i = 0; i < 7; i++) {
+
+		Crag::CragNode p = crag.addNode();
+		crag.addSubsetArc(n[2*i], p);
+		crag.addSubsetArc(n[2*i + 1], p);
+		n.push_back(p);
+	}
+
+	// adjacency edges between siblings in the tree
+	for (int i = 8; i < 14; i += 2)
+		crag.addAdjacencyEdge(n[i], n[i+1]);
+
+	// a node with two parents, as created by CragStackCombiner
+	Crag::CragNode shared = crag.addNode();
+	crag.addSubsetArc(n[0], shared);
+	crag.addSubsetArc(n[7], shared);
+	Crag::CragNode sharedParent = crag.addNode();
+	crag.addSubsetArc(shared, sharedParent);
+	crag.addSubsetArc(n[14], sharedParent);
+	n.push_back(shared);
+	n.push_back(sharedParent);
+
+	BOOST_CHECK_EQUAL(crag.getLevel(n[0]),  0);
+	BOOST_CHECK_EQUAL(crag.getLevel(n[8]),  1);
+	BOOST_CHECK_EQUAL(crag.getLevel(n[12]), 2);
+	BOOST_CHECK_EQUAL(crag.getLevel(n[14]), 3);
+	BOOST_CHECK_EQUAL(crag.getLevel(sharedParent), 4);
+
+	const CragHierarchyIndex& index = crag.getHierarchyIndex();
+
+	BOOST_CHECK_EQUAL(index.numNodes(), crag.nodes().size());
+	BOOST_CHECK_EQUAL(index.numLeafNodes(), 8);
+	BOOST_CHECK_EQUAL(index.depth(sharedParent), 0);
+	BOOST_CHECK_EQUAL(index.depth(n[14]), 1);
+	BOOST_CHECK_EQUAL(index.depth(n[0]),  4);
+
+	for (Crag::CragNode u : crag.nodes()) {
+
+		std::set<Crag::CragNode> leafNodes;
+		recLeafNodes(crag, u, leafNodes);
+		std::set<Crag::CragNode> descendants;
+		recDescendants(crag, u, descendants);
+
+		BOOST_CHECK(crag.leafNodes(u) == leafNodes);
+		BOOST_CHECK_EQUAL(index.numLeafNodes(u), leafNodes.size());
+
+		for (Crag::CragNode v : crag.nodes()) {
+
+			BOOST_CHECK_EQUAL(index.isDescendant(v, u), descendants.count(v) == 1);
+			BOOST_CHECK_EQUAL(index.isLeafDescendant(v, u), leafNodes.count(v) == 1);
+		}
+
+		// leaf edges are all edges between leaf nodes of u
+		std::set<Crag::CragEdge> leafEdges;
+		for (Crag::CragEdge e : crag.edges())
+			if (leafNodes.count(e.u()) && leafNodes.count(e.v()))
+				leafEdges.insert(e);
+
+		BOOST_CHECK(crag.leafEdges(u) == leafEdges);
+	}
+
+	// leaf and descendant edges of the edge between the two roots of the tree
+	Crag::CragEdge e = *crag.adjEdges(n[12]).begin();
+	BOOST_CHECK(crag.oppositeNode(n[12], e) == n[13]);
+
+	std::set<Crag::CragEdge> leafEdges = crag.leafEdges(e);
+	BOOST_CHECK_EQUAL(leafEdges.size(), 1);
+	BOOST_CHECK((*leafEdges.begin()).u() == n[3] || (*leafEdges.begin()).v() == n[3]);
+
+	BOOST_CHECK(crag.descendantEdges(e) == leafEdges);
+
+	// the index is rebuilt after modifications
+	Crag::CragNode root = crag.addNode();
+	crag.addSubsetArc(sharedParent, root);
+	BOOST_CHECK_EQUAL(crag.getLevel(root), 5);
+	BOOST_CHECK_EQUAL(crag.getHierarchyIndex().depth(n[0]), 5);
+}
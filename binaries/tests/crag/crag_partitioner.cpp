@@ -0,0 +1,65 @@
+#include <atomic>
+#include <tests.h>
+#include <crag/Crag.h>
+#include <crag/CragPartitioner.h>
+
+void crag_partitioner() {
+
+	Crag crag;
+
+	// 100 leaf nodes, with adjacency edges between consecutive ones
+	for (int i = 0; i < 100; i++)
+		crag.addNode();
+	for (int i = 0; i < 99; i++)
+		crag.addAdjacencyEdge(crag.nodeFromId(i), crag.nodeFromId(i + 1));
+
+	// one node merging the first 50 leaf nodes
+	Crag::CragNode big = crag.addNode();
+	for (int i = 0; i < 50; i++)
+		crag.addSubsetArc(crag.nodeFromId(i), big);
+
+	CragPartitioner partitioner(crag);
+
+	BOOST_CHECK_EQUAL(partitioner.numNodes(), 101);
+	BOOST_CHECK_EQUAL(partitioner.numEdges(), 99);
+
+	// equal sized ranges cover all nodes
+	std::vector<CragPartitioner::Range> ranges = partitioner.partitionNodes(7);
+	BOOST_CHECK_EQUAL(ranges.size(), 7);
+	BOOST_CHECK_EQUAL(ranges.front().begin, 0);
+	BOOST_CHECK_EQUAL(ranges.back().end, 101);
+	for (std::size_t i = 0; i < ranges.size(); i++) {
+
+		BOOST_CHECK(ranges[i].size() == 14 || ranges[i].size() == 15);
+		if (i > 0)
+			BOOST_CHECK_EQUAL(ranges[i].begin, ranges[i-1].end);
+	}
+
+	// more parts than nodes
+	BOOST_CHECK_EQUAL(partitioner.partitionNodes(1000).size(), 101);
+
+	// weighted by leaf count, the big node (weight 50) is on its own
+	std::vector<double> weights = partitioner.leafCountNodeWeights();
+	BOOST_CHECK_EQUAL(weights[100], 50);
+	ranges = partitioner.partitionNodes(2, weights);
+	BOOST_CHECK_EQUAL(ranges.size(), 2);
+	BOOST_CHECK_EQUAL(ranges[0].begin, 0);
+	BOOST_CHECK_EQUAL(ranges[0].end, 75);
+	BOOST_CHECK_EQUAL(ranges[1].end, 101);
+
+	// every node and edge is visited exactly once in parallel
+	std::vector<std::atomic<int>> visits(101);
+	for (auto& v : visits)
+		v = 0;
+	partitioner.forEachNode(
+			partitioner.partitionNodes(8),
+			[&](Crag::CragNode n) { visits[crag.id(n)]++; });
+	for (auto& v : visits)
+		BOOST_CHECK_EQUAL(v.load(), 1);
+
+	std::atomic<int> numEdges(0);
+	partitioner.forEachEdge(
+			partitioner.partitionEdges(8, partitioner.leafCountEdgeWeights()),
+			[&](Crag::CragEdge) { numEdges++; });
+	BOOST_CHECK_EQUAL(numEdges.load(), 99);
+}
@@ -0,0 +1,105 @@
+#include <map>
+#include <set>
+#include <tests.h>
+#include <util/exceptions.h>
+#include <crag/Crag.h>
+#include <crag/CragVolumes.h>
+#include <crag/DownSampler.h>
+
+void down_sampler() {
+
+	Crag crag;
+	CragVolumes volumes(crag);
+
+	for (int i = 0; i < 10; i++)
+		crag.addNode();
+
+	/*      4           9
+	 *    /   \         |
+	 *   0     3        7
+	 *        / \      / \
+	 *       1   2    5   6
+	 */
+
+	crag.addSubsetArc(crag.nodeFromId(0), crag.nodeFromId(4));
+	crag.addSubsetArc(crag.nodeFromId(3), crag.nodeFromId(4));
+	crag.addSubsetArc(crag.nodeFromId(1), crag.nodeFromId(3));
+	crag.addSubsetArc(crag.nodeFromId(2), crag.nodeFromId(3));
+	crag.addSubsetArc(crag.nodeFromId(7), crag.nodeFromId(9));
+	crag.addSubsetArc(crag.nodeFromId(5), crag.nodeFromId(7));
+	crag.addSubsetArc(crag.nodeFromId(6), crag.nodeFromId(7));
+
+	// disjoint leaf node volumes of sizes 2, 6, 1, 4, and 5
+	std::map<int, int> sizes = { {0, 2}, {1, 6}, {2, 1}, {5, 4}, {6, 5} };
+
+	int x = 0;
+	for (auto& p : sizes) {
+
+		std::shared_ptr<CragVolume> volume = std::make_shared<CragVolume>(p.second, 1, 1, true);
+		volume->setOffset(x, 0, 0);
+		x += p.second;
+
+		volumes.setVolume(crag.nodeFromId(p.first), volume);
+	}
+
+	// keep only candidates with at least 3 voxels, contract single children
+	{
+		Crag        downSampled;
+		CragVolumes downSampledVolumes(downSampled);
+
+		DownSampler downSampler(3);
+		downSampler.process(crag, volumes, downSampled, downSampledVolumes);
+
+		// 4, 3, 1 and 9, 5, 6
+		BOOST_CHECK_EQUAL(downSampled.nodes().size(), 6);
+		BOOST_CHECK_EQUAL(downSampled.arcs().size(),  4);
+
+		std::multiset<int> numChildren;
+		std::multiset<int> leafSizes;
+		for (Crag::CragNode n : downSampled.nodes()) {
+
+			if (downSampled.isRootNode(n))
+				numChildren.insert(downSampled.inArcs(n).size());
+
+			if (downSampled.isLeafNode(n))
+				leafSizes.insert(downSampledVolumes[n]->getBoundingBox().width());
+		}
+
+		BOOST_CHECK(numChildren == std::multiset<int>({1, 2}));
+		BOOST_CHECK(leafSizes   == std::multiset<int>({4, 5, 6}));
+
+		// all copies keep the volumes of their originals
+		for (Crag::CragNode n : downSampled.nodes())
+			if (downSampled.isRootNode(n) && downSampled.inArcs(n).size() == 1)
+				BOOST_CHECK_EQUAL(downSampledVolumes[n]->getBoundingBox(), volumes[crag.nodeFromId(4)]->getBoundingBox());
+	}
+
+	// keep only leaf and root nodes
+	{
+		Crag        downSampled;
+		CragVolumes downSampledVolumes(downSampled);
+
+		DownSampler downSampler;
+		downSampler.process(crag, volumes, downSampled, downSampledVolumes);
+
+		// 4, 0, 1, 2 and 9, 5, 6
+		BOOST_CHECK_EQUAL(downSampled.nodes().size(), 7);
+		BOOST_CHECK_EQUAL(downSampled.arcs().size(),  5);
+
+		std::multiset<int> numChildren;
+		for (Crag::CragNode n : downSampled.nodes())
+			if (downSampled.isRootNode(n))
+				numChildren.insert(downSampled.inArcs(n).size());
+
+		BOOST_CHECK(numChildren == std::multiset<int>({2, 3}));
+	}
+
+	// only subset trees can be downsampled
+	crag.addSubsetArc(crag.nodeFromId(2), crag.nodeFromId(7));
+
+	Crag        downSampled;
+	CragVolumes downSampledVolumes(downSampled);
+
+	DownSampler downSampler(3);
+	BOOST_CHECK_THROW(downSampler.process(crag, volumes, downSampled, downSampledVolumes), UsageError);
+}
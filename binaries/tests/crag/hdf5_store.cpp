@@ -1,6 +1,7 @@
 #include <map>
 #include <tests.h>
 #include <crag/Crag.h>
+#include <features/VolumeRays.h>
 #include <io/Hdf5CragStore.h>
 
 void hdf5_store() {
@@ -36,6 +37,24 @@ void hdf5_store() {
 					crag.nodeFromId(j+1));
 	}
 
+	// affiliated edges for leaf edges, depending only on the node pair
+	vigra::GridGraph<3> gridGraph(vigra::Shape3(10, 10, 10), vigra::DirectNeighborhood);
+	crag.setGridGraph(gridGraph);
+	for (Crag::CragEdge e : crag.edges()) {
+
+		if (!crag.isLeafEdge(e))
+			continue;
+
+		int a = std::min(crag.id(e.u()), crag.id(e.v()));
+		int b = std::max(crag.id(e.u()), crag.id(e.v()));
+
+		std::vector<vigra::GridGraph<3>::Edge> affiliatedEdges;
+		for (int i = 0; i < (a + b)%7; i++)
+			affiliatedEdges.push_back(gridGraph.edgeFromId((a*100 + b + i)%gridGraph.edgeNum()));
+
+		crag.setAffiliatedEdges(e, affiliatedEdges);
+	}
+
 	Hdf5CragStore store("test.hdf");
 
 	store.saveCrag(crag);
@@ -70,10 +89,90 @@ void hdf5_store() {
 					b->getOffset());
 
 			BOOST_CHECK(a->data() == b->data());
+
+			// single volumes can be read without the others
+			std::shared_ptr<CragVolume> c = store.retrieveVolume(crag_, crag_.nodeFromId(crag.id(n)));
+
+			BOOST_REQUIRE(c);
+			BOOST_CHECK_EQUAL(
+					a->getOffset(),
+					c->getOffset());
+			BOOST_CHECK(a->data() == c->data());
 		}
 	}
 
+	// non-leaf nodes have no stored volume
+	BOOST_CHECK(!store.retrieveVolume(crag_, crag_.nodeFromId(1)));
+
+	// lazily loaded volumes can be saved to another store
+	{
+		Hdf5CragStore copyStore("test_copy.hdf");
+
+		copyStore.saveCrag(crag_);
+		copyStore.saveVolumes(volumes_);
+
+		for (Crag::CragNode n : crag_.nodes())
+			if (crag_.isLeafNode(n))
+				BOOST_CHECK(copyStore.retrieveVolume(crag_, n)->data() == volumes_[n]->data());
+	}
+
+	for (Crag::CragEdge e : crag.edges()) {
+
+		if (!crag.isLeafEdge(e))
+			continue;
+
+		Crag::CragEdge e_ = crag_.findEdge(
+				crag_.nodeFromId(crag.id(e.u())),
+				crag_.nodeFromId(crag.id(e.v())));
+
+		BOOST_REQUIRE(e_ != lemon::INVALID);
+
+		Crag::AffiliatedEdges a = crag.getAffiliatedEdges(e);
+		Crag::AffiliatedEdges b = crag_.getAffiliatedEdges(e_);
+
+		BOOST_CHECK_EQUAL(a.size(), b.size());
+		BOOST_CHECK(std::equal(a.beginIds(), a.endIds(), b.beginIds()));
+	}
+
 	for (Crag::CragArc e : crag_.arcs())
 		BOOST_CHECK(
 				crag_.id(e.source()) == crag_.id(e.target()) - 1);
+
+	// volume rays for every 3rd node
+	VolumeRays rays(crag);
+	for (Crag::CragNode n : crag.nodes()) {
+
+		if (crag.id(n)%3 != 0)
+			continue;
+
+		for (int i = 0; i < crag.id(n)%5 + 1; i++) {
+
+			util::ray<float, 3> ray;
+			ray.position()  = util::point<float, 3>(crag.id(n), i, 0);
+			ray.direction() = util::point<float, 3>(0, 1, i);
+			rays[n].push_back(ray);
+		}
+	}
+
+	store.saveVolumeRays(rays);
+
+	VolumeRays rays_(crag_);
+	store.retrieveVolumeRays(rays_);
+
+	for (Crag::CragNode n : crag.nodes()) {
+
+		Crag::CragNode n_ = crag_.nodeFromId(crag.id(n));
+
+		BOOST_REQUIRE_EQUAL(rays[n].size(), rays_[n_].size());
+		for (std::size_t i = 0; i < rays[n].size(); i++) {
+
+			BOOST_CHECK_EQUAL(rays[n][i].position(),  rays_[n_][i].position());
+			BOOST_CHECK_EQUAL(rays[n][i].direction(), rays_[n_][i].direction());
+		}
+
+		// rays of single nodes can be read without the others
+		std::vector<util::ray<float, 3>> nodeRays;
+		BOOST_CHECK_EQUAL(store.retrieveVolumeRays(crag_, n_, nodeRays), !rays[n].empty());
+		BOOST_CHECK_EQUAL(nodeRays.size(), rays[n].size());
+	}
 }
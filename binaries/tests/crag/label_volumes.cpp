@@ -0,0 +1,97 @@
+#include <tests.h>
+#include <crag/Crag.h>
+#include <crag/CragVolumes.h>
+#include <features/Overlap.h>
+
+void label_volumes() {
+
+	Crag crag;
+	CragVolumes volumes(crag);
+
+	for (int i = 0; i < 4; i++)
+		crag.addNode();
+
+	/*    3
+	 *  / | \
+	 * 0  1  2
+	 */
+	crag.addSubsetArc(crag.nodeFromId(0), crag.nodeFromId(3));
+	crag.addSubsetArc(crag.nodeFromId(1), crag.nodeFromId(3));
+	crag.addSubsetArc(crag.nodeFromId(2), crag.nodeFromId(3));
+
+	/* labels:
+	 *
+	 * 0 5 5 0 0 0
+	 * 0 5 7 7 0 0
+	 * 0 0 7 7 0 9
+	 */
+	auto labels = std::make_shared<ExplicitVolume<int>>(6, 3, 1, 0);
+	labels->setOffset(10, 20, 0);
+	labels->setResolution(2, 2, 1);
+	(*labels)(1, 0, 0) = 5;
+	(*labels)(2, 0, 0) = 5;
+	(*labels)(1, 1, 0) = 5;
+	(*labels)(2, 1, 0) = 7;
+	(*labels)(3, 1, 0) = 7;
+	(*labels)(2, 2, 0) = 7;
+	(*labels)(3, 2, 0) = 7;
+	(*labels)(5, 2, 0) = 9;
+
+	volumes.setLabelVolume(labels);
+	volumes.setLeafLabel(crag.nodeFromId(0), 5, util::box<unsigned int, 3>(1, 0, 0, 3, 2, 1));
+	volumes.setLeafLabel(crag.nodeFromId(1), 7, util::box<unsigned int, 3>(2, 1, 0, 4, 3, 1));
+	volumes.setLeafLabel(crag.nodeFromId(2), 9, util::box<unsigned int, 3>(5, 2, 0, 6, 3, 1));
+
+	BOOST_CHECK(volumes.hasLabelVolume());
+
+	LabelMaskView mask0 = volumes.getMask(crag.nodeFromId(0));
+	BOOST_CHECK_EQUAL(mask0.width(), 2);
+	BOOST_CHECK_EQUAL(mask0.height(), 2);
+	BOOST_CHECK_EQUAL(mask0.count(), 3);
+	BOOST_CHECK_EQUAL(mask0(0, 0, 0), 1);
+	BOOST_CHECK_EQUAL(mask0(1, 1, 0), 0);
+	BOOST_CHECK_EQUAL(mask0.getOffset(), util::point<float, 3>(12, 20, 0));
+
+	LabelMaskView mask3 = volumes.getMask(crag.nodeFromId(3));
+	BOOST_CHECK_EQUAL(mask3.getLabels().size(), 3);
+	BOOST_CHECK_EQUAL(mask3.width(), 5);
+	BOOST_CHECK_EQUAL(mask3.height(), 3);
+	BOOST_CHECK_EQUAL(mask3.count(), 8);
+
+	// materialized volumes agree with the masks
+	std::shared_ptr<CragVolume> volume3 = volumes[crag.nodeFromId(3)];
+	BOOST_CHECK_EQUAL(volume3->getBoundingBox(), mask3.getBoundingBox());
+	BOOST_CHECK_EQUAL(volumes.getBoundingBox(crag.nodeFromId(3)), mask3.getBoundingBox());
+	for (unsigned int y = 0; y < mask3.height(); y++)
+	for (unsigned int x = 0; x < mask3.width();  x++)
+		BOOST_CHECK_EQUAL((*volume3)(x, y, 0), mask3(x, y, 0));
+
+	std::shared_ptr<CragVolume> volume1 = volumes[crag.nodeFromId(1)];
+	BOOST_CHECK_EQUAL(volume1->getBoundingBox(), util::box<float, 3>(14, 22, 0, 18, 26, 1));
+	BOOST_CHECK_EQUAL((*volume1)(0, 0, 0), 1);
+	BOOST_CHECK_EQUAL((*volume1)(1, 1, 0), 1);
+
+	BOOST_CHECK_EQUAL(volumes.getBoundingBox(), util::box<float, 3>(12, 20, 0, 22, 26, 1));
+
+	// voxels can be visited and counted without materializing the volumes
+	volumes.clearCache();
+
+	std::size_t numVisited = 0;
+	volumes.forEachVoxel(crag.nodeFromId(3), [&](unsigned int x, unsigned int y, unsigned int z) {
+
+		BOOST_CHECK_EQUAL(mask3(x, y, z), 1);
+		numVisited++;
+	});
+
+	BOOST_CHECK_EQUAL(numVisited, 8);
+	BOOST_CHECK_EQUAL(volumes.numVoxels(crag.nodeFromId(0)), 3);
+	BOOST_CHECK_EQUAL(volumes.numVoxels(crag.nodeFromId(3)), 8);
+
+	// overlaps are the sizes of shared labels (voxels are 2x2x1)
+	Overlap overlap;
+	BOOST_CHECK_EQUAL(overlap(volumes, crag.nodeFromId(1), crag.nodeFromId(3)), 16);
+	BOOST_CHECK_EQUAL(overlap(volumes, crag.nodeFromId(0), crag.nodeFromId(1)), 0);
+	BOOST_CHECK_EQUAL(overlap(volumes, crag.nodeFromId(3), crag.nodeFromId(3)), 32);
+
+	BOOST_CHECK_EQUAL(volumes.getCacheStatistics().entries, 0);
+}
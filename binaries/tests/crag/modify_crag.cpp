@@ -1,4 +1,5 @@
 #include <map>
+#include <vector>
 #include <tests.h>
 #include <crag/Crag.h>
 
@@ -53,5 +54,98 @@ void modify_crag() {
 		else
 			BOOST_CHECK(!crag.isRootNode(n));
 	}
+
+	// add adjacency edges between consecutive nodes of each chain
+	for (int i = 0; i < 100; i++)
+		if (i%10 != 4 && i%10 != 5 && i%10 != 9)
+			crag.addAdjacencyEdge(crag.nodeFromId(i), crag.nodeFromId(i+1));
+
+	for (int i = 0; i < 100; i++) {
+
+		if (i%10 == 5 || i%10 == 9)
+			continue;
+
+		Crag::CragNode u = crag.nodeFromId(i);
+		Crag::CragNode v = crag.nodeFromId(i+1);
+
+		if (i%10 == 4) {
+
+			BOOST_CHECK(crag.findEdge(u, v) == lemon::INVALID);
+			continue;
+		}
+
+		Crag::CragEdge e = crag.findEdge(u, v);
+		BOOST_CHECK(e != lemon::INVALID);
+		BOOST_CHECK(crag.findEdge(v, u) == e);
+		BOOST_CHECK(e.u() == u || e.v() == u);
+		BOOST_CHECK(e.u() == v || e.v() == v);
+	}
+
+	// remove some edges and nodes again
+	crag.erase(crag.findEdge(crag.nodeFromId(0), crag.nodeFromId(1)));
+	crag.erase(crag.nodeFromId(12));
+
+	BOOST_CHECK(crag.findEdge(crag.nodeFromId(0),  crag.nodeFromId(1))  == lemon::INVALID);
+	BOOST_CHECK(crag.findEdge(crag.nodeFromId(11), crag.nodeFromId(12)) == lemon::INVALID);
+	BOOST_CHECK(crag.findEdge(crag.nodeFromId(12), crag.nodeFromId(13)) == lemon::INVALID);
+	BOOST_CHECK(crag.findEdge(crag.nodeFromId(1),  crag.nodeFromId(2))  != lemon::INVALID);
+
+	// parallel edges are found until the last one is removed
+	Crag::CragNode u = crag.nodeFromId(20);
+	Crag::CragNode v = crag.nodeFromId(21);
+	crag.addAdjacencyEdge(u, v);
+	crag.erase(crag.findEdge(u, v));
+	BOOST_CHECK(crag.findEdge(u, v) != lemon::INVALID);
+	crag.erase(crag.findEdge(u, v));
+	BOOST_CHECK(crag.findEdge(u, v) == lemon::INVALID);
+
+	// affiliated edges are overwritten in place, and released on erase
+	crag.setGridGraph(vigra::GridGraph<3>(vigra::Shape3(100, 100, 100)));
+
+	Crag::CragNode a = crag.addNode();
+	Crag::CragNode b = crag.addNode();
+	Crag::CragNode c = crag.addNode();
+	Crag::CragEdge ab = crag.addAdjacencyEdge(a, b);
+	Crag::CragEdge bc = crag.addAdjacencyEdge(b, c);
+
+	auto ids = [](int first, int num) {
+
+		std::vector<int64_t> ids;
+		for (int i = 0; i < num; i++)
+			ids.push_back(first + i);
+		return ids;
+	};
+
+	auto affiliated = [&](Crag::CragEdge e) {
+
+		Crag::AffiliatedEdges edges = crag.getAffiliatedEdges(e);
+		return std::vector<int64_t>(edges.beginIds(), edges.endIds());
+	};
+
+	std::vector<int64_t> ab5 = ids(0, 5);
+	std::vector<int64_t> bc3 = ids(100, 3);
+	crag.setAffiliatedEdgeIds(ab, ab5.data(), ab5.data() + ab5.size());
+	crag.setAffiliatedEdgeIds(bc, bc3.data(), bc3.data() + bc3.size());
+
+	std::vector<int64_t> ab2 = ids(10, 2);
+	crag.setAffiliatedEdgeIds(ab, ab2.data(), ab2.data() + ab2.size());
+	BOOST_CHECK(affiliated(ab) == ab2);
+	BOOST_CHECK(affiliated(bc) == bc3);
+
+	// grow the affiliated edges of ab until the released ids get compacted
+	std::vector<int64_t> abN;
+	for (int n = 3; n <= 500; n++) {
+
+		abN = ids(1000, n);
+		crag.setAffiliatedEdgeIds(ab, abN.data(), abN.data() + abN.size());
+	}
+	BOOST_CHECK(affiliated(ab) == abN);
+	BOOST_CHECK(affiliated(bc) == bc3);
+
+	// a new edge does not inherit the affiliated edges of an erased one
+	crag.erase(bc);
+	Crag::CragEdge ca = crag.addAdjacencyEdge(c, a);
+	BOOST_CHECK(crag.getAffiliatedEdges(ca).empty());
+	BOOST_CHECK(affiliated(ab) == abN);
 }
 
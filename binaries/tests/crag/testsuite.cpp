@@ -7,5 +7,13 @@ BEGIN_TEST_SUITE(crag)
 	ADD_TEST_CASE(hdf5_store)
 	ADD_TEST_CASE(crag_iterators)
 	ADD_TEST_CASE(volumes)
+	ADD_TEST_CASE(crag_csr)
+	ADD_TEST_CASE(crag_hierarchy_index)
+	ADD_TEST_CASE(crag_builder)
+	ADD_TEST_CASE(crag_partitioner)
+	ADD_TEST_CASE(volume_cache)
+	ADD_TEST_CASE(label_volumes)
+	ADD_TEST_CASE(adjacency_annotator)
+	ADD_TEST_CASE(down_sampler)
 
 END_TEST_SUITE()
@@ -0,0 +1,96 @@
+#include <tests.h>
+#include <util/exceptions.h>
+#include <crag/VolumeCache.h>
+
+void volume_cache() {
+
+	auto create = []{ return std::make_shared<CragVolume>(10, 10, 10); };
+
+	std::size_t size = VolumeCache::size(*create());
+
+	// a single shard, such that the budget is exact
+	VolumeCache cache(3*size, 1);
+
+	for (int i = 0; i < 3; i++)
+		cache.get(i, create);
+
+	VolumeCache::Statistics stats = cache.getStatistics();
+	BOOST_CHECK_EQUAL(stats.misses, 3);
+	BOOST_CHECK_EQUAL(stats.hits, 0);
+	BOOST_CHECK_EQUAL(stats.entries, 3);
+	BOOST_CHECK_EQUAL(stats.bytes, 3*size);
+	BOOST_CHECK_EQUAL(stats.evictions, 0);
+
+	// cached volumes are returned, 0 becomes most recently used
+	std::shared_ptr<CragVolume> v0 = cache.get(0);
+	BOOST_CHECK(v0);
+	BOOST_CHECK(cache.get(0, create) == v0);
+	BOOST_CHECK_EQUAL(cache.getStatistics().hits, 2);
+
+	// adding a fourth volume evicts the least recently used one (1)
+	cache.get(3, create);
+	stats = cache.getStatistics();
+	BOOST_CHECK_EQUAL(stats.entries, 3);
+	BOOST_CHECK_EQUAL(stats.evictions, 1);
+	BOOST_CHECK(!cache.get(1));
+	BOOST_CHECK(cache.get(0) == v0);
+
+	// pinned volumes are not evicted, even if they are least recently used
+	cache.pin(2);
+	cache.get(4, create);
+	cache.get(5, create);
+	BOOST_CHECK(cache.get(2));
+	BOOST_CHECK(!cache.get(0));
+
+	// pinning a node before it is cached protects it as well
+	cache.pin(6);
+	cache.get(6, create);
+	cache.get(7, create);
+	cache.get(8, create);
+	BOOST_CHECK(cache.get(2));
+	BOOST_CHECK(cache.get(6));
+	BOOST_CHECK_EQUAL(cache.getStatistics().entries, 3);
+
+	// existing volumes are not replaced
+	std::shared_ptr<CragVolume> v6 = cache.get(6);
+	BOOST_CHECK(cache.put(6, create()) == v6);
+
+	// clear keeps pinned volumes
+	cache.clear();
+	stats = cache.getStatistics();
+	BOOST_CHECK_EQUAL(stats.entries, 2);
+	BOOST_CHECK_EQUAL(stats.bytes, 2*size);
+
+	// a smaller budget evicts once the pins are released
+	cache.setMaxBytes(size);
+	BOOST_CHECK_EQUAL(cache.getStatistics().entries, 2);
+	cache.unpin(2);
+	cache.unpin(6);
+	BOOST_CHECK_EQUAL(cache.getStatistics().entries, 1);
+	BOOST_CHECK_THROW(cache.unpin(6), UsageError);
+
+	// the budget is shared by all shards, volumes larger than the budget of a
+	// single shard are cached as well
+	auto createLarge = []{ return std::make_shared<CragVolume>(20, 10, 10); };
+
+	VolumeCache sharded(4*size, 16);
+
+	std::shared_ptr<CragVolume> large = sharded.get(0, createLarge);
+	sharded.get(1, create);
+	sharded.get(2, create);
+	BOOST_CHECK(VolumeCache::size(*large) > sharded.getMaxBytes()/16);
+	BOOST_CHECK(sharded.get(0) == large);
+	BOOST_CHECK_EQUAL(sharded.getStatistics().evictions, 0);
+
+	// the newest volume is always admitted, older ones are evicted instead
+	std::shared_ptr<CragVolume> newest = sharded.get(3, createLarge);
+	stats = sharded.getStatistics();
+	BOOST_CHECK(sharded.get(3) == newest);
+	BOOST_CHECK(stats.bytes <= sharded.getMaxBytes());
+	BOOST_CHECK_EQUAL(stats.evictions, 1);
+
+	// even if it exceeds the whole budget
+	VolumeCache tiny(size/2, 16);
+	std::shared_ptr<CragVolume> v = tiny.get(5, create);
+	BOOST_CHECK(tiny.get(5) == v);
+}
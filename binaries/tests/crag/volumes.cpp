@@ -48,4 +48,20 @@ void volumes() {
 	BOOST_CHECK_EQUAL(volumes[crag.nodeFromId(5)]->getBoundingBox(), v0->getBoundingBox() + v1->getBoundingBox());
 	BOOST_CHECK_EQUAL(volumes[crag.nodeFromId(6)]->getBoundingBox(), v2->getBoundingBox() + v4->getBoundingBox());
 	BOOST_CHECK_EQUAL(volumes[crag.nodeFromId(7)]->getBoundingBox(), v0->getBoundingBox() + v4->getBoundingBox());
+
+	// materialize bottom-up from cached children
+	(*v0)(0, 0, 0) = 1;
+	(*v4)(9, 9, 9) = 1;
+	volumes.clearCache();
+	volumes.materializeSubtree(crag.nodeFromId(7));
+
+	VolumeCache::Statistics stats = volumes.getCacheStatistics();
+	BOOST_CHECK_EQUAL(stats.entries, 3);
+
+	std::shared_ptr<CragVolume> v7 = volumes[crag.nodeFromId(7)];
+	BOOST_CHECK_EQUAL(volumes.getCacheStatistics().hits, stats.hits + 1);
+	BOOST_CHECK_EQUAL(v7->getBoundingBox(), v0->getBoundingBox() + v4->getBoundingBox());
+	BOOST_CHECK_EQUAL((*v7)(0, 0, 0), 1);
+	BOOST_CHECK_EQUAL((*v7)(13, 13, 13), 1);
+	BOOST_CHECK_EQUAL((*v7)(5, 5, 5), 0);
 }
@@ -46,4 +46,43 @@ void features() {
 		BOOST_CHECK_EQUAL(features.dims(Crag::AdjacencyEdge), 2);
 		BOOST_CHECK_EQUAL(features.dims(Crag::NoAssignmentEdge), 0);
 	}
+
+	{
+		NodeFeatures features(crag);
+
+		for (int i = 0; i < 3; i++) {
+
+			features.append(n1, 10 + i);
+			features.append(n2, 20 + i);
+			features.append(n3, 30 + i);
+		}
+
+		BOOST_CHECK_EQUAL(features[n2].size(), 3);
+		BOOST_CHECK_EQUAL(features[n2][2], 22);
+
+		// all feature vectors of a type form a single row-major matrix, with
+		// rows padded to the stride
+		const NodeFeatures::FeaturesType& volumeFeatures = features.getFeatures(Crag::VolumeNode);
+
+		std::size_t stride = volumeFeatures.stride();
+
+		BOOST_CHECK_EQUAL(volumeFeatures.keys().size(), 3);
+		BOOST_CHECK(volumeFeatures.keys()[1] == n2);
+		BOOST_CHECK_EQUAL(volumeFeatures.dims(), 3);
+		BOOST_CHECK(stride >= 3);
+		BOOST_CHECK_EQUAL(volumeFeatures.data()[stride], 20);
+		BOOST_CHECK_EQUAL(volumeFeatures.data()[2*stride + 2], 32);
+
+		std::vector<Crag::CragNode> nodes;
+		nodes.push_back(n3);
+		nodes.push_back(n1);
+
+		double* data = features.getFeatures(Crag::VolumeNode).reset(nodes, 2);
+		for (int i = 0; i < 4; i++)
+			data[i] = i;
+
+		BOOST_CHECK_EQUAL(features.dims(Crag::VolumeNode), 2);
+		BOOST_CHECK_EQUAL(features[n1][1], 3);
+		BOOST_CHECK(features[n2].empty());
+	}
 }
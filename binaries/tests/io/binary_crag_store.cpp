@@ -0,0 +1,212 @@
+#include <cstdint>
+#include <cstdio>
+#include <tests.h>
+#include <util/exceptions.h>
+#include <crag/Crag.h>
+#include <io/BinaryCragStore.h>
+#include <io/BinarySectionFile.h>
+
+void binary_crag_store() {
+
+	std::remove("binary_test.cmc");
+
+	Crag crag;
+	CragVolumes volumes(crag);
+
+	for (int i = 0; i < 100; i++)
+		crag.addNode();
+
+	for (int i = 0; i < 100; i++)
+		for (int j = i + 1; j < 100; j++)
+			if (rand() > RAND_MAX/2)
+				crag.addAdjacencyEdge(
+						crag.nodeFromId(i),
+						crag.nodeFromId(j));
+
+	// set a volume for every 5th node, create subset links to next 4 nodes
+	for (int i = 0; i < 100; i += 5) {
+
+		std::shared_ptr<CragVolume> volume = std::make_shared<CragVolume>(5, 4, 3);
+		volume->setOffset(rand()%100, rand()%100, rand()%100);
+		volume->setResolution(1.0, 2.0, 3.0);
+
+		for (unsigned char& v : volume->data())
+			v = rand()%256;
+
+		volumes.setVolume(crag.nodeFromId(i), volume);
+
+		for (int j = i; j < i + 4; j++)
+			crag.addSubsetArc(
+					crag.nodeFromId(j),
+					crag.nodeFromId(j+1));
+	}
+
+	NodeFeatures nodeFeatures(crag);
+	EdgeFeatures edgeFeatures(crag);
+	Costs        costs(crag);
+	CragSolution solution(crag);
+
+	for (Crag::CragNode n : crag.nodes()) {
+
+		// appended one by one, such that the feature matrix has padded rows
+		nodeFeatures.append(n, crag.id(n)*1.0);
+		nodeFeatures.append(n, crag.id(n)*2.0);
+		nodeFeatures.append(n, crag.id(n)*3.0);
+		costs.node[n] = -crag.id(n);
+		solution.setSelected(n, crag.id(n)%3 == 0);
+	}
+
+	for (Crag::CragEdge e : crag.edges()) {
+
+		edgeFeatures.set(e, {crag.id(e.u())*1.0, crag.id(e.v())*1.0, 0.5});
+		costs.edge[e] = crag.id(e.u()) - crag.id(e.v());
+		solution.setSelected(e, (crag.id(e.u()) + crag.id(e.v()))%2 == 0);
+	}
+
+	FeatureWeights weights;
+	weights[Crag::VolumeNode]    = {1, 2};
+	weights[Crag::AdjacencyEdge] = {3, 4, 5};
+
+	{
+		BinaryCragStore store("binary_test.cmc");
+
+		store.saveCrag(crag);
+		store.saveVolumes(volumes);
+		store.saveNodeFeatures(crag, nodeFeatures);
+		store.saveEdgeFeatures(crag, edgeFeatures);
+		store.saveCosts(crag, costs, "costs");
+		store.saveSolution(crag, solution, "solution");
+		store.saveFeatureWeights(weights);
+
+		// overwriting a section appends a new copy of it
+		store.saveSolution(crag, solution, "solution");
+	}
+
+	// read back from a new store, such that everything comes from the file
+
+	BinaryCragStore store("binary_test.cmc");
+
+	Crag crag_;
+	CragVolumes volumes_(crag_);
+
+	store.retrieveCrag(crag_);
+	store.retrieveVolumes(volumes_);
+
+	NodeFeatures nodeFeatures_(crag_);
+	EdgeFeatures edgeFeatures_(crag_);
+	Costs        costs_(crag_);
+	CragSolution solution_(crag_);
+	FeatureWeights weights_;
+
+	store.retrieveNodeFeatures(crag_, nodeFeatures_);
+	store.retrieveEdgeFeatures(crag_, edgeFeatures_);
+	store.retrieveCosts(crag_, costs_, "costs");
+	store.retrieveSolution(crag_, solution_, "solution");
+	store.retrieveFeatureWeights(weights_);
+
+	BOOST_CHECK_EQUAL(crag_.numNodes(), crag.numNodes());
+	BOOST_CHECK_EQUAL(crag_.numEdges(), crag.numEdges());
+	BOOST_CHECK_EQUAL(crag_.numArcs(),  crag.numArcs());
+
+	for (Crag::CragNode n : crag.nodes()) {
+
+		Crag::CragNode n_ = crag_.nodeFromId(crag.id(n));
+
+		BOOST_CHECK_EQUAL(crag.isLeafNode(n), crag_.isLeafNode(n_));
+		BOOST_CHECK_EQUAL(crag.isRootNode(n), crag_.isRootNode(n_));
+		BOOST_CHECK(nodeFeatures[n] == nodeFeatures_[n_]);
+		BOOST_CHECK_EQUAL(costs.node[n], costs_.node[n_]);
+		BOOST_CHECK_EQUAL(solution.selected(n), solution_.selected(n_));
+
+		if (crag.isLeafNode(n)) {
+
+			std::shared_ptr<CragVolume> a = volumes[n];
+			std::shared_ptr<CragVolume> b = volumes_[n_];
+
+			BOOST_CHECK_EQUAL(a->getResolution(), b->getResolution());
+			BOOST_CHECK_EQUAL(a->getOffset(), b->getOffset());
+			BOOST_CHECK_EQUAL(a->getBoundingBox(), volumes_.getBoundingBox(n_));
+			BOOST_CHECK(a->data() == b->data());
+		}
+	}
+
+	for (Crag::CragEdge e : crag.edges()) {
+
+		Crag::CragEdge e_ = crag_.findEdge(
+				crag_.nodeFromId(crag.id(e.u())),
+				crag_.nodeFromId(crag.id(e.v())));
+
+		BOOST_REQUIRE(e_ != lemon::INVALID);
+		BOOST_CHECK(edgeFeatures[e] == edgeFeatures_[e_]);
+		BOOST_CHECK_EQUAL(costs.edge[e], costs_.edge[e_]);
+		BOOST_CHECK_EQUAL(solution.selected(e), solution_.selected(e_));
+	}
+
+	BOOST_CHECK(weights_[Crag::VolumeNode]    == weights[Crag::VolumeNode]);
+	BOOST_CHECK(weights_[Crag::AdjacencyEdge] == weights[Crag::AdjacencyEdge]);
+
+	BOOST_CHECK(store.getSolutionNames() == std::vector<std::string>(1, "solution"));
+	BOOST_CHECK(store.getCostsNames()    == std::vector<std::string>(1, "costs"));
+
+	// sections can be written incrementally
+	std::remove("binary_test.sections");
+
+	{
+		BinarySectionFile file("binary_test.sections");
+
+		BinarySectionFile::SectionWriter<int32_t> writer(file, "incremental", 2);
+		writer.append({1, 2});
+		writer.append({3, 4, 5, 6});
+
+		// not visible before it is finished
+		BOOST_CHECK(!file.exists("incremental"));
+		BOOST_CHECK_THROW(file.write("other", std::vector<int32_t>(1, 0)), UsageError);
+
+		writer.finish();
+
+		BinarySectionFile::View<int32_t> view = file.read<int32_t>("incremental");
+		BOOST_CHECK_EQUAL(view.size(), 6);
+		BOOST_CHECK_EQUAL(view.rows(), 3);
+		BOOST_CHECK_EQUAL(view.row(2)[1], 6);
+
+		file.write("other", std::vector<int32_t>(1, 0));
+
+		// removed sections stay removed when the file is opened again
+		file.remove("other");
+		BOOST_CHECK(!file.exists("other"));
+		BOOST_CHECK(!BinarySectionFile("binary_test.sections").exists("other"));
+		BOOST_CHECK(BinarySectionFile("binary_test.sections").exists("incremental"));
+
+		// replaced and removed sections are kept until the file is compacted
+		BOOST_CHECK(file.getUnusedSize() > 0);
+		uint64_t unused = file.getUnusedSize();
+		file.write("replaced", std::vector<int32_t>(100, 1));
+		BOOST_CHECK_EQUAL(file.getUnusedSize(), unused);
+		file.write("replaced", std::vector<int32_t>(100, 2));
+		BOOST_CHECK(file.getUnusedSize() > unused);
+
+		file.compact();
+
+		BOOST_CHECK_EQUAL(file.getUnusedSize(), 0);
+		BOOST_CHECK_EQUAL(file.read<int32_t>("replaced")[99], 2);
+		BOOST_CHECK_EQUAL(file.read<int32_t>("incremental").row(2)[1], 6);
+		BOOST_CHECK(!file.exists("other"));
+
+		BinarySectionFile reopened("binary_test.sections");
+		BOOST_CHECK_EQUAL(reopened.getUnusedSize(), 0);
+		BOOST_CHECK_EQUAL(reopened.read<int32_t>("replaced")[0], 2);
+	}
+
+	// a section header without a valid size is rejected
+	{
+		// magic of a section header, and zero data and end offsets
+		std::vector<unsigned char> header(64, 0);
+		header[0] = 'S'; header[1] = 'E'; header[2] = 'C'; header[3] = 'T';
+
+		FILE* f = std::fopen("binary_test.sections", "ab");
+		std::fwrite(header.data(), 1, header.size(), f);
+		std::fclose(f);
+	}
+
+	BOOST_CHECK_THROW(BinarySectionFile("binary_test.sections"), IOError);
+}
@@ -0,0 +1,39 @@
+#include <map>
+#include <tests.h>
+#include <io/LabelOverlap.h>
+
+void label_overlap() {
+
+	ExplicitVolume<int> a(50, 40, 10);
+	ExplicitVolume<int> b(50, 40, 10);
+
+	std::map<std::pair<int, int>, std::size_t> expected;
+
+	for (unsigned int z = 0; z < a.depth();  z++)
+	for (unsigned int y = 0; y < a.height(); y++)
+	for (unsigned int x = 0; x < a.width();  x++) {
+
+		int la = x/7 + 10*(y/5) + 100*z;
+		int lb = (rand()%4 == 0 ? 0 : x/13 + 5*(y/11));
+
+		a(x, y, z) = la;
+		b(x, y, z) = lb;
+
+		if (lb != 0)
+			expected[std::make_pair(la, lb)]++;
+	}
+
+	std::vector<LabelOverlap::Overlap> overlaps = LabelOverlap::count(a, b);
+
+	BOOST_REQUIRE_EQUAL(overlaps.size(), expected.size());
+
+	// overlaps are sorted the same way as the map
+	std::size_t i = 0;
+	for (const auto& p : expected) {
+
+		BOOST_CHECK_EQUAL(overlaps[i].a,    p.first.first);
+		BOOST_CHECK_EQUAL(overlaps[i].b,    p.first.second);
+		BOOST_CHECK_EQUAL(overlaps[i].size, p.second);
+		i++;
+	}
+}
@@ -0,0 +1,53 @@
+#include <cstdio>
+#include <fstream>
+#include <tests.h>
+#include <io/MergeHistory.h>
+
+void merge_history() {
+
+	std::vector<int32_t> merges = { 1, 2, 10,  3, 4, 11,  10, 11, 12 };
+	std::vector<float>   scores = { 0.5, 0.25, 2.0 };
+
+	MergeHistory::write("merge_history_test.bin", merges, scores);
+
+	{
+		BOOST_CHECK(MergeHistory::isBinary("merge_history_test.bin"));
+
+		MergeHistory history("merge_history_test.bin");
+
+		BOOST_REQUIRE_EQUAL(history.size(), 3);
+		BOOST_CHECK(history.hasScores());
+
+		for (std::size_t i = 0; i < history.size(); i++) {
+
+			BOOST_CHECK_EQUAL(history.a(i), merges[3*i]);
+			BOOST_CHECK_EQUAL(history.b(i), merges[3*i + 1]);
+			BOOST_CHECK_EQUAL(history.c(i), merges[3*i + 2]);
+			BOOST_CHECK_EQUAL(history.score(i), scores[i]);
+		}
+	}
+
+	// the same history as text
+	{
+		std::ofstream file("merge_history_test.txt");
+		for (std::size_t i = 0; i < scores.size(); i++)
+			file << merges[3*i] << " " << merges[3*i + 1] << " " << merges[3*i + 2] << " " << scores[i] << std::endl;
+	}
+
+	{
+		BOOST_CHECK(!MergeHistory::isBinary("merge_history_test.txt"));
+
+		MergeHistory history("merge_history_test.txt", true);
+
+		BOOST_REQUIRE_EQUAL(history.size(), 3);
+
+		for (std::size_t i = 0; i < history.size(); i++) {
+
+			BOOST_CHECK_EQUAL(history.c(i), merges[3*i + 2]);
+			BOOST_CHECK_EQUAL(history.score(i), scores[i]);
+		}
+	}
+
+	std::remove("merge_history_test.bin");
+	std::remove("merge_history_test.txt");
+}
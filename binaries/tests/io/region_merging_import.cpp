@@ -0,0 +1,113 @@
+#include <set>
+#include <tests.h>
+#include <crag/PlanarAdjacencyAnnotator.h>
+#include <io/CragImport.h>
+#include <mergetree/MedianEdgeIntensity.h>
+
+namespace region_merging_import_case {
+
+// import the supervoxels through region merging, and compare the leaf node
+// adjacency with the one found by PlanarAdjacencyAnnotator
+void
+checkImport(const ExplicitVolume<int>& supervoxels, bool background) {
+
+	ExplicitVolume<float> intensities(supervoxels.width(), supervoxels.height(), supervoxels.depth());
+
+	for (unsigned int z = 0; z < intensities.depth();  z++)
+	for (unsigned int y = 0; y < intensities.height(); y++)
+	for (unsigned int x = 0; x < intensities.width();  x++)
+		intensities(x, y, z) = static_cast<float>(rand())/RAND_MAX;
+
+	util::point<float, 3> resolution(1, 1, 1);
+	util::point<float, 3> offset(0, 0, 0);
+
+	Crag        crag;
+	CragVolumes volumes(crag);
+	Costs       mergeCosts(crag);
+
+	IterativeRegionMerging<3> merging(supervoxels.data());
+	MedianEdgeIntensity<3>    scoringFunction(intensities.data());
+
+	CragImport import;
+	import.readCragFromRegionMerging(
+			supervoxels,
+			merging,
+			scoringFunction,
+			crag,
+			volumes,
+			resolution,
+			offset,
+			mergeCosts);
+
+	// the same supervoxels with adjacency annotated from the volumes
+	Crag        leafCrag;
+	CragVolumes leafVolumes(leafCrag);
+	std::map<int, Crag::Node> idToNode = import.readSupervoxels(supervoxels, leafCrag, leafVolumes, resolution, offset);
+
+	PlanarAdjacencyAnnotator annotator(PlanarAdjacencyAnnotator::Direct);
+	annotator.annotate(leafCrag, leafVolumes);
+
+	// all supervoxels are merged into a single root, unless merges with the
+	// background are involved
+	if (!background)
+		BOOST_CHECK_EQUAL(crag.nodes().size(), 2*idToNode.size() - 1);
+
+	// affiliated edges are ids in the same grid
+	BOOST_CHECK(crag.getGridGraph().shape() == leafCrag.getGridGraph().shape());
+
+	typedef std::pair<int, int> Edge;
+	std::map<Edge, std::set<int64_t>> expected;
+	for (Crag::CragEdge e : leafCrag.edges())
+		for (const vigra::GridGraph<3>::Edge& edge : leafCrag.getAffiliatedEdges(e))
+			expected[Edge(
+					std::min(leafCrag.id(e.u()), leafCrag.id(e.v())),
+					std::max(leafCrag.id(e.u()), leafCrag.id(e.v())))].insert(
+					leafCrag.getGridGraph().id(edge));
+
+	std::size_t numLeafEdges = 0;
+	for (Crag::CragEdge e : crag.edges()) {
+
+		if (!crag.isLeafEdge(e))
+			continue;
+
+		Edge edge(
+				std::min(crag.id(e.u()), crag.id(e.v())),
+				std::max(crag.id(e.u()), crag.id(e.v())));
+
+		std::set<int64_t> ids;
+		for (const vigra::GridGraph<3>::Edge& gridEdge : crag.getAffiliatedEdges(e))
+			ids.insert(crag.getGridGraph().id(gridEdge));
+
+		BOOST_REQUIRE(expected.count(edge));
+		BOOST_CHECK(ids == expected[edge]);
+		numLeafEdges++;
+	}
+
+	BOOST_CHECK_EQUAL(numLeafEdges, expected.size());
+}
+
+} using namespace region_merging_import_case;
+
+void region_merging_import() {
+
+	ExplicitVolume<int> supervoxels(30, 20, 4);
+
+	for (unsigned int z = 0; z < supervoxels.depth();  z++)
+	for (unsigned int y = 0; y < supervoxels.height(); y++)
+	for (unsigned int x = 0; x < supervoxels.width();  x++)
+		supervoxels(x, y, z) = 1 + x/7 + 5*(y/6) + 20*(z/2);
+
+	checkImport(supervoxels, false);
+
+	// the same supervoxels, surrounded by a border of background, which is
+	// not part of the CRAG grid
+	ExplicitVolume<int> bordered(supervoxels.width() + 4, supervoxels.height() + 4, supervoxels.depth() + 2);
+	bordered.data() = 0;
+
+	for (unsigned int z = 0; z < supervoxels.depth();  z++)
+	for (unsigned int y = 0; y < supervoxels.height(); y++)
+	for (unsigned int x = 0; x < supervoxels.width();  x++)
+		bordered(x + 2, y + 2, z + 1) = supervoxels(x, y, z);
+
+	checkImport(bordered, true);
+}
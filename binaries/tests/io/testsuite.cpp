@@ -3,6 +3,11 @@
 BEGIN_TEST_SUITE(io)
 
 	ADD_TEST_CASE(io_feature_weights)
+	ADD_TEST_CASE(binary_crag_store)
+	ADD_TEST_CASE(volume_store_roi)
+	ADD_TEST_CASE(label_overlap)
+	ADD_TEST_CASE(merge_history)
+	ADD_TEST_CASE(region_merging_import)
 
 END_TEST_SUITE()
 
@@ -0,0 +1,42 @@
+#include <cstdio>
+#include <tests.h>
+#include <io/Hdf5VolumeStore.h>
+
+void volume_store_roi() {
+
+	std::remove("volume_store_test.hdf");
+
+	// larger than one chunk in x, to read across chunk borders
+	ExplicitVolume<float> intensities(300, 20, 10);
+	intensities.setResolution(1.0, 2.0, 3.0);
+	intensities.setOffset(10.0, 20.0, 30.0);
+
+	for (int z = 0; z < 10; z++)
+		for (int y = 0; y < 20; y++)
+			for (int x = 0; x < 300; x++)
+				intensities(x, y, z) = x + 1000*y + 100000*z;
+
+	Hdf5VolumeStore store("volume_store_test.hdf");
+	store.saveIntensities(intensities);
+
+	util::box<unsigned int, 3> roi(250, 5, 2, 270, 15, 4);
+
+	// read twice, the second time from the cache
+	for (int i = 0; i < 2; i++) {
+
+		ExplicitVolume<float> block;
+		store.retrieveIntensities(block, roi);
+
+		BOOST_CHECK_EQUAL(block.width(),  20);
+		BOOST_CHECK_EQUAL(block.height(), 10);
+		BOOST_CHECK_EQUAL(block.depth(),   2);
+		BOOST_CHECK_EQUAL(block.getOffset().x(), 260.0);
+		BOOST_CHECK_EQUAL(block.getOffset().y(),  30.0);
+		BOOST_CHECK_EQUAL(block.getOffset().z(),  36.0);
+
+		for (int z = 0; z < 2; z++)
+			for (int y = 0; y < 10; y++)
+				for (int x = 0; x < 20; x++)
+					BOOST_CHECK_EQUAL(block(x, y, z), intensities(250 + x, 5 + y, 2 + z));
+	}
+}
@@ -1,10 +1,23 @@
+#include <algorithm>
 #include <util/Logger.h>
 #include <util/helpers.hpp>
 #include <util/ProgramOptions.h>
+#include <util/timing.h>
 #include "AdjacencyAnnotator.h"
+#include "CragCsr.h"
+#include "CragHierarchyIndex.h"
+#include "Parallel.h"
 
 logger::LogChannel adjacencyannotatorlog("adjacencyannotatorlog", "[AdjacencyAnnotator] ");
 
+util::ProgramOption optionCragType(
+		util::_long_name        = "cragType",
+		util::_description_text = "Controls which candidates are considered for adjacency in the CRAG: "
+		                          "'full' adds edges between each adjacent candidate across all levels, "
+		                          "'flat' adds edges only between leaf nodes, and 'empty' adds no adjacency "
+		                          "edges at all. Default is 'full'.",
+		util::_default_value    = "full");
+
 util::ProgramOption optionPruneChildEdges(
 		util::_long_name        = "pruneChildEdges",
 		util::_description_text = "For binary trees, remove adjacency edges between children, since the "
@@ -14,70 +27,132 @@ util::ProgramOption optionPruneChildEdges(
 void
 AdjacencyAnnotator::propagateLeafAdjacencies(Crag& crag) {
 
-	_numAdded = 0;
-	for (Crag::CragNode n : crag.nodes())
-		if (crag.isRootNode(n))
-			recurseAdjacencies(crag, n);
+	UTIL_TIME_METHOD;
 
-	if (optionPruneChildEdges)
-		pruneChildEdges(crag);
+	// snapshots of the subset trees and the leaf adjacencies, the CRAG is only 
+	// modified after all propagated edges have been found
+	CragHierarchyIndex index(crag);
+	CragCsr            csr(crag);
 
-	LOG_USER(adjacencyannotatorlog)
-			<< "added " << _numAdded << " super node adjacency edges"
-			<< std::endl;
-}
+	const int numNodes = index.numNodes();
 
-std::set<Crag::CragNode>
-AdjacencyAnnotator::recurseAdjacencies(Crag& crag, Crag::CragNode n) {
+	// by post-order rank: the parent, the rank of the first descendant (the 
+	// descendants of a node are the ranks [firstDescendant, rank]), and whether 
+	// the node is a leaf
+	std::vector<int>  parents(numNodes, -1);
+	std::vector<int>  firstDescendants(numNodes);
+	std::vector<char> leaves(numNodes);
+	std::vector<int>  roots;
 
-	LOG_ALL(adjacencyannotatorlog) << "recursing into node " << crag.id(n) << std::endl;
+	for (int r = 0; r < numNodes; r++) {
 
-	// get all leaf subnodes
-	std::set<Crag::CragNode> subnodes;
-	for (Crag::CragArc a : crag.inArcs(n)) {
+		Crag::CragNode n = index.nodeAtRank(r);
+		int            i = csr.index(n);
 
-		std::set<Crag::CragNode> a_subnodes = recurseAdjacencies(crag, a.source());
+		if (csr.parents(i).size() > 1)
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"leaf adjacencies can only be propagated in subset trees, node " <<
+					crag.id(n) << " has more than one parent");
 
-		for (Crag::CragNode s : a_subnodes)
-			subnodes.insert(s);
+		if (csr.parents(i).size() == 1)
+			parents[r] = index.rank(csr.node(csr.parents(i)[0]));
+		else
+			roots.push_back(r);
+
+		firstDescendants[r] = index.descendantIntervals(n).begin()->begin;
+		leaves[r] = csr.isLeafNode(i);
 	}
 
-	// for each leaf subnode adjacent to a non-subnode, add an adjacency edge to 
-	// the non-subnode
-	std::set<Crag::CragNode> neighbors;
+	// for each node, the ranks of the nodes outside of its subtree and 
+	// ancestors that contain a leaf adjacent to one of its leaves
+	std::vector<std::vector<int>> adjacent(numNodes);
+
+	// for each node, the ids of the nodes to connect it to
+	std::vector<std::vector<int>> neighbors(numNodes);
+
+	// subset trees are independent, each is processed bottom-up in post-order
+	parallelFor(roots.size(), [&](std::size_t t) {
+
+		int root = roots[t];
+
+		for (int r = firstDescendants[root]; r <= root; r++) {
+
+			std::vector<int>& a = adjacent[r];
+
+			if (leaves[r]) {
+
+				// the adjacent leaves and their ancestors, up to the first 
+				// common ancestor
+				for (int neighbor : csr.neighbors(csr.index(index.nodeAtRank(r)))) {
 
-	LOG_ALL(adjacencyannotatorlog) << "subnodes of " << crag.id(n) << " are:" << std::endl;
-	for (Crag::CragNode s : subnodes) {
+					int m = index.rank(csr.node(neighbor));
+					while (m >= 0 && !(firstDescendants[m] <= r && r <= m)) {
 
-		LOG_ALL(adjacencyannotatorlog) << "\t" << crag.id(s) << std::endl;
+						a.push_back(m);
+						m = parents[m];
+					}
+				}
 
-		for (Crag::CragEdge e : crag.adjEdges(s)) {
+				std::sort(a.begin(), a.end());
+				a.erase(std::unique(a.begin(), a.end()), a.end());
 
-			Crag::CragNode neighbor = e.opposite(s);
+				continue;
+			}
 
-			// not a subnode
-			if (!subnodes.count(neighbor))
-				neighbors.insert(neighbor);
+			// the union of the children's sets, without the descendants of r
+			for (int child : csr.children(csr.index(index.nodeAtRank(r)))) {
+
+				std::vector<int>& c = adjacent[index.rank(csr.node(child))];
+				a.insert(a.end(), c.begin(), c.end());
+				std::vector<int>().swap(c);
+			}
+
+			std::sort(a.begin(), a.end());
+			a.erase(std::unique(a.begin(), a.end()), a.end());
+			a.erase(
+					std::remove_if(
+							a.begin(), a.end(),
+							[&](int m) { return firstDescendants[r] <= m && m <= r; }),
+					a.end());
+
+			// connect to leaves and to nodes earlier in post-order, nodes later 
+			// in post-order connect to this one
+			std::vector<int>& ids = neighbors[r];
+			for (int m : a)
+				if (leaves[m] || m < r)
+					ids.push_back(crag.id(index.nodeAtRank(m)));
+
+			std::sort(ids.begin(), ids.end());
 		}
-	}
 
-	for (Crag::CragNode neighbor : neighbors) {
+		std::vector<int>().swap(adjacent[root]);
+	});
+
+	_numAdded = 0;
+	for (int r = 0; r < numNodes; r++) {
 
-		LOG_ALL(adjacencyannotatorlog)
-				<< "adding propagated edge between "
-				<< crag.id(n) << " and " << crag.id(neighbor)
-				<< std::endl;
+		Crag::CragNode n = index.nodeAtRank(r);
 
-		crag.addAdjacencyEdge(n, neighbor);
-	}
+		for (int id : neighbors[r]) {
 
-	_numAdded += neighbors.size();
+			LOG_ALL(adjacencyannotatorlog)
+					<< "adding propagated edge between "
+					<< crag.id(n) << " and " << id
+					<< std::endl;
 
-	subnodes.insert(n);
+			crag.addAdjacencyEdge(n, crag.nodeFromId(id));
+		}
+
+		_numAdded += neighbors[r].size();
+	}
 
-	LOG_ALL(adjacencyannotatorlog) << "leaving node " << crag.id(n) << std::endl;
+	if (optionPruneChildEdges)
+		pruneChildEdges(crag);
 
-	return subnodes;
+	LOG_USER(adjacencyannotatorlog)
+			<< "added " << _numAdded << " super node adjacency edges"
+			<< std::endl;
 }
 
 void
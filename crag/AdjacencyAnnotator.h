@@ -3,6 +3,9 @@
 
 #include "Crag.h"
 #include "CragVolumes.h"
+#include <util/ProgramOptions.h>
+
+extern util::ProgramOption optionCragType;
 
 /**
  * Base class for adjacency annotators.
@@ -19,17 +22,16 @@ protected:
 	 * Propagate adjacency of leaf candidates in a straight forward manner to 
 	 * super-candidates: Candidates are adjacent, if any of their sub-candidates 
 	 * are adjacent.
+	 *
+	 * The subset graph has to be a forest. The subset trees are processed in 
+	 * parallel, each in a single bottom-up sweep that merges sorted lists of 
+	 * adjacent candidates. The edges are added in post-order of the subset 
+	 * trees.
 	 */
 	void propagateLeafAdjacencies(Crag& crag);
 
 private:
 
-	/**
-	 * Find propagated edges for node n and below. Returns the set of 
-	 * descendants of n (including n).
-	 */
-	std::set<Crag::CragNode> recurseAdjacencies(Crag& crag, Crag::CragNode n);
-
 	/**
 	 * For binary trees, remove adjacency edges between children, since the 
 	 * merge represented by those is already performed by selecting the parent 
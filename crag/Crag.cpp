@@ -1,4 +1,5 @@
 #include "Crag.h"
+#include "CragHierarchyIndex.h"
 #include <util/assert.h>
 
 Crag::CragNode Crag::Invalid;
@@ -6,24 +7,140 @@ Crag::CragNode Crag::Invalid;
 const std::vector<Crag::NodeType> Crag::NodeTypes = { VolumeNode, SliceNode, AssignmentNode, NoAssignmentNode };
 const std::vector<Crag::EdgeType> Crag::EdgeTypes = { AdjacencyEdge, SeparationEdge, AssignmentEdge, NoAssignmentEdge };
 
-int
-Crag::getLevel(Crag::CragNode n) const {
+Crag::Crag() :
+	_nodeTypes(_rag),
+	_edgeTypes(_rag),
+	_affiliatedEdgeSpans(_rag),
+	_numReleasedAffiliatedEdgeIds(0),
+	_hierarchyIndex(nullptr),
+	_edgeIndexValid(false) {}
+
+Crag::~Crag() {
+
+	delete _hierarchyIndex.load();
+}
+
+const CragHierarchyIndex&
+Crag::getHierarchyIndex() const {
+
+	// the common case: the index exists already, no need to lock
+	CragHierarchyIndex* index = _hierarchyIndex.load(std::memory_order_acquire);
+	if (index)
+		return *index;
+
+	std::lock_guard<std::mutex> lock(_hierarchyIndexMutex);
+
+	index = _hierarchyIndex.load(std::memory_order_relaxed);
+	if (!index) {
+
+		index = new CragHierarchyIndex(*this);
+		_hierarchyIndex.store(index, std::memory_order_release);
+	}
+
+	return *index;
+}
+
+void
+Crag::invalidateHierarchyIndex() {
+
+	delete _hierarchyIndex.exchange(nullptr);
+}
 
-	if (isLeafNode(n))
-		return 0;
+Crag::CragEdge
+Crag::findEdge(CragNode u, CragNode v) const {
 
-	int level = 0;
-	for (SubsetInArcIt e(getSubsetGraph(), toSubset(n)); e != lemon::INVALID; ++e)
-		level = std::max(getLevel(toRag(getSubsetGraph().source(e))), level);
+	if (!_edgeIndexValid.load(std::memory_order_acquire)) {
 
-	return level + 1;
+		std::lock_guard<std::mutex> lock(_edgeIndexMutex);
+
+		if (!_edgeIndexValid.load(std::memory_order_relaxed)) {
+
+			_edgeIndex.clear();
+			_edgeIndex.reserve(numEdges());
+
+			for (EdgeIt e(_rag); e != lemon::INVALID; ++e)
+				_edgeIndex.emplace(edgeKey(_rag.u(e), _rag.v(e)), e);
+
+			_edgeIndexValid.store(true, std::memory_order_release);
+		}
+	}
+
+	auto i = _edgeIndex.find(edgeKey(u, v));
+
+	if (i == _edgeIndex.end())
+		return CragEdge(*this, lemon::INVALID);
+
+	return CragEdge(*this, i->second);
+}
+
+void
+Crag::invalidateEdgeIndex() {
+
+	_edgeIndexValid = false;
+	_edgeIndex.clear();
+}
+
+void
+Crag::removeFromEdgeIndex(CragEdge e) {
+
+	Node u = e.u();
+	Node v = e.v();
+
+	auto i = _edgeIndex.find(edgeKey(u, v));
+	if (i == _edgeIndex.end() || i->second != e)
+		return;
+
+	_edgeIndex.erase(i);
+
+	// there might be a parallel edge that takes its place
+	for (IncEdgeIt f(_rag, u); f != lemon::INVALID; ++f)
+		if (f != e && _rag.oppositeNode(u, f) == v) {
+
+			_edgeIndex.emplace(edgeKey(u, v), f);
+			break;
+		}
+}
+
+void
+Crag::compactAffiliatedEdgesIfSparse() {
+
+	// don't bother for small arenas
+	if (_numReleasedAffiliatedEdgeIds < MinReleasedAffiliatedEdgeIds ||
+	    2*_numReleasedAffiliatedEdgeIds <= _affiliatedEdgeIds.size())
+		return;
+
+	std::vector<int64_t> ids;
+	ids.reserve(_affiliatedEdgeIds.size() - _numReleasedAffiliatedEdgeIds);
+
+	for (EdgeIt e(_rag); e != lemon::INVALID; ++e) {
+
+		IdSpan& span = _affiliatedEdgeSpans[e];
+
+		std::size_t begin = ids.size();
+		ids.insert(
+				ids.end(),
+				_affiliatedEdgeIds.begin() + span.begin,
+				_affiliatedEdgeIds.begin() + span.end);
+
+		span.begin = begin;
+		span.end   = ids.size();
+	}
+
+	_affiliatedEdgeIds.swap(ids);
+	_numReleasedAffiliatedEdgeIds = 0;
+}
+
+int
+Crag::getLevel(Crag::CragNode n) const {
+
+	return getHierarchyIndex().level(n);
 }
 
 std::set<Crag::CragNode>
 Crag::leafNodes(CragNode n) const {
 
 	std::set<CragNode> leafNodes;
-	recLeafNodes(n, leafNodes);
+	getHierarchyIndex().forEachLeafNode(n, [&](CragNode l) { leafNodes.insert(l); });
 
 	return leafNodes;
 }
@@ -31,20 +148,15 @@ Crag::leafNodes(CragNode n) const {
 std::set<Crag::CragEdge>
 Crag::leafEdges(CragNode n) const {
 
-	std::set<CragNode> nleafNodes = leafNodes(n);
+	const CragHierarchyIndex& index = getHierarchyIndex();
 	std::set<CragEdge> leafEdges;
 
-	for (CragNode u : nleafNodes)
-		for (CragNode v : nleafNodes) {
+	index.forEachLeafNode(n, [&](CragNode u) {
 
-			if (id(u) >= id(v))
-				continue;
-
-			for (CragEdge e : adjEdges(u))
-				if (isLeafEdge(e))
-					if (nleafNodes.count(oppositeNode(u, e)))
-						leafEdges.insert(e);
-		}
+		for (CragEdge e : adjEdges(u))
+			if (index.isLeafDescendant(oppositeNode(u, e), n))
+				leafEdges.insert(e);
+	});
 
 	return leafEdges;
 }
@@ -52,18 +164,16 @@ Crag::leafEdges(CragNode n) const {
 std::set<Crag::CragEdge>
 Crag::leafEdges(CragEdge e) const {
 
+	const CragHierarchyIndex& index = getHierarchyIndex();
 	std::set<CragEdge> leafEdges;
-	std::set<CragNode> uLeafNodes;
-	std::set<CragNode> vLeafNodes;
+	CragNode v = e.v();
 
-	recLeafNodes(u(e), uLeafNodes);
-	recLeafNodes(v(e), vLeafNodes);
+	index.forEachLeafNode(e.u(), [&](CragNode n) {
 
-	for (CragNode n : uLeafNodes)
-		for (CragEdge e : adjEdges(n))
-			if (isLeafEdge(e))
-				if (vLeafNodes.count(oppositeNode(n, e)))
-					leafEdges.insert(e);
+		for (CragEdge f : adjEdges(n))
+			if (index.isLeafDescendant(oppositeNode(n, f), v))
+				leafEdges.insert(f);
+	});
 
 	return leafEdges;
 }
@@ -80,36 +190,18 @@ Crag::descendantEdges(CragEdge e) const {
 std::set<Crag::CragEdge>
 Crag::descendantEdges(CragNode u, CragNode v) const {
 
-	std::set<CragEdge> uEdges;
-	std::set<CragEdge> vEdges;
-	recCollectEdges(u, uEdges);
-	recCollectEdges(v, vEdges);
-
+	const CragHierarchyIndex& index = getHierarchyIndex();
 	std::set<CragEdge> descendants;
-	std::set_intersection(
-		uEdges.begin(), uEdges.end(),
-		vEdges.begin(), vEdges.end(),
-		std::inserter(descendants, descendants.end()));
 
-	return descendants;
-}
+	// all edges that are incident to a descendant of u and a descendant of v
+	index.forEachDescendant(u, [&](CragNode a) {
 
-void
-Crag::recLeafNodes(CragNode n, std::set<CragNode>& leafNodes) const {
+		bool aUnderV = index.isDescendant(a, v);
 
-	if (isLeafNode(n))
-		leafNodes.insert(n);
-	else
-		for (auto a : inArcs(n))
-			recLeafNodes(a.source(), leafNodes);
-}
+		for (CragEdge e : adjEdges(a))
+			if (aUnderV || index.isDescendant(oppositeNode(a, e), v))
+				descendants.insert(e);
+	});
 
-void
-Crag::recCollectEdges(Crag::CragNode n, std::set<Crag::CragEdge>& edges) const {
-
-	for (Crag::CragEdge e : adjEdges(n))
-		edges.insert(e);
-
-	for (Crag::CragArc a : inArcs(n))
-		recCollectEdges(a.source(), edges);
+	return descendants;
 }
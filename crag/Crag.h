@@ -1,12 +1,20 @@
 #ifndef CANDIDATE_MC_CRAG_CRAG_H__
 #define CANDIDATE_MC_CRAG_CRAG_H__
 
+#include <algorithm>
+#include <atomic>
 #include <set>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <lemon/list_graph.h>
 #define WITH_LEMON
 #include <vigra/multi_gridgraph.hxx>
 #include <util/exceptions.h>
 
+class CragHierarchyIndex;
+
 /**
  * Candidate region adjacency graph.
  *
@@ -16,6 +24,12 @@
  * Each node and adjacency edge has a type (which defaults to Volume and 
  * Adjacency, respectively) which can be used to specialize feature extraction 
  * and solvers.
+ *
+ * Concurrent read-only access is safe: Any number of threads can call const 
+ * methods (including the lazily created indices of getHierarchyIndex() and 
+ * findEdge()) and read from node and edge maps, as long as no thread modifies 
+ * the CRAG or writes to the same map entries. Use CragPartitioner to split 
+ * nodes and edges for parallel processing.
  */
 class Crag {
 
@@ -229,6 +243,30 @@ public:
 			return _edge < other._edge;
 		}
 
+		bool operator==(const CragEdge& other) const {
+
+			return _edge == other._edge;
+		}
+
+		bool operator!=(const CragEdge& other) const {
+
+			return _edge != other._edge;
+		}
+
+		/**
+		 * Comparison with lemon::INVALID, to check the result of 
+		 * Crag::findEdge().
+		 */
+		bool operator==(lemon::Invalid) const {
+
+			return _edge == lemon::INVALID;
+		}
+
+		bool operator!=(lemon::Invalid) const {
+
+			return _edge != lemon::INVALID;
+		}
+
 		/**
 		 * Implicit conversion operator to an edge of the lemon region adjacency 
 		 * graph. Provided for convenience, such that this edge can be used as 
@@ -241,14 +279,80 @@ public:
 		}
 	};
 
+	/**
+	 * A read-only view on the affiliated edges of a leaf edge. The edges are 
+	 * stored as ids of the grid graph and converted on access. Views are 
+	 * invalidated by setting affiliated edges and by erasing nodes or edges.
+	 */
+	class AffiliatedEdges {
+
+	public:
+
+		class iterator : public std::iterator<std::input_iterator_tag, vigra::GridGraph<3>::Edge> {
+
+		public:
+
+			iterator(const vigra::GridGraph<3>& gridGraph, const int64_t* id) :
+				_gridGraph(&gridGraph),
+				_id(id) {}
+
+			vigra::GridGraph<3>::Edge operator*() const {
+
+				return _gridGraph->edgeFromId(*_id);
+			}
+
+			iterator& operator++() {
+
+				++_id;
+				return *this;
+			}
+
+			iterator operator++(int) {
+
+				iterator tmp(*this);
+				++_id;
+				return tmp;
+			}
+
+			bool operator==(const iterator& other) const { return _id == other._id; }
+			bool operator!=(const iterator& other) const { return _id != other._id; }
+
+		private:
+
+			const vigra::GridGraph<3>* _gridGraph;
+			const int64_t*             _id;
+		};
+
+		AffiliatedEdges(const vigra::GridGraph<3>& gridGraph, const int64_t* begin, const int64_t* end) :
+			_gridGraph(gridGraph),
+			_begin(begin),
+			_end(end) {}
+
+		iterator begin() const { return iterator(_gridGraph, _begin); }
+		iterator end()   const { return iterator(_gridGraph, _end); }
+
+		std::size_t size() const { return _end - _begin; }
+
+		bool empty() const { return _begin == _end; }
+
+		/**
+		 * Direct access to the grid graph edge ids.
+		 */
+		const int64_t* beginIds() const { return _begin; }
+		const int64_t* endIds()   const { return _end; }
+
+	private:
+
+		const vigra::GridGraph<3>& _gridGraph;
+		const int64_t*             _begin;
+		const int64_t*             _end;
+	};
+
 	#include "CragIterators.h"
 
-	Crag() :
-		_nodeTypes(_rag),
-		_edgeTypes(_rag),
-		_affiliatedEdges(_rag) {}
+	Crag();
 
-	virtual ~Crag() {}
+	virtual ~Crag();
 
 	/**
 	 * Add a node to the CRAG.
@@ -259,6 +363,8 @@ public:
 		CragNode n = _rag.addNode();
 		_nodeTypes[n] = type;
 
+		invalidateHierarchyIndex();
+
 		return n;
 	}
 	inline CragNode addNode() { return addNode(VolumeNode); }
@@ -268,8 +374,19 @@ public:
 	 */
 	inline void erase(Crag::CragNode n) {
 
+		for (IncEdgeIt e(_rag, n); e != lemon::INVALID; ++e) {
+
+			if (_edgeIndexValid)
+				_edgeIndex.erase(edgeKey(_rag.u(e), _rag.v(e)));
+
+			releaseAffiliatedEdges(e);
+		}
+
 		_ssg.erase(toSubset(n));
 		_rag.erase(n);
+
+		invalidateHierarchyIndex();
+		compactAffiliatedEdgesIfSparse();
 	}
 
 	/**
@@ -277,7 +394,14 @@ public:
 	 */
 	inline void erase(Crag::CragEdge e) {
 
+		if (_edgeIndexValid)
+			removeFromEdgeIndex(e);
+
+		releaseAffiliatedEdges(e);
+
 		_rag.erase(e);
+
+		compactAffiliatedEdgesIfSparse();
 	}
 
 	/**
@@ -286,6 +410,8 @@ public:
 	inline void erase(Crag::CragArc a) {
 
 		_ssg.erase(a);
+
+		invalidateHierarchyIndex();
 	}
 
 	/**
@@ -297,6 +423,13 @@ public:
 		CragEdge e(*this, _rag.addEdge(u, v));
 		_edgeTypes[e] = type;
 
+		// the id of e might have been used by an erased edge before
+		_affiliatedEdgeSpans[e] = IdSpan();
+
+		// keep the first edge between u and v, in case there are several
+		if (_edgeIndexValid)
+			_edgeIndex.emplace(edgeKey(u, v), e);
+
 		return e;
 	}
 	inline CragEdge addAdjacencyEdge(CragNode u, CragNode v) { return addAdjacencyEdge(u, v, AdjacencyEdge); }
@@ -307,9 +440,19 @@ public:
 	 */
 	inline CragArc addSubsetArc(CragNode u, CragNode v) {
 
+		invalidateHierarchyIndex();
+
 		return CragArc(*this, _ssg.addArc(toSubset(u), toSubset(v)));
 	}
 
+	/**
+	 * Reserve memory in the underlying graphs for the given total number of 
+	 * nodes, adjacency edges, and subset arcs.
+	 */
+	inline void reserveNodes(std::size_t numNodes) { _rag.reserveNode(numNodes); _ssg.reserveNode(numNodes); }
+	inline void reserveEdges(std::size_t numEdges) { _rag.reserveEdge(numEdges); }
+	inline void reserveArcs(std::size_t numArcs)   { _ssg.reserveArc(numArcs); }
+
 	CragNodes nodes() const { return CragNodes(*this); }
 
 	CragEdges edges() const { return CragEdges(*this); }
@@ -340,6 +483,15 @@ public:
 		return CragIncEdges(*this, n);
 	}
 
+	/**
+	 * Find the adjacency edge between u and v. Returns an edge that compares 
+	 * equal to lemon::INVALID, if there is none. The lookup uses a hash index, 
+	 * which is created on first use and kept up-to-date by addAdjacencyEdge() 
+	 * and erase(). Like getHierarchyIndex(), this method can be called from 
+	 * several threads concurrently, as long as the CRAG does not get modified.
+	 */
+	CragEdge findEdge(CragNode u, CragNode v) const;
+
 	/**
 	 * Get the type of a node.
 	 */
@@ -352,7 +504,8 @@ public:
 
 	/**
 	 * Set the grid graph, to which the affiliated edges between leaf node 
-	 * regions refer.
+	 * regions refer. Affiliated edges are stored as ids of this grid graph, 
+	 * the grid graph should therefore be set before any affiliated edges.
 	 */
 	void setGridGraph(const vigra::GridGraph<3>& gridGraph) {
 
@@ -365,30 +518,83 @@ public:
 	 */
 	void setAffiliatedEdges(CragEdge e, const std::vector<vigra::GridGraph<3>::Edge>& edges) {
 
+		std::vector<int64_t> ids;
+		ids.reserve(edges.size());
+		for (const vigra::GridGraph<3>::Edge& edge : edges)
+			ids.push_back(_gridGraph.id(edge));
+
+		setAffiliatedEdgeIds(e, ids.data(), ids.data() + ids.size());
+	}
+
+	/**
+	 * Same as setAffiliatedEdges, but for a range of grid graph edge ids. The 
+	 * previous affiliated edges of e are overwritten in place if the new ones 
+	 * fit, otherwise they are appended and the old ones are released.
+	 */
+	void setAffiliatedEdgeIds(CragEdge e, const int64_t* begin, const int64_t* end) {
+
 		if (!isLeafEdge(e))
 			UTIL_THROW_EXCEPTION(UsageError, "affiliated edges can only be set for leaf edges");
-		 _affiliatedEdges[e] = edges;
+
+		IdSpan&     span = _affiliatedEdgeSpans[e];
+		std::size_t size = end - begin;
+
+		if (size <= span.end - span.begin) {
+
+			std::copy(begin, end, _affiliatedEdgeIds.begin() + span.begin);
+			_numReleasedAffiliatedEdgeIds += (span.end - span.begin) - size;
+			span.end = span.begin + size;
+
+		} else {
+
+			_numReleasedAffiliatedEdgeIds += span.end - span.begin;
+			span.begin = _affiliatedEdgeIds.size();
+			_affiliatedEdgeIds.insert(_affiliatedEdgeIds.end(), begin, end);
+			span.end = _affiliatedEdgeIds.size();
+		}
+
+		compactAffiliatedEdgesIfSparse();
+	}
+
+	/**
+	 * Reserve memory for the given number of affiliated edges to be added.
+	 */
+	void reserveAffiliatedEdges(std::size_t numAffiliatedEdges) {
+
+		_affiliatedEdgeIds.reserve(_affiliatedEdgeIds.size() + numAffiliatedEdges);
 	}
 
 	/**
 	 * Get affiliated edges for a leaf edge.
 	 */
-	const std::vector<vigra::GridGraph<3>::Edge>& getAffiliatedEdges(CragEdge e) const {
+	AffiliatedEdges getAffiliatedEdges(CragEdge e) const {
 
 		if (!isLeafEdge(e))
 			UTIL_THROW_EXCEPTION(UsageError, "affiliated edges only set for leaf edges");
-		return _affiliatedEdges[e];
+
+		const IdSpan& span = _affiliatedEdgeSpans[e];
+		const int64_t* ids = _affiliatedEdgeIds.data();
+
+		return AffiliatedEdges(_gridGraph, ids + span.begin, ids + span.end);
 	}
 
 	const vigra::GridGraph<3>& getGridGraph() const { return _gridGraph; }
 
 	/**
-	 * Get direct access to the underlying lemon graphs.
+	 * Get read-only access to the underlying lemon graphs. The CRAG can only 
+	 * be modified through its own methods (addNode(), addSubsetArc(), erase(), 
+	 * ...), which keep the hierarchy and edge indices up-to-date.
 	 */
 	const lemon::ListGraph&   getAdjacencyGraph() const { return _rag; }
-	      lemon::ListGraph&   getAdjacencyGraph()       { return _rag; }
 	const lemon::ListDigraph& getSubsetGraph()    const { return _ssg; }
-	      lemon::ListDigraph& getSubsetGraph()          { return _ssg; }
+
+	/**
+	 * Get an index of the subset hierarchy. The index is created on first 
+	 * access and kept until the next modification of the subset graph. It is 
+	 * safe to call this method from several threads concurrently, as long as 
+	 * the CRAG does not get modified.
+	 */
+	const CragHierarchyIndex& getHierarchyIndex() const;
 
 	/**
 	 * Get the level of a node, i.e., the size of the longest subset-tree path 
@@ -416,9 +622,7 @@ public:
 	 * creation.
 	 */
 	operator const RagType& ()    const { return _rag; }
-	operator       RagType& ()          { return _rag; }
 	operator const SubsetType& () const { return _ssg; }
-	operator       SubsetType& ()       { return _ssg; }
 
 	inline Node u(Edge e) const { return _rag.u(e); }
 	inline Node v(Edge e) const { return _rag.v(e); }
@@ -515,9 +719,35 @@ public:
 
 private:
 
-	void recLeafNodes(CragNode n, std::set<CragNode>& leafNodes) const;
+	void invalidateHierarchyIndex();
+
+	void invalidateEdgeIndex();
+
+	void removeFromEdgeIndex(CragEdge e);
+
+	// mark the affiliated edge ids of e as unused
+	inline void releaseAffiliatedEdges(Edge e) {
+
+		IdSpan& span = _affiliatedEdgeSpans[e];
+		_numReleasedAffiliatedEdgeIds += span.end - span.begin;
+		span = IdSpan();
+	}
+
+	// remove unused ids from _affiliatedEdgeIds, if they make up more than 
+	// half of it
+	void compactAffiliatedEdgesIfSparse();
 
-	void recCollectEdges(Crag::CragNode n, std::set<Crag::CragEdge>& edges) const;
+	// key of an edge in the edge index, independent of the order of u and v
+	inline uint64_t edgeKey(Node u, Node v) const {
+
+		uint64_t a = _rag.id(u);
+		uint64_t b = _rag.id(v);
+
+		if (a > b)
+			std::swap(a, b);
+
+		return (a << 32) | b;
+	}
 
 	// adjacency graph
 	lemon::ListGraph _rag;
@@ -531,8 +761,35 @@ private:
 
 	vigra::GridGraph<3> _gridGraph;
 
-	// voxel edges between adjacent leaf nodes
-	EdgeMap<std::vector<vigra::GridGraph<3>::Edge>> _affiliatedEdges;
+	// a range [begin, end) in _affiliatedEdgeIds
+	struct IdSpan {
+
+		IdSpan() : begin(0), end(0) {}
+
+		std::size_t begin;
+		std::size_t end;
+	};
+
+	// voxel edges between adjacent leaf nodes, as ids of _gridGraph, stored 
+	// consecutively for each adjacency edge
+	std::vector<int64_t> _affiliatedEdgeIds;
+	EdgeMap<IdSpan>      _affiliatedEdgeSpans;
+
+	// the number of ids in _affiliatedEdgeIds that are not used by any edge
+	std::size_t _numReleasedAffiliatedEdgeIds;
+
+	// the number of unused ids below which _affiliatedEdgeIds is not compacted
+	static const std::size_t MinReleasedAffiliatedEdgeIds = 64*1024;
+
+	// lazily created index of the subset graph, owned by the CRAG; the mutex 
+	// is only taken to create it, reads of an existing index are lock-free
+	mutable std::atomic<CragHierarchyIndex*> _hierarchyIndex;
+	mutable std::mutex                       _hierarchyIndexMutex;
+
+	// lazily created map from node pairs to edges, same scheme as above
+	mutable std::unordered_map<uint64_t, Edge> _edgeIndex;
+	mutable std::atomic<bool>                  _edgeIndexValid;
+	mutable std::mutex                         _edgeIndexMutex;
 };
 
 #endif // CANDIDATE_MC_CRAG_CRAG_H__
@@ -0,0 +1,131 @@
+#include <util/timing.h>
+#include "CragBuilder.h"
+
+CragBuilder::Slot
+CragBuilder::addNodes(std::size_t num, Crag::NodeType type) {
+
+	Slot first = _nodes.size();
+	_nodes.resize(_nodes.size() + num, SlotInfo{-1, type});
+	_numNewNodes += num;
+
+	return first;
+}
+
+CragBuilder::Slot
+CragBuilder::addNodes(const std::vector<Crag::NodeType>& types) {
+
+	Slot first = _nodes.size();
+	_nodes.reserve(_nodes.size() + types.size());
+	for (Crag::NodeType type : types)
+		_nodes.push_back(SlotInfo{-1, type});
+	_numNewNodes += types.size();
+
+	return first;
+}
+
+std::vector<Crag::CragNode>
+CragBuilder::build() {
+
+	UTIL_TIME_METHOD;
+
+	_crag.reserveNodes(_crag.getAdjacencyGraph().maxNodeId() + 1 + _numNewNodes);
+	_crag.reserveArcs(_crag.getSubsetGraph().maxArcId() + 1 + _arcs.size()/2);
+	_crag.reserveEdges(_crag.getAdjacencyGraph().maxEdgeId() + 1 + _edges.size()/2);
+
+	std::vector<Crag::CragNode> nodes;
+	nodes.reserve(_nodes.size());
+
+	for (const SlotInfo& slot : _nodes)
+		if (slot.id < 0)
+			nodes.push_back(_crag.addNode(slot.type));
+		else
+			nodes.push_back(_crag.nodeFromId(slot.id));
+
+	for (std::size_t i = 0; i < _arcs.size(); i += 2)
+		_crag.addSubsetArc(nodes[_arcs[i]], nodes[_arcs[i+1]]);
+
+	_builtEdges.clear();
+	_builtEdges.reserve(_edgeTypes.size());
+	for (std::size_t i = 0; i < _edgeTypes.size(); i++)
+		_builtEdges.push_back(
+				_crag.addAdjacencyEdge(
+						nodes[_edges[2*i]],
+						nodes[_edges[2*i+1]],
+						_edgeTypes[i]));
+
+	_nodes.clear();
+	_arcs.clear();
+	_edges.clear();
+	_edgeTypes.clear();
+	_numNewNodes = 0;
+
+	return nodes;
+}
+
+std::vector<int>
+CragBuilder::compact(const Crag& source, Crag& target) {
+
+	const Crag::RagType&    rag = source.getAdjacencyGraph();
+	const Crag::SubsetType& ssg = source.getSubsetGraph();
+
+	CragBuilder builder(target);
+
+	// nodes in order of their ids
+	std::vector<int> idMap(rag.maxNodeId() + 1, -1);
+	builder.reserveNodes(idMap.size());
+	for (int id = 0; id <= rag.maxNodeId(); id++) {
+
+		Crag::Node n = rag.nodeFromId(id);
+		if (rag.valid(n))
+			idMap[id] = builder.addNode(source.type(n));
+	}
+
+	builder.reserveArcs(ssg.maxArcId() + 1);
+	for (int id = 0; id <= ssg.maxArcId(); id++) {
+
+		Crag::SubsetArc a = ssg.arcFromId(id);
+		if (ssg.valid(a))
+			builder.addSubsetArc(
+					idMap[ssg.id(ssg.source(a))],
+					idMap[ssg.id(ssg.target(a))]);
+	}
+
+	std::vector<Crag::CragEdge> sourceEdges;
+	builder.reserveEdges(rag.maxEdgeId() + 1);
+	for (int id = 0; id <= rag.maxEdgeId(); id++) {
+
+		Crag::Edge e = rag.edgeFromId(id);
+		if (!rag.valid(e))
+			continue;
+
+		Crag::CragEdge edge(source, e);
+		builder.addAdjacencyEdge(
+				idMap[source.id(edge.u())],
+				idMap[source.id(edge.v())],
+				source.type(edge));
+		sourceEdges.push_back(edge);
+	}
+
+	std::vector<Crag::CragNode> nodes = builder.build();
+
+	// slots are the new node ids, if target was empty
+	for (int& id : idMap)
+		if (id >= 0)
+			id = target.id(nodes[id]);
+
+	target.setGridGraph(source.getGridGraph());
+	for (std::size_t i = 0; i < sourceEdges.size(); i++) {
+
+		if (!source.isLeafEdge(sourceEdges[i]))
+			continue;
+
+		Crag::AffiliatedEdges affiliatedEdges = source.getAffiliatedEdges(sourceEdges[i]);
+		if (!affiliatedEdges.empty())
+			target.setAffiliatedEdgeIds(
+					builder.getEdge(i),
+					affiliatedEdges.beginIds(),
+					affiliatedEdges.endIds());
+	}
+
+	return idMap;
+}
@@ -0,0 +1,156 @@
+#ifndef CANDIDATE_MC_CRAG_CRAG_BUILDER_H__
+#define CANDIDATE_MC_CRAG_CRAG_BUILDER_H__
+
+#include <vector>
+#include "Crag.h"
+
+/**
+ * Collects nodes, subset arcs, and adjacency edges in flat arrays and adds
+ * them to a Crag in one pass, with capacities of the underlying graphs
+ * reserved upfront. The lemon list graphs of the Crag can not be constructed
+ * in bulk, the elements are still added one at a time, but without
+ * reallocations of the graphs.
+ *
+ * Nodes are referred to by slots, which are returned by addNode(), addNodes(),
+ * and existing(). A slot is either a new node to be created by build(), or
+ * a node that is already part of the target Crag. Nodes of new slots are
+ * created in the order of their slots.
+ */
+class CragBuilder {
+
+public:
+
+	typedef int Slot;
+
+	/**
+	 * Create a builder for the given target Crag, which does not have to be
+	 * empty.
+	 */
+	CragBuilder(Crag& crag) :
+		_crag(crag),
+		_numNewNodes(0) {}
+
+	void reserveNodes(std::size_t numNodes) { _nodes.reserve(numNodes); }
+	void reserveArcs(std::size_t numArcs)    { _arcs.reserve(2*numArcs); }
+	void reserveEdges(std::size_t numEdges)  { _edges.reserve(2*numEdges); _edgeTypes.reserve(numEdges); }
+
+	/**
+	 * Add a new node of the given type.
+	 */
+	Slot addNode(Crag::NodeType type = Crag::VolumeNode) {
+
+		_nodes.push_back(SlotInfo{-1, type});
+		_numNewNodes++;
+
+		return _nodes.size() - 1;
+	}
+
+	/**
+	 * Add num new nodes of the given type. Returns the slot of the first
+	 * node, the others follow consecutively.
+	 */
+	Slot addNodes(std::size_t num, Crag::NodeType type = Crag::VolumeNode);
+
+	/**
+	 * Add one new node for each of the given types. Returns the slot of the
+	 * first node, the others follow consecutively.
+	 */
+	Slot addNodes(const std::vector<Crag::NodeType>& types);
+
+	/**
+	 * Get a slot for a node that is already part of the target Crag.
+	 */
+	Slot existing(Crag::CragNode n) {
+
+		_nodes.push_back(SlotInfo{_crag.id(n), Crag::VolumeNode});
+
+		return _nodes.size() - 1;
+	}
+
+	/**
+	 * Add a subset arc from slot u (the subset) to slot v (the superset).
+	 */
+	void addSubsetArc(Slot u, Slot v) {
+
+		_arcs.push_back(u);
+		_arcs.push_back(v);
+	}
+
+	/**
+	 * Add subset arcs for a flat range of slot pairs (u_1, v_1, u_2, v_2, 
+	 * ...).
+	 */
+	template <typename Iterator>
+	void addSubsetArcs(Iterator begin, Iterator end) {
+
+		_arcs.insert(_arcs.end(), begin, end);
+	}
+
+	/**
+	 * Add an adjacency edge between slots u and v.
+	 */
+	void addAdjacencyEdge(Slot u, Slot v, Crag::EdgeType type = Crag::AdjacencyEdge) {
+
+		_edges.push_back(u);
+		_edges.push_back(v);
+		_edgeTypes.push_back(type);
+	}
+
+	/**
+	 * Add adjacency edges for a flat range of slot pairs (u_1, v_1, u_2, v_2, 
+	 * ...).
+	 */
+	template <typename Iterator>
+	void addAdjacencyEdges(Iterator begin, Iterator end, Crag::EdgeType type = Crag::AdjacencyEdge) {
+
+		_edges.insert(_edges.end(), begin, end);
+		_edgeTypes.resize(_edges.size()/2, type);
+	}
+
+	/**
+	 * The number of slots so far.
+	 */
+	std::size_t numSlots() const { return _nodes.size(); }
+
+	/**
+	 * Add all collected nodes, subset arcs, and adjacency edges to the target
+	 * Crag. Returns the Crag node for each slot. The builder is empty
+	 * afterwards and can be reused.
+	 */
+	std::vector<Crag::CragNode> build();
+
+	/**
+	 * Get the i-th adjacency edge added by the last call to build().
+	 */
+	Crag::CragEdge getEdge(std::size_t i) const { return Crag::CragEdge(_crag, _builtEdges[i]); }
+
+	/**
+	 * Copy source into the empty target Crag, such that node and edge ids in
+	 * target are contiguous. Node types, edge types, the grid graph, and
+	 * affiliated edges are copied as well. Returns a map from node ids in
+	 * source to node ids in target (-1 for ids not in use).
+	 */
+	static std::vector<int> compact(const Crag& source, Crag& target);
+
+private:
+
+	struct SlotInfo {
+
+		// id of an existing node, or -1 for new nodes
+		int            id;
+		Crag::NodeType type;
+	};
+
+	Crag& _crag;
+
+	std::vector<SlotInfo>       _nodes;
+	std::size_t                 _numNewNodes;
+	std::vector<Slot>           _arcs;
+	std::vector<Slot>           _edges;
+	std::vector<Crag::EdgeType> _edgeTypes;
+
+	std::vector<Crag::Edge> _builtEdges;
+};
+
+#endif // CANDIDATE_MC_CRAG_CRAG_BUILDER_H__
+
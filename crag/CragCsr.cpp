@@ -0,0 +1,113 @@
+#include <algorithm>
+#include "CragCsr.h"
+#include <util/timing.h>
+
+CragCsr::CragCsr(const Crag& crag) :
+	_crag(crag) {
+
+	UTIL_TIME_METHOD;
+
+	const Crag::RagType&    rag = crag.getAdjacencyGraph();
+	const Crag::SubsetType& ssg = crag.getSubsetGraph();
+
+	// dense node indices, in order of Crag ids
+
+	_nodeIndices.assign(rag.maxNodeId() + 1, -1);
+	for (int id = 0; id <= rag.maxNodeId(); id++)
+		if (rag.valid(rag.nodeFromId(id))) {
+
+			_nodeIndices[id] = _nodeIds.size();
+			_nodeIds.push_back(id);
+		}
+
+	// dense edge indices, in order of Crag ids
+
+	_edgeIndices.assign(rag.maxEdgeId() + 1, -1);
+	for (int id = 0; id <= rag.maxEdgeId(); id++)
+		if (rag.valid(rag.edgeFromId(id))) {
+
+			_edgeIndices[id] = _edgeIds.size();
+			_edgeIds.push_back(id);
+		}
+
+	std::size_t numNodes = _nodeIds.size();
+	std::size_t numEdges = _edgeIds.size();
+
+	_nodeTypes.reserve(numNodes);
+	for (int id : _nodeIds)
+		_nodeTypes.push_back(crag.type(crag.nodeFromId(id)));
+
+	_edgeTypes.reserve(numEdges);
+	_edgeNodes.reserve(2*numEdges);
+	for (int id : _edgeIds) {
+
+		Crag::CragEdge e(crag, rag.edgeFromId(id));
+		_edgeTypes.push_back(crag.type(e));
+		_edgeNodes.push_back(index(e.u()));
+		_edgeNodes.push_back(index(e.v()));
+	}
+
+	// adjacency, counting sort by node (self-loops are listed twice, as in 
+	// lemon's IncEdgeIt)
+
+	_adjacencyOffsets.assign(numNodes + 1, 0);
+	for (std::size_t e = 0; e < numEdges; e++) {
+
+		_adjacencyOffsets[u(e) + 1]++;
+		_adjacencyOffsets[v(e) + 1]++;
+	}
+	for (std::size_t n = 0; n < numNodes; n++)
+		_adjacencyOffsets[n + 1] += _adjacencyOffsets[n];
+
+	_neighbors.resize(_adjacencyOffsets[numNodes]);
+	_adjEdges.resize(_adjacencyOffsets[numNodes]);
+
+	std::vector<int> next(_adjacencyOffsets.begin(), _adjacencyOffsets.end() - 1);
+	for (std::size_t e = 0; e < numEdges; e++) {
+
+		int nu = u(e);
+		int nv = v(e);
+
+		_neighbors[next[nu]] = nv;
+		_adjEdges[next[nu]++] = e;
+		_neighbors[next[nv]] = nu;
+		_adjEdges[next[nv]++] = e;
+	}
+
+	// subset arcs: source is the subnode (child), target the supernode 
+	// (parent)
+
+	std::vector<std::pair<int, int>> arcs;
+	for (Crag::SubsetArcIt a(ssg); a != lemon::INVALID; ++a)
+		arcs.push_back(
+				std::make_pair(
+						_nodeIndices[ssg.id(ssg.source(a))],
+						_nodeIndices[ssg.id(ssg.target(a))]));
+
+	// sort to get parents and children in increasing index order
+	std::sort(arcs.begin(), arcs.end());
+
+	_parentOffsets.assign(numNodes + 1, 0);
+	_childOffsets.assign(numNodes + 1, 0);
+	for (const auto& arc : arcs) {
+
+		_parentOffsets[arc.first + 1]++;
+		_childOffsets[arc.second + 1]++;
+	}
+	for (std::size_t n = 0; n < numNodes; n++) {
+
+		_parentOffsets[n + 1] += _parentOffsets[n];
+		_childOffsets[n + 1]  += _childOffsets[n];
+	}
+
+	_parents.resize(arcs.size());
+	_children.resize(arcs.size());
+
+	std::vector<int> nextParent(_parentOffsets.begin(), _parentOffsets.end() - 1);
+	std::vector<int> nextChild(_childOffsets.begin(), _childOffsets.end() - 1);
+	for (const auto& arc : arcs) {
+
+		_parents[nextParent[arc.first]++]   = arc.second;
+		_children[nextChild[arc.second]++]  = arc.first;
+	}
+}
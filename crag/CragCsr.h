@@ -0,0 +1,157 @@
+#ifndef CANDIDATE_MC_CRAG_CRAG_CSR_H__
+#define CANDIDATE_MC_CRAG_CRAG_CSR_H__
+
+#include <vector>
+#include "Crag.h"
+
+/**
+ * An immutable, compressed-sparse-row (CSR) snapshot of a Crag.
+ *
+ * Nodes and edges of the Crag are assigned dense indices 0..numNodes()-1 and
+ * 0..numEdges()-1 (in increasing order of their Crag ids). Adjacency, subset
+ * parents and subset children, as well as node and edge types, are stored in
+ * flat arrays, such that counts are O(1) and neighborhood walks are contiguous
+ * in memory.
+ *
+ * The snapshot does not observe the Crag it was created from. It has to be
+ * recreated after the Crag was modified. Since it is never modified after
+ * construction, it can be shared between threads.
+ */
+class CragCsr {
+
+public:
+
+	/**
+	 * A read-only view on a contiguous part of one of the flat arrays.
+	 */
+	template <typename T>
+	class Range {
+
+	public:
+
+		Range(const T* begin, const T* end) :
+			_begin(begin),
+			_end(end) {}
+
+		const T* begin() const { return _begin; }
+		const T* end()   const { return _end; }
+
+		std::size_t size() const { return _end - _begin; }
+
+		bool empty() const { return _begin == _end; }
+
+		const T& operator[](std::size_t i) const { return _begin[i]; }
+
+	private:
+
+		const T* _begin;
+		const T* _end;
+	};
+
+	/**
+	 * Create a snapshot of the given Crag.
+	 */
+	CragCsr(const Crag& crag);
+
+	/**
+	 * Get the Crag this snapshot was created from.
+	 */
+	const Crag& getCrag() const { return _crag; }
+
+	inline std::size_t numNodes() const { return _nodeIds.size(); }
+	inline std::size_t numEdges() const { return _edgeIds.size(); }
+	inline std::size_t numArcs()  const { return _children.size(); }
+
+	/**
+	 * Get the dense index of a Crag node or edge.
+	 */
+	inline int index(Crag::CragNode n) const { return _nodeIndices[_crag.id(n)]; }
+	inline int index(Crag::CragEdge e) const { return _edgeIndices[_crag.id(e)]; }
+
+	/**
+	 * Get the Crag id of the node or edge with the given dense index.
+	 */
+	inline int nodeId(int n) const { return _nodeIds[n]; }
+	inline int edgeId(int e) const { return _edgeIds[e]; }
+
+	/**
+	 * Get the Crag node or edge with the given dense index.
+	 */
+	inline Crag::CragNode node(int n) const { return _crag.nodeFromId(_nodeIds[n]); }
+	inline Crag::CragEdge edge(int e) const { return Crag::CragEdge(_crag, _crag.getAdjacencyGraph().edgeFromId(_edgeIds[e])); }
+
+	inline Crag::NodeType nodeType(int n) const { return _nodeTypes[n]; }
+	inline Crag::EdgeType edgeType(int e) const { return _edgeTypes[e]; }
+
+	/**
+	 * Get the dense node indices of the end points of an edge.
+	 */
+	inline int u(int e) const { return _edgeNodes[2*e]; }
+	inline int v(int e) const { return _edgeNodes[2*e + 1]; }
+
+	/**
+	 * Get the dense indices of all adjacent nodes of n. The i-th entry
+	 * corresponds to the i-th entry of adjEdges(n).
+	 */
+	inline Range<int> neighbors(int n) const { return range(_neighbors, _adjacencyOffsets, n); }
+
+	/**
+	 * Get the dense indices of all adjacency edges of n.
+	 */
+	inline Range<int> adjEdges(int n) const { return range(_adjEdges, _adjacencyOffsets, n); }
+
+	/**
+	 * Get the dense indices of the subset parents (supernodes) of n.
+	 */
+	inline Range<int> parents(int n) const { return range(_parents, _parentOffsets, n); }
+
+	/**
+	 * Get the dense indices of the subset children (subnodes) of n.
+	 */
+	inline Range<int> children(int n) const { return range(_children, _childOffsets, n); }
+
+	inline bool isLeafNode(int n) const { return _childOffsets[n] == _childOffsets[n + 1]; }
+	inline bool isRootNode(int n) const { return _parentOffsets[n] == _parentOffsets[n + 1]; }
+
+	inline bool isLeafEdge(int e) const { return isLeafNode(u(e)) && isLeafNode(v(e)); }
+
+private:
+
+	inline Range<int> range(
+			const std::vector<int>& values,
+			const std::vector<int>& offsets,
+			int n) const {
+
+		const int* data = values.data();
+		return Range<int>(data + offsets[n], data + offsets[n + 1]);
+	}
+
+	const Crag& _crag;
+
+	// dense index -> Crag id
+	std::vector<int> _nodeIds;
+	std::vector<int> _edgeIds;
+
+	// Crag id -> dense index (-1 for ids not in use)
+	std::vector<int> _nodeIndices;
+	std::vector<int> _edgeIndices;
+
+	std::vector<Crag::NodeType> _nodeTypes;
+	std::vector<Crag::EdgeType> _edgeTypes;
+
+	// u and v of each edge, interleaved
+	std::vector<int> _edgeNodes;
+
+	std::vector<int> _adjacencyOffsets;
+	std::vector<int> _neighbors;
+	std::vector<int> _adjEdges;
+
+	std::vector<int> _parentOffsets;
+	std::vector<int> _parents;
+
+	std::vector<int> _childOffsets;
+	std::vector<int> _children;
+};
+
+#endif // CANDIDATE_MC_CRAG_CRAG_CSR_H__
+
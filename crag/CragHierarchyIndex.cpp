@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <util/timing.h>
+#include "CragHierarchyIndex.h"
+
+bool
+CragHierarchyIndex::Intervals::contains(int rank) const {
+
+	// in most cases, there is only one interval
+	if (size() == 1)
+		return (rank >= _begin->begin && rank < _begin->end);
+
+	const Interval* i = std::upper_bound(
+			_begin, _end, rank,
+			[](int r, const Interval& interval) { return r < interval.begin; });
+
+	if (i == _begin)
+		return false;
+
+	--i;
+	return (rank < i->end);
+}
+
+CragHierarchyIndex::CragHierarchyIndex(const Crag& crag) :
+	_crag(crag) {
+
+	UTIL_TIME_METHOD;
+
+	const Crag::RagType& rag = crag.getAdjacencyGraph();
+	std::size_t maxId = rag.maxNodeId() + 1;
+
+	_ranks.assign(maxId, -1);
+	_leafRanks.assign(maxId, -1);
+	_levels.assign(maxId, 0);
+	_depths.assign(maxId, 0);
+	_numLeafNodes.assign(maxId, 0);
+
+	_descendantOffsets.push_back(0);
+	_leafOffsets.push_back(0);
+
+	enum State { New, Open, Closed };
+	std::vector<State> states(maxId, New);
+
+	// pairs of (node id, close)
+	std::vector<std::pair<int, bool>> stack;
+	std::vector<int> children;
+
+	for (Crag::CragNode root : crag.nodes()) {
+
+		if (!crag.isRootNode(root))
+			continue;
+
+		stack.push_back(std::make_pair(crag.id(root), false));
+
+		while (!stack.empty()) {
+
+			int  id    = stack.back().first;
+			bool close = stack.back().second;
+			stack.pop_back();
+
+			Crag::CragNode n = crag.nodeFromId(id);
+
+			if (!close) {
+
+				if (states[id] != New)
+					continue;
+
+				states[id] = Open;
+				stack.push_back(std::make_pair(id, true));
+
+				// push children in reverse, such that they get visited in
+				// the order of inArcs()
+				children.clear();
+				for (Crag::CragArc a : crag.inArcs(n))
+					children.push_back(crag.id(a.source()));
+				for (auto c = children.rbegin(); c != children.rend(); c++)
+					if (states[*c] == New)
+						stack.push_back(std::make_pair(*c, false));
+
+				continue;
+			}
+
+			// all children of n are closed, now
+
+			int rank = _nodeAtRank.size();
+			_ranks[id] = rank;
+			_nodeAtRank.push_back(id);
+			states[id] = Closed;
+
+			std::size_t descendantBegin = _descendantIntervals.size();
+			std::size_t leafBegin       = _leafIntervals.size();
+
+			bool isLeaf = true;
+			int  level  = 0;
+
+			for (Crag::CragArc a : crag.inArcs(n)) {
+
+				int c = crag.id(a.source());
+
+				if (states[c] != Closed)
+					UTIL_THROW_EXCEPTION(
+							UsageError,
+							"subset graph contains a cycle through node " << c);
+
+				isLeaf = false;
+				level  = std::max(level, _levels[c] + 1);
+
+				int cr = _ranks[c];
+				for (int i = _descendantOffsets[cr]; i < _descendantOffsets[cr + 1]; i++) {
+
+					Interval interval = _descendantIntervals[i];
+					_descendantIntervals.push_back(interval);
+				}
+				for (int i = _leafOffsets[cr]; i < _leafOffsets[cr + 1]; i++) {
+
+					Interval interval = _leafIntervals[i];
+					_leafIntervals.push_back(interval);
+				}
+			}
+
+			_descendantIntervals.push_back(Interval{rank, rank + 1});
+
+			if (isLeaf) {
+
+				int leafRank = _leafAtRank.size();
+				_leafRanks[id] = leafRank;
+				_leafAtRank.push_back(id);
+				_leafIntervals.push_back(Interval{leafRank, leafRank + 1});
+			}
+
+			mergeIntervals(_descendantIntervals, descendantBegin);
+			mergeIntervals(_leafIntervals, leafBegin);
+
+			_descendantOffsets.push_back(_descendantIntervals.size());
+			_leafOffsets.push_back(_leafIntervals.size());
+
+			int numLeafNodes = 0;
+			for (std::size_t i = leafBegin; i < _leafIntervals.size(); i++)
+				numLeafNodes += _leafIntervals[i].end - _leafIntervals[i].begin;
+
+			_levels[id]       = level;
+			_numLeafNodes[id] = numLeafNodes;
+		}
+	}
+
+	// decreasing ranks visit parents before their children
+	for (int rank = _nodeAtRank.size() - 1; rank >= 0; rank--) {
+
+		int id = _nodeAtRank[rank];
+
+		for (Crag::CragArc a : crag.inArcs(crag.nodeFromId(id))) {
+
+			int c = crag.id(a.source());
+			_depths[c] = std::max(_depths[c], _depths[id] + 1);
+		}
+	}
+}
+
+void
+CragHierarchyIndex::mergeIntervals(std::vector<Interval>& intervals, std::size_t begin) {
+
+	if (intervals.size() - begin <= 1)
+		return;
+
+	std::sort(
+			intervals.begin() + begin,
+			intervals.end(),
+			[](const Interval& a, const Interval& b) { return a.begin < b.begin; });
+
+	std::size_t last = begin;
+	for (std::size_t i = begin + 1; i < intervals.size(); i++) {
+
+		if (intervals[i].begin <= intervals[last].end)
+			intervals[last].end = std::max(intervals[last].end, intervals[i].end);
+		else
+			intervals[++last] = intervals[i];
+	}
+
+	intervals.resize(last + 1);
+}
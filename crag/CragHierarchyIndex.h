@@ -0,0 +1,201 @@
+#ifndef CANDIDATE_MC_CRAG_CRAG_HIERARCHY_INDEX_H__
+#define CANDIDATE_MC_CRAG_CRAG_HIERARCHY_INDEX_H__
+
+#include <vector>
+#include "Crag.h"
+
+/**
+ * A precomputed index of the subset hierarchy of a Crag.
+ *
+ * Nodes are ranked in DFS post-order, starting from each root (in the order of
+ * Crag::nodes()), visiting children in the order of Crag::inArcs(). Leaf nodes
+ * get an additional leaf rank in the same order. For subset trees, the
+ * descendants of a node (including the node itself) form a contiguous
+ * interval of ranks, and its leaf nodes a contiguous interval of leaf ranks.
+ * Nodes with more than one parent (as created by CragStackCombiner) can split
+ * these sets into a few intervals, which are stored sorted and merged.
+ *
+ * Descendant and leaf membership tests are therefore (for trees) constant
+ * time range checks. Levels, depths, and leaf counts are cached. Construction
+ * is linear in the number of nodes and arcs of the subset graph.
+ *
+ * The index does not observe the Crag. Use Crag::getHierarchyIndex() to get an
+ * index that is rebuilt after modifications.
+ */
+class CragHierarchyIndex {
+
+public:
+
+	/**
+	 * A half-open interval [begin, end) of ranks.
+	 */
+	struct Interval {
+
+		int begin;
+		int end;
+	};
+
+	/**
+	 * A sorted list of disjoint intervals.
+	 */
+	class Intervals {
+
+	public:
+
+		Intervals(const Interval* begin, const Interval* end) :
+			_begin(begin),
+			_end(end) {}
+
+		const Interval* begin() const { return _begin; }
+		const Interval* end()   const { return _end; }
+
+		std::size_t size() const { return _end - _begin; }
+
+		/**
+		 * Test whether the given rank is contained in one of the intervals.
+		 */
+		bool contains(int rank) const;
+
+	private:
+
+		const Interval* _begin;
+		const Interval* _end;
+	};
+
+	CragHierarchyIndex(const Crag& crag);
+
+	/**
+	 * The number of nodes in the index.
+	 */
+	std::size_t numNodes() const { return _nodeAtRank.size(); }
+
+	/**
+	 * The number of leaf nodes in the index.
+	 */
+	std::size_t numLeafNodes() const { return _leafAtRank.size(); }
+
+	/**
+	 * The size of the longest subset path from n to a leaf node. Leaf nodes
+	 * have a level of zero.
+	 */
+	int level(Crag::CragNode n) const { return _levels[_crag.id(n)]; }
+
+	/**
+	 * The size of the longest subset path from a root node to n. Root nodes
+	 * have a depth of zero.
+	 */
+	int depth(Crag::CragNode n) const { return _depths[_crag.id(n)]; }
+
+	/**
+	 * The number of leaf nodes under n (one for leaf nodes).
+	 */
+	int numLeafNodes(Crag::CragNode n) const { return _numLeafNodes[_crag.id(n)]; }
+
+	/**
+	 * The post-order rank of n.
+	 */
+	int rank(Crag::CragNode n) const { return _ranks[_crag.id(n)]; }
+
+	/**
+	 * The leaf rank of n, or -1 if n is not a leaf node.
+	 */
+	int leafRank(Crag::CragNode n) const { return _leafRanks[_crag.id(n)]; }
+
+	bool isLeafNode(Crag::CragNode n) const { return leafRank(n) >= 0; }
+
+	Crag::CragNode nodeAtRank(int rank) const { return _crag.nodeFromId(_nodeAtRank[rank]); }
+
+	Crag::CragNode leafAtRank(int rank) const { return _crag.nodeFromId(_leafAtRank[rank]); }
+
+	/**
+	 * The ranks of all descendants of n, including n.
+	 */
+	Intervals descendantIntervals(Crag::CragNode n) const {
+
+		return intervals(_descendantIntervals, _descendantOffsets, rank(n));
+	}
+
+	/**
+	 * The leaf ranks of all leaf nodes under n.
+	 */
+	Intervals leafIntervals(Crag::CragNode n) const {
+
+		return intervals(_leafIntervals, _leafOffsets, rank(n));
+	}
+
+	/**
+	 * Test whether d is a descendant of n. Every node is a descendant of
+	 * itself.
+	 */
+	bool isDescendant(Crag::CragNode d, Crag::CragNode n) const {
+
+		return descendantIntervals(n).contains(rank(d));
+	}
+
+	/**
+	 * Test whether l is a leaf node under n.
+	 */
+	bool isLeafDescendant(Crag::CragNode l, Crag::CragNode n) const {
+
+		int r = leafRank(l);
+		return r >= 0 && leafIntervals(n).contains(r);
+	}
+
+	/**
+	 * Call f(d) for each descendant d of n, including n.
+	 */
+	template <typename F>
+	void forEachDescendant(Crag::CragNode n, F f) const {
+
+		for (const Interval& i : descendantIntervals(n))
+			for (int r = i.begin; r < i.end; r++)
+				f(nodeAtRank(r));
+	}
+
+	/**
+	 * Call f(l) for each leaf node l under n.
+	 */
+	template <typename F>
+	void forEachLeafNode(Crag::CragNode n, F f) const {
+
+		for (const Interval& i : leafIntervals(n))
+			for (int r = i.begin; r < i.end; r++)
+				f(leafAtRank(r));
+	}
+
+private:
+
+	Intervals intervals(
+			const std::vector<Interval>& values,
+			const std::vector<int>& offsets,
+			int rank) const {
+
+		const Interval* data = values.data();
+		return Intervals(data + offsets[rank], data + offsets[rank + 1]);
+	}
+
+	// sort and merge the intervals in [begin, end) of the given vector
+	static void mergeIntervals(std::vector<Interval>& intervals, std::size_t begin);
+
+	const Crag& _crag;
+
+	// by node id
+	std::vector<int> _ranks;
+	std::vector<int> _leafRanks;
+	std::vector<int> _levels;
+	std::vector<int> _depths;
+	std::vector<int> _numLeafNodes;
+
+	// by rank
+	std::vector<int> _nodeAtRank;
+	std::vector<int> _leafAtRank;
+
+	// by rank, CSR of intervals
+	std::vector<int>      _descendantOffsets;
+	std::vector<Interval> _descendantIntervals;
+	std::vector<int>      _leafOffsets;
+	std::vector<Interval> _leafIntervals;
+};
+
+#endif // CANDIDATE_MC_CRAG_CRAG_HIERARCHY_INDEX_H__
+
@@ -0,0 +1,169 @@
+#include <util/exceptions.h>
+#include "CragHierarchyIndex.h"
+#include "CragPartitioner.h"
+
+CragPartitioner::CragPartitioner(const Crag& crag) :
+	_crag(crag) {
+
+	const Crag::RagType& rag = crag.getAdjacencyGraph();
+
+	for (int id = 0; id <= rag.maxNodeId(); id++)
+		if (rag.valid(rag.nodeFromId(id)))
+			_nodes.push_back(crag.nodeFromId(id));
+
+	for (int id = 0; id <= rag.maxEdgeId(); id++)
+		if (rag.valid(rag.edgeFromId(id)))
+			_edges.push_back(rag.edgeFromId(id));
+}
+
+std::vector<CragPartitioner::Range>
+CragPartitioner::partitionNodes(std::size_t numParts) const {
+
+	return partition(_nodes.size(), numParts);
+}
+
+std::vector<CragPartitioner::Range>
+CragPartitioner::partitionNodes(std::size_t numParts, const std::vector<double>& weights) const {
+
+	if (weights.size() != _nodes.size())
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"got " << weights.size() << " weights for " << _nodes.size() << " nodes");
+
+	return partition(_nodes.size(), numParts, weights);
+}
+
+std::vector<CragPartitioner::Range>
+CragPartitioner::partitionEdges(std::size_t numParts) const {
+
+	return partition(_edges.size(), numParts);
+}
+
+std::vector<CragPartitioner::Range>
+CragPartitioner::partitionEdges(std::size_t numParts, const std::vector<double>& weights) const {
+
+	if (weights.size() != _edges.size())
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"got " << weights.size() << " weights for " << _edges.size() << " edges");
+
+	return partition(_edges.size(), numParts, weights);
+}
+
+std::vector<double>
+CragPartitioner::leafCountNodeWeights() const {
+
+	const CragHierarchyIndex& index = _crag.getHierarchyIndex();
+
+	std::vector<double> weights;
+	weights.reserve(_nodes.size());
+	for (Crag::CragNode n : _nodes)
+		weights.push_back(index.numLeafNodes(n));
+
+	return weights;
+}
+
+std::vector<double>
+CragPartitioner::leafCountEdgeWeights() const {
+
+	const CragHierarchyIndex& index = _crag.getHierarchyIndex();
+
+	std::vector<double> weights;
+	weights.reserve(_edges.size());
+	for (std::size_t i = 0; i < _edges.size(); i++)
+		weights.push_back(
+				index.numLeafNodes(_crag.u(_edges[i])) +
+				index.numLeafNodes(_crag.v(_edges[i])));
+
+	return weights;
+}
+
+std::vector<double>
+CragPartitioner::boundingBoxNodeWeights(const CragVolumes& volumes) const {
+
+	std::vector<double> weights;
+	weights.reserve(_nodes.size());
+	for (Crag::CragNode n : _nodes)
+		weights.push_back(boundingBoxVolume(volumes, n));
+
+	return weights;
+}
+
+std::vector<double>
+CragPartitioner::boundingBoxEdgeWeights(const CragVolumes& volumes) const {
+
+	std::vector<double> weights;
+	weights.reserve(_edges.size());
+	for (std::size_t i = 0; i < _edges.size(); i++)
+		weights.push_back(
+				boundingBoxVolume(volumes, _crag.u(_edges[i])) +
+				boundingBoxVolume(volumes, _crag.v(_edges[i])));
+
+	return weights;
+}
+
+std::vector<CragPartitioner::Range>
+CragPartitioner::partition(std::size_t num, std::size_t numParts) {
+
+	numParts = std::min(numParts, num);
+
+	std::vector<Range> ranges;
+	for (std::size_t p = 0; p < numParts; p++)
+		ranges.push_back(Range{num*p/numParts, num*(p + 1)/numParts});
+
+	return ranges;
+}
+
+std::vector<CragPartitioner::Range>
+CragPartitioner::partition(std::size_t num, std::size_t numParts, const std::vector<double>& weights) {
+
+	numParts = std::min(numParts, num);
+
+	if (numParts == 0)
+		return std::vector<Range>();
+
+	std::vector<double> cumulative(num);
+	double total = 0;
+	for (std::size_t i = 0; i < num; i++) {
+
+		total += weights[i];
+		cumulative[i] = total;
+	}
+
+	if (total <= 0)
+		return partition(num, numParts);
+
+	// end of each range is the first element that reaches the target weight,
+	// constrained such that each range contains at least one element
+	std::vector<Range> ranges;
+	std::size_t begin = 0;
+	for (std::size_t p = 0; p < numParts; p++) {
+
+		std::size_t end;
+
+		if (p == numParts - 1) {
+
+			end = num;
+
+		} else {
+
+			double target = total*(p + 1)/numParts;
+			end = std::lower_bound(cumulative.begin(), cumulative.end(), target) - cumulative.begin() + 1;
+			end = std::max(end, begin + 1);
+			end = std::min(end, num - (numParts - p - 1));
+		}
+
+		ranges.push_back(Range{begin, end});
+		begin = end;
+	}
+
+	return ranges;
+}
+
+double
+CragPartitioner::boundingBoxVolume(const CragVolumes& volumes, Crag::CragNode n) {
+
+	util::box<float, 3> bb = volumes.getBoundingBox(n);
+
+	return static_cast<double>(bb.width())*bb.height()*std::max(bb.depth(), 1.0f);
+}
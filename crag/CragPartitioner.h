@@ -0,0 +1,128 @@
+#ifndef CANDIDATE_MC_CRAG_CRAG_PARTITIONER_H__
+#define CANDIDATE_MC_CRAG_CRAG_PARTITIONER_H__
+
+#include <vector>
+#include "Crag.h"
+#include "CragVolumes.h"
+#include "Parallel.h"
+
+/**
+ * Splits the nodes or edges of a Crag into disjoint, contiguous ranges of
+ * roughly equal work, to be processed in parallel.
+ *
+ * The nodes and edges are collected once (in the order of their ids) into
+ * arrays, such that a range [begin, end) refers to the elements
+ * node(begin)...node(end-1) (or edge(begin)...edge(end-1)). Ranges can be
+ * balanced by element count, or by per-element weights like the number of
+ * leaf nodes under a candidate or the volume of its bounding box.
+ *
+ * The partitioner does not observe the Crag, it has to be recreated after
+ * nodes or edges have been added or removed.
+ */
+class CragPartitioner {
+
+public:
+
+	/**
+	 * A half-open range [begin, end) of node or edge indices.
+	 */
+	struct Range {
+
+		std::size_t begin;
+		std::size_t end;
+
+		std::size_t size() const { return end - begin; }
+	};
+
+	CragPartitioner(const Crag& crag);
+
+	std::size_t numNodes() const { return _nodes.size(); }
+	std::size_t numEdges() const { return _edges.size(); }
+
+	Crag::CragNode node(std::size_t i) const { return _nodes[i]; }
+	Crag::CragEdge edge(std::size_t i) const { return Crag::CragEdge(_crag, _edges[i]); }
+
+	/**
+	 * Split the nodes into at most numParts ranges of about equal size.
+	 */
+	std::vector<Range> partitionNodes(std::size_t numParts) const;
+
+	/**
+	 * Split the nodes into at most numParts ranges of about equal total
+	 * weight. weights[i] is the weight of node(i).
+	 */
+	std::vector<Range> partitionNodes(std::size_t numParts, const std::vector<double>& weights) const;
+
+	/**
+	 * Split the edges into at most numParts ranges of about equal size.
+	 */
+	std::vector<Range> partitionEdges(std::size_t numParts) const;
+
+	/**
+	 * Split the edges into at most numParts ranges of about equal total
+	 * weight. weights[i] is the weight of edge(i).
+	 */
+	std::vector<Range> partitionEdges(std::size_t numParts, const std::vector<double>& weights) const;
+
+	/**
+	 * Node weights that are the number of leaf nodes under each node.
+	 */
+	std::vector<double> leafCountNodeWeights() const;
+
+	/**
+	 * Edge weights that are the sum of the number of leaf nodes under u and v.
+	 */
+	std::vector<double> leafCountEdgeWeights() const;
+
+	/**
+	 * Node weights that are the bounding box volumes of the nodes.
+	 */
+	std::vector<double> boundingBoxNodeWeights(const CragVolumes& volumes) const;
+
+	/**
+	 * Edge weights that are the sum of the bounding box volumes of u and v.
+	 */
+	std::vector<double> boundingBoxEdgeWeights(const CragVolumes& volumes) const;
+
+	/**
+	 * Call f(n) for each node n, in parallel over the given ranges.
+	 */
+	template <typename F>
+	void forEachNode(const std::vector<Range>& ranges, F f) const {
+
+		parallelFor(ranges.size(), [&](std::size_t r) {
+
+			for (std::size_t i = ranges[r].begin; i < ranges[r].end; i++)
+				f(node(i));
+		});
+	}
+
+	/**
+	 * Call f(e) for each edge e, in parallel over the given ranges.
+	 */
+	template <typename F>
+	void forEachEdge(const std::vector<Range>& ranges, F f) const {
+
+		parallelFor(ranges.size(), [&](std::size_t r) {
+
+			for (std::size_t i = ranges[r].begin; i < ranges[r].end; i++)
+				f(edge(i));
+		});
+	}
+
+private:
+
+	static std::vector<Range> partition(std::size_t num, std::size_t numParts);
+
+	static std::vector<Range> partition(std::size_t num, std::size_t numParts, const std::vector<double>& weights);
+
+	static double boundingBoxVolume(const CragVolumes& volumes, Crag::CragNode n);
+
+	const Crag& _crag;
+
+	std::vector<Crag::CragNode> _nodes;
+	std::vector<Crag::Edge>     _edges;
+};
+
+#endif // CANDIDATE_MC_CRAG_CRAG_PARTITIONER_H__
+
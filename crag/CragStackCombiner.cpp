@@ -1,10 +1,15 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
 #include <features/HausdorffDistance.h>
+#include <nanoflann.hpp>
 #include <util/Logger.h>
 #include <util/ProgramOptions.h>
 #include <util/assert.h>
 #include <util/exceptions.h>
 #include <util/timing.h>
 #include "CragStackCombiner.h"
+#include "Parallel.h"
 
 logger::LogChannel cragstackcombinerlog("cragstackcombinerlog", "[CragStackCombiner] ");
 
@@ -36,6 +41,133 @@ util::ProgramOption optionMaxZLinkBoundingBoxDistance(
 		                          "distance.",
 		util::_default_value    = 0);
 
+/**
+ * A spatial index for 2D bounding boxes. The boxes are grouped into classes of 
+ * similar size (by powers of two of their larger extent), and the centers of 
+ * the boxes of each class are stored in a KD-tree. All boxes that intersect a 
+ * query box are found with one radius search per class, with a radius that 
+ * covers the largest box of the class.
+ */
+class CragStackCombiner::BoundingBoxIndex {
+
+public:
+
+	BoundingBoxIndex(const std::vector<util::box<float, 2>>& boxes) {
+
+		std::map<int, std::size_t> classIndices;
+
+		for (std::size_t i = 0; i < boxes.size(); i++) {
+
+			const util::box<float, 2>& bb = boxes[i];
+
+			float halfWidth  = 0.5*(bb.max().x() - bb.min().x());
+			float halfHeight = 0.5*(bb.max().y() - bb.min().y());
+
+			int sizeClass = std::ilogb(std::max(std::max(halfWidth, halfHeight), 1.0f));
+
+			auto c = classIndices.find(sizeClass);
+			if (c == classIndices.end()) {
+
+				c = classIndices.insert(std::make_pair(sizeClass, _classes.size())).first;
+				_classes.emplace_back(new SizeClass());
+			}
+
+			SizeClass& sizeClassBoxes = *_classes[c->second];
+
+			sizeClassBoxes.centers.push_back(0.5*(bb.min().x() + bb.max().x()));
+			sizeClassBoxes.centers.push_back(0.5*(bb.min().y() + bb.max().y()));
+			sizeClassBoxes.indices.push_back(i);
+			sizeClassBoxes.maxHalfWidth  = std::max(sizeClassBoxes.maxHalfWidth,  halfWidth);
+			sizeClassBoxes.maxHalfHeight = std::max(sizeClassBoxes.maxHalfHeight, halfHeight);
+		}
+
+		for (auto& sizeClass : _classes) {
+
+			sizeClass->tree.reset(new SizeClass::KdTree(2, *sizeClass, nanoflann::KDTreeSingleIndexAdaptorParams(10)));
+			sizeClass->tree->buildIndex();
+		}
+	}
+
+	/**
+	 * Get the indices of the boxes that might intersect the given box, grown 
+	 * by margin in each direction, in increasing order. This is a superset of 
+	 * the intersecting boxes.
+	 */
+	std::vector<std::size_t> find(const util::box<float, 2>& bb, float margin) const {
+
+		float halfWidth  = 0.5*(bb.max().x() - bb.min().x()) + margin;
+		float halfHeight = 0.5*(bb.max().y() - bb.min().y()) + margin;
+
+		float center[2] = {
+			0.5f*(bb.min().x() + bb.max().x()),
+			0.5f*(bb.min().y() + bb.max().y())
+		};
+
+		std::vector<std::size_t> indices;
+		std::vector<std::pair<std::size_t, float>> matches;
+
+		nanoflann::SearchParams params;
+		params.sorted = false;
+
+		for (const auto& sizeClass : _classes) {
+
+			// the circle around the rectangle of possible centers of 
+			// intersecting boxes
+			float dx = halfWidth  + sizeClass->maxHalfWidth;
+			float dy = halfHeight + sizeClass->maxHalfHeight;
+
+			matches.clear();
+			sizeClass->tree->radiusSearch(center, dx*dx + dy*dy, matches, params);
+
+			for (const auto& match : matches)
+				indices.push_back(sizeClass->indices[match.first]);
+		}
+
+		std::sort(indices.begin(), indices.end());
+
+		return indices;
+	}
+
+private:
+
+	// the boxes of one size class, as a dataset for nanoflann
+	struct SizeClass {
+
+		SizeClass() : maxHalfWidth(0), maxHalfHeight(0) {}
+
+		inline std::size_t kdtree_get_point_count() const { return indices.size(); }
+
+		inline float kdtree_get_pt(std::size_t i, int dim) const { return centers[2*i + dim]; }
+
+		inline float kdtree_distance(const float* p, std::size_t i, std::size_t) const {
+
+			float dx = p[0] - centers[2*i];
+			float dy = p[1] - centers[2*i + 1];
+
+			return dx*dx + dy*dy;
+		}
+
+		template <class BoundingBox>
+		bool kdtree_get_bbox(BoundingBox&) const { return false; }
+
+		std::vector<float>       centers;
+		std::vector<std::size_t> indices;
+
+		float maxHalfWidth;
+		float maxHalfHeight;
+
+		typedef nanoflann::KDTreeSingleIndexAdaptor<
+				nanoflann::L2_Simple_Adaptor<float, SizeClass>,
+				SizeClass,
+				2> KdTree;
+
+		std::unique_ptr<KdTree> tree;
+	};
+
+	// the size classes are referenced by their KD-trees and must not move
+	std::vector<std::unique_ptr<SizeClass>> _classes;
+};
+
 CragStackCombiner::CragStackCombiner() :
 	_maxHausdorffDistance(optionMaxZLinkHausdorffDistance),
 	_maxBbDistance(optionMaxZLinkBoundingBoxDistance),
@@ -108,16 +240,29 @@ CragStackCombiner::combine(
 		copyVolumes(*sourcesVolumes[0], targetVolumes, _prevNodeMap);
 	}
 
-	for (unsigned int z = 1; z < sourcesCrags.size(); z++) {
+	// find the links between all pairs of successive sections in parallel
+	std::vector<std::vector<std::pair<Crag::CragNode, Crag::CragNode>>> sectionLinks(sourcesCrags.size() - 1);
+
+	{
+		UTIL_TIME_SCOPE("link CRAG sections");
+
+		LOG_USER(cragstackcombinerlog) << "linking " << sourcesCrags.size() << " CRAGs" << std::endl;
+
+		parallelFor(sectionLinks.size(), [&](std::size_t z) {
+
+			sectionLinks[z] =
+					findLinks(
+							*sourcesCrags[z],
+							*sourcesVolumes[z],
+							*sourcesCrags[z+1],
+							*sourcesVolumes[z+1]);
+		});
+	}
 
-		LOG_USER(cragstackcombinerlog) << "linking CRAG " << (z-1) << " and " << z << std::endl;
+	for (unsigned int z = 1; z < sourcesCrags.size(); z++) {
 
-		std::vector<std::pair<Crag::CragNode, Crag::CragNode>> links =
-				findLinks(
-						*sourcesCrags[z-1],
-						*sourcesVolumes[z-1],
-						*sourcesCrags[z],
-						*sourcesVolumes[z]);
+		std::vector<std::pair<Crag::CragNode, Crag::CragNode>> links;
+		links.swap(sectionLinks[z-1]);
 
 		if (z == 1)
 			_prevNodeMap = copyNodes(0, *sourcesCrags[0], targetCrag);
@@ -221,8 +366,6 @@ CragStackCombiner::findLinks(
 		const Crag&        cragB,
 		const CragVolumes& volsB) {
 
-	UTIL_TIME_METHOD;
-
 	std::vector<std::pair<Crag::CragNode, Crag::CragNode>> links;
 
 	if (cragA.nodes().size() == 0 || cragB.nodes().size() == 0)
@@ -235,18 +378,47 @@ CragStackCombiner::findLinks(
 			volsA[*cragA.nodes().begin()]->getResolutionY());
 	HausdorffDistance hausdorff(_maxHausdorffDistance + maxResolution);
 
+	std::vector<Crag::CragNode> nodesB;
+	std::vector<util::box<float, 2>> boxesB;
+	for (Crag::CragNode j : cragB.nodes()) {
+
+		nodesB.push_back(j);
+		boxesB.push_back(volsB.getBoundingBox(j).project<2>());
+	}
+
+	bool useBoundingBoxes = (_requireBbOverlap || _maxBbDistance > 0);
+
+	// boxes passing the bounding box distance test intersect when grown by 
+	// the maximal distance
+	std::unique_ptr<BoundingBoxIndex> index;
+	float margin = (_requireBbOverlap ? 0 : _maxBbDistance);
+	if (useBoundingBoxes)
+		index.reset(new BoundingBoxIndex(boxesB));
+
+	std::vector<std::size_t> allCandidates;
+	if (!useBoundingBoxes)
+		for (std::size_t k = 0; k < nodesB.size(); k++)
+			allCandidates.push_back(k);
+
 	for (Crag::CragNode i : cragA.nodes()) {
 
-		for (Crag::CragNode j : cragB.nodes()) {
+		util::box<float, 2> bb_i = volsA.getBoundingBox(i).project<2>();
+
+		std::vector<std::size_t> candidates;
+		if (useBoundingBoxes)
+			candidates = index->find(bb_i, margin);
+
+		for (std::size_t k : (useBoundingBoxes ? candidates : allCandidates)) {
+
+			Crag::CragNode j = nodesB[k];
 
 			LOG_ALL(cragstackcombinerlog)
 					<< "check linking of nodes " << cragA.id(i)
 					<< " and " << cragB.id(j) << std::endl;
 
-			if (_requireBbOverlap || _maxBbDistance > 0) {
+			if (useBoundingBoxes) {
 
-				util::box<float, 2> bb_i = volsA.getBoundingBox(i).project<2>();
-				util::box<float, 2> bb_j = volsB.getBoundingBox(j).project<2>();
+				const util::box<float, 2>& bb_j = boxesB[k];
 
 				LOG_ALL(cragstackcombinerlog)
 						<< "bounding boxes are " << bb_i << " and " << bb_j << std::endl;
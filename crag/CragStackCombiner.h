@@ -8,6 +8,7 @@
 
 /**
  * Combines a stack of CRAGs(coming from a stack of images) into a single crag.
+ * The links between successive sections are found in parallel.
  */
 class CragStackCombiner {
 
@@ -41,6 +42,15 @@ private:
 
 	std::vector<std::pair<Crag::CragNode, Crag::CragNode>> findLinks(const Crag& a, const Crag& b);
 
+	// a spatial index for the 2D bounding boxes of candidates
+	class BoundingBoxIndex;
+
+	/**
+	 * Find the links between the candidates of two successive sections. If 
+	 * bounding boxes are used to filter candidates, only the pairs found by a 
+	 * BoundingBoxIndex are tested. Links are returned in the order of the 
+	 * nodes of cragA and cragB.
+	 */
 	std::vector<std::pair<Crag::CragNode, Crag::CragNode>> findLinks(
 			const Crag&        cragA,
 			const CragVolumes& volsA,
@@ -1,15 +1,25 @@
+#include <algorithm>
+#include "CragHierarchyIndex.h"
 #include "CragVolumes.h"
 #include <util/Logger.h>
+#include <util/ProgramOptions.h>
 #include <util/assert.h>
 
 logger::LogChannel cragvolumeslog("cragvolumeslog", "[CragVolumes] ");
 
+util::ProgramOption optionVolumeCacheSize(
+		util::_long_name        = "volumeCacheSize",
+		util::_module           = "crag",
+		util::_description_text = "The maximal amount of memory in MB to use for caching materialized "
+		                          "volumes of higher candidates.",
+		util::_default_value    = 1024);
+
 CragVolumes::CragVolumes(const Crag& crag) :
 	_crag(crag),
-	_volumes(crag) {
-
-	_cache.set_max_size(1024);
-}
+	_volumes(crag),
+	_cache(optionVolumeCacheSize.as<std::size_t>()*1024*1024),
+	_leafLabels(crag),
+	_leafBoundingBoxes(crag) {}
 
 void
 CragVolumes::setVolume(Crag::CragNode n, std::shared_ptr<CragVolume> volume) {
@@ -18,17 +28,200 @@ CragVolumes::setVolume(Crag::CragNode n, std::shared_ptr<CragVolume> volume) {
 	setBoundingBoxDirty();
 }
 
+void
+CragVolumes::setVolumeLoader(VolumeLoader loader) {
+
+	_loader = loader;
+	_cache.clear();
+	setBoundingBoxDirty();
+}
+
+void
+CragVolumes::setLeafBoundingBox(Crag::CragNode n, const util::box<float, 3>& bb) {
+
+	_leafBoundingBoxes[n] = bb;
+	setBoundingBoxDirty();
+}
+
+void
+CragVolumes::setLabelVolume(std::shared_ptr<const LabelMaskView::LabelVolume> labelVolume) {
+
+	_labelVolume = labelVolume;
+	_cache.clear();
+	setBoundingBoxDirty();
+}
+
+void
+CragVolumes::setLeafLabel(Crag::CragNode n, int label, const util::box<unsigned int, 3>& bb) {
+
+	_leafLabels[n].label = label;
+	_leafLabels[n].bb    = bb;
+	setBoundingBoxDirty();
+}
+
+LabelMaskView
+CragVolumes::getMask(Crag::CragNode n) const {
+
+	if (!_labelVolume)
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"masks are only available for volumes backed by a label volume");
+
+	util::box<unsigned int, 3> bb;
+	std::vector<int>           labels;
+
+	for (const LeafLabel& leaf : getLeafLabels(n, bb))
+		labels.push_back(leaf.label);
+
+	return LabelMaskView(_labelVolume, bb, labels);
+}
+
+std::size_t
+CragVolumes::numVoxels(Crag::CragNode n) const {
+
+	std::size_t count = 0;
+	forEachVoxel(n, [&](unsigned int, unsigned int, unsigned int) { count++; });
+
+	return count;
+}
+
+std::vector<CragVolumes::LeafLabel>
+CragVolumes::getLeafLabels(Crag::CragNode n, util::box<unsigned int, 3>& bb) const {
+
+	std::vector<LeafLabel> leaves;
+
+	_crag.getHierarchyIndex().forEachLeafNode(n, [&](Crag::CragNode l) {
+
+		const LeafLabel& leaf = _leafLabels[l];
+
+		if (leaf.label == 0)
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"node " << _crag.id(l) << " is a leaf node but has no label assigned");
+
+		leaves.push_back(leaf);
+	});
+
+	// sorted by label, leaves sharing a label are visited once
+	std::sort(
+			leaves.begin(),
+			leaves.end(),
+			[](const LeafLabel& a, const LeafLabel& b) { return a.label < b.label; });
+
+	std::vector<LeafLabel> distinct;
+	for (const LeafLabel& leaf : leaves) {
+
+		if (!distinct.empty() && distinct.back().label == leaf.label)
+			distinct.back().bb.fit(leaf.bb);
+		else
+			distinct.push_back(leaf);
+	}
+
+	bb = util::box<unsigned int, 3>();
+	for (const LeafLabel& leaf : distinct)
+		bb.fit(leaf.bb);
+
+	return distinct;
+}
+
+std::shared_ptr<CragVolume>
+CragVolumes::materializeLabels(Crag::CragNode n) const {
+
+	util::box<unsigned int, 3> bb;
+	std::vector<LeafLabel> leaves = getLeafLabels(n, bb);
+
+	auto volume = std::make_shared<CragVolume>(bb.width(), bb.height(), bb.depth(), 0);
+	volume->setResolution(_labelVolume->getResolution());
+	volume->setOffset(_labelVolume->getOffset() + bb.min()*_labelVolume->getResolution());
+
+	forEachLabelVoxel(leaves, bb, [&](unsigned int x, unsigned int y, unsigned int z) {
+		(*volume)(x, y, z) = 1;
+	});
+
+	return volume;
+}
+
 std::shared_ptr<CragVolume>
 CragVolumes::operator[](Crag::CragNode n) const {
 
-	// if this is already a leaf node volume, no need to materialize
-	if (_volumes[n].numUnionVolumes() == 1)
-		return _volumes[n].getUnionVolume(0);
+	// volumes backed by a label volume are created from the labels of their 
+	// leaf nodes
+	if (_labelVolume)
+		return _cache.get(_crag.id(n), [&]{ return materializeLabels(n); });
+
+	if (_loader) {
+
+		if (_crag.isLeafNode(n))
+			return loadLeafVolume(n);
+
+		std::shared_ptr<CragVolume> volume = _cache.get(_crag.id(n));
+		if (volume)
+			return volume;
+
+		return _cache.put(_crag.id(n), loadedChildVolumes(n).materialize());
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		// if this is already a leaf node volume, no need to materialize
+		if (_volumes[n].numUnionVolumes() == 1)
+			return _volumes[n].getUnionVolume(0);
+	}
+
+	std::shared_ptr<CragVolume> volume = _cache.get(_crag.id(n));
+	if (volume)
+		return volume;
+
+	UnionVolume parts = childVolumes(n);
+
+	// materialize without holding the lock
+	return _cache.put(_crag.id(n), parts.materialize());
+}
+
+void
+CragVolumes::materializeSubtree(Crag::CragNode n) const {
+
+	const CragHierarchyIndex& index = _crag.getHierarchyIndex();
+
+	// all non-leaf descendants of n in post-order, i.e., children come before 
+	// their parents
+	std::vector<Crag::CragNode> nodes;
+	index.forEachDescendant(n, [&](Crag::CragNode d) {
+		if (!_crag.isLeafNode(d))
+			nodes.push_back(d);
+	});
+
+	// keep each node in the cache until all of its parents in the subtree 
+	// have been materialized
+	for (Crag::CragNode d : nodes)
+		for (Crag::CragArc a : _crag.outArcs(d))
+			if (index.isDescendant(a.target(), n))
+				pin(d);
+
+	for (Crag::CragNode d : nodes) {
+
+		operator[](d);
+
+		for (Crag::CragArc a : _crag.inArcs(d))
+			if (!_crag.isLeafNode(a.source()))
+				unpin(a.source());
+	}
+}
+
+bool
+CragVolumes::needsMaterialization(Crag::CragNode n) const {
+
+	if (_crag.isLeafNode(n))
+		return false;
 
-	update(n);
+	// volumes set for higher nodes are ignored in these modes
+	if (_labelVolume || _loader)
+		return true;
 
-	UnionVolume& v = _volumes[n];
-	return _cache.get(n, [v]{ return v.materialize(); });
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	return _volumes[n].numUnionVolumes() != 1;
 }
 
 bool
@@ -47,6 +240,106 @@ CragVolumes::clearCache() {
 	_cache.clear();
 }
 
+UnionVolume
+CragVolumes::childVolumes(Crag::CragNode n) const {
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	std::vector<std::shared_ptr<CragVolume>> parts;
+
+	for (Crag::CragArc a : _crag.inArcs(n)) {
+
+		Crag::CragNode c = a.source();
+
+		update(c);
+
+		// leaf volumes and children with a single leaf
+		if (_volumes[c].numUnionVolumes() == 1) {
+
+			parts.push_back(_volumes[c].getUnionVolume(0));
+			continue;
+		}
+
+		// materialized children
+		std::shared_ptr<CragVolume> volume = _cache.get(_crag.id(c));
+		if (volume) {
+
+			parts.push_back(volume);
+			continue;
+		}
+
+		// the leaf volumes of all other children
+		for (std::size_t i = 0; i < _volumes[c].numUnionVolumes(); i++)
+			parts.push_back(_volumes[c].getUnionVolume(i));
+	}
+
+	// n is a leaf node without volume, let update() report it
+	if (parts.empty())
+		update(n);
+
+	return UnionVolume(parts);
+}
+
+UnionVolume
+CragVolumes::loadedChildVolumes(Crag::CragNode n) const {
+
+	std::vector<std::shared_ptr<CragVolume>> parts;
+
+	for (Crag::CragArc a : _crag.inArcs(n)) {
+
+		Crag::CragNode c = a.source();
+
+		if (_crag.isLeafNode(c)) {
+
+			parts.push_back(loadLeafVolume(c));
+			continue;
+		}
+
+		// materialized children
+		std::shared_ptr<CragVolume> volume = _cache.get(_crag.id(c));
+		if (volume) {
+
+			parts.push_back(volume);
+			continue;
+		}
+
+		// the leaf volumes of all other children
+		_crag.getHierarchyIndex().forEachLeafNode(c, [&](Crag::CragNode l) {
+			parts.push_back(loadLeafVolume(l));
+		});
+	}
+
+	return UnionVolume(parts);
+}
+
+std::shared_ptr<CragVolume>
+CragVolumes::loadLeafVolume(Crag::CragNode n) const {
+
+	return _cache.get(_crag.id(n), [&]{
+
+		std::lock_guard<std::mutex> lock(_loaderMutex);
+
+		std::shared_ptr<CragVolume> volume = _loader(n);
+		if (!volume)
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"node " << _crag.id(n) << " is a leaf node but no volume could be loaded");
+
+		return volume;
+	});
+}
+
+util::box<float, 3>
+CragVolumes::leafBoundingBoxes(Crag::CragNode n) const {
+
+	util::box<float, 3> bb;
+	_crag.getHierarchyIndex().forEachLeafNode(n, [&](Crag::CragNode l) {
+		bb += _leafBoundingBoxes[l];
+	});
+
+	return bb;
+}
+
 void
 CragVolumes::update(Crag::CragNode n) const {
 
@@ -62,8 +355,15 @@ CragVolumes::update(Crag::CragNode n) const {
 		auto leafNodes = _crag.leafNodes(n);
 		std::vector<std::shared_ptr<CragVolume>> leafVolumes;
 
-		for (Crag::CragNode l : leafNodes)
-			leafVolumes.push_back(this->operator[](l));
+		for (Crag::CragNode l : leafNodes) {
+
+			if (_volumes[l].numUnionVolumes() != 1)
+				UTIL_THROW_EXCEPTION(
+						UsageError,
+						"node " << _crag.id(l) << " is a leaf node but has no volume assigned");
+
+			leafVolumes.push_back(_volumes[l].getUnionVolume(0));
+		}
 		_volumes[n] = UnionVolume(leafVolumes);
 	}
 }
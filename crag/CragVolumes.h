@@ -1,16 +1,39 @@
 #ifndef CANDIDATE_MC_CRAG_CRAG_VOLUMES_H__
 #define CANDIDATE_MC_CRAG_CRAG_VOLUMES_H__
 
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <imageprocessing/ExplicitVolume.h>
-#include <util/cache.hpp>
 #include "Crag.h"
 #include "CragVolume.h"
+#include "LabelMaskView.h"
 #include "UnionVolume.h"
+#include "VolumeCache.h"
 
 /**
  * A node property map for Crags that provides the volumes of candidates as 
  * CragVolume.
+ *
+ * Volumes of higher candidates are materialized on demand and kept in a 
+ * VolumeCache with a memory budget given by the program option 
+ * volumeCacheSize. Materialization does not hold a lock, such that different 
+ * threads can materialize different candidates concurrently.
+ *
+ * Alternatively, the volumes can be backed by a single label volume (see 
+ * setLabelVolume()). In this mode, each leaf node is represented by a label 
+ * and a bounding box, and the volume of each candidate is the set of voxels 
+ * with one of the labels of its leaf nodes. Masks can be obtained without 
+ * copying voxels through getMask().
+ *
+ * Leaf node volumes can also be loaded on demand (see setVolumeLoader()), in 
+ * which case they are kept in the cache like materialized volumes, and only 
+ * their bounding boxes are held in memory.
+ *
+ * Concurrent calls to the const methods operator[](), getBoundingBox(n), 
+ * pin(), and unpin() are safe. The bounding box of all volumes 
+ * (getBoundingBox()) is computed lazily and should be requested once before 
+ * concurrent access. Setting volumes is not thread-safe.
  */
 class CragVolumes : public Volume {
 
@@ -26,12 +49,19 @@ public:
 
 	CragVolumes(CragVolumes&& other) :
 		_crag(other._crag),
-		_volumes(other._crag) {
+		_volumes(other._crag),
+		_cache(other._cache.getMaxBytes()),
+		_labelVolume(other._labelVolume),
+		_leafLabels(other._crag),
+		_loader(std::move(other._loader)),
+		_leafBoundingBoxes(other._crag) {
 
 		for (Crag::CragNode n : _crag.nodes()) {
 
 			_volumes[n] = other._volumes[n];
 			other._volumes[n].clear();
+			_leafLabels[n] = other._leafLabels[n];
+			_leafBoundingBoxes[n] = other._leafBoundingBoxes[n];
 		}
 	}
 
@@ -40,12 +70,118 @@ public:
 	 */
 	void setVolume(Crag::CragNode n, std::shared_ptr<CragVolume> volume);
 
+	typedef std::function<std::shared_ptr<CragVolume>(Crag::CragNode)> VolumeLoader;
+
+	/**
+	 * Load leaf node volumes on demand with the given function, instead of 
+	 * setting them with setVolume(). The bounding box of each leaf node has to 
+	 * be given with setLeafBoundingBox(). Calls to the loader are serialized.
+	 */
+	void setVolumeLoader(VolumeLoader loader);
+
+	/**
+	 * Set the bounding box of a leaf node whose volume is loaded on demand.
+	 */
+	void setLeafBoundingBox(Crag::CragNode n, const util::box<float, 3>& bb);
+
+	/**
+	 * Return true if leaf node volumes are loaded on demand.
+	 */
+	bool hasVolumeLoader() const { return static_cast<bool>(_loader); }
+
+	/**
+	 * Use the given label volume for all candidates. Leaf node volumes set 
+	 * with setVolume() are ignored from now on.
+	 */
+	void setLabelVolume(std::shared_ptr<const LabelMaskView::LabelVolume> labelVolume);
+
+	/**
+	 * Set the label of a leaf node and the discrete bounding box of this label 
+	 * in the label volume. Label 0 is reserved for background.
+	 */
+	void setLeafLabel(Crag::CragNode n, int label, const util::box<unsigned int, 3>& bb);
+
+	/**
+	 * Return true if the volumes are backed by a label volume.
+	 */
+	bool hasLabelVolume() const { return static_cast<bool>(_labelVolume); }
+
+	/**
+	 * Get the label volume, if set.
+	 */
+	std::shared_ptr<const LabelMaskView::LabelVolume> getLabelVolume() const { return _labelVolume; }
+
+	/**
+	 * Get the label of a leaf node, or 0 if it has none.
+	 */
+	int getLeafLabel(Crag::CragNode n) const { return _leafLabels[n].label; }
+
+	/**
+	 * Get the discrete bounding box of the label of a leaf node.
+	 */
+	const util::box<unsigned int, 3>& getLeafLabelBoundingBox(Crag::CragNode n) const { return _leafLabels[n].bb; }
+
+	/**
+	 * Get the volume of a candidate as a view on the label volume. Only 
+	 * available if the volumes are backed by a label volume.
+	 */
+	LabelMaskView getMask(Crag::CragNode n) const;
+
 	/**
 	 * Get the volume of a candidate. If the candidate is a higher candidate, 
-	 * it's volume will be materialized from the leaf node volume it merges.
+	 * it's volume will be materialized from the volumes of its children. 
+	 * Children that are not in the cache contribute their leaf node volumes 
+	 * instead.
 	 */
 	std::shared_ptr<CragVolume> operator[](Crag::CragNode n) const;
 
+	/**
+	 * Call f(x, y, z) for each voxel of the volume of a candidate, with 
+	 * positions relative to the discrete bounding box of the volume (as 
+	 * returned by operator[]()). For volumes backed by a label volume, the 
+	 * label volume is read directly and the volume is not materialized.
+	 */
+	template <typename F>
+	void forEachVoxel(Crag::CragNode n, F f) const {
+
+		if (_labelVolume) {
+
+			util::box<unsigned int, 3> bb;
+			std::vector<LeafLabel> leaves = getLeafLabels(n, bb);
+			forEachLabelVoxel(leaves, bb, f);
+
+			return;
+		}
+
+		std::shared_ptr<CragVolume> volume = operator[](n);
+
+		for (unsigned int z = 0; z < volume->depth();  z++)
+		for (unsigned int y = 0; y < volume->height(); y++)
+		for (unsigned int x = 0; x < volume->width();  x++)
+			if ((*volume)(x, y, z))
+				f(x, y, z);
+	}
+
+	/**
+	 * The number of voxels of the volume of a candidate. Does not materialize 
+	 * the volume if it is backed by a label volume.
+	 */
+	std::size_t numVoxels(Crag::CragNode n) const;
+
+	/**
+	 * Materialize the volumes of n and all its descendants bottom-up, such 
+	 * that each volume is created from the volumes of its children. Children 
+	 * are pinned in the cache until all their parents are materialized.
+	 */
+	void materializeSubtree(Crag::CragNode n) const;
+
+	/**
+	 * Return true if operator[]() has to materialize the volume of n from the 
+	 * volumes of its children, i.e., n is not a leaf node and no volume has 
+	 * been set for n with setVolume() (or n has more than one leaf node).
+	 */
+	bool needsMaterialization(Crag::CragNode n) const;
+
 	/**
 	 * Get the bounding box of all volumes combined.
 	 */
@@ -59,6 +195,14 @@ public:
 	 */
 	util::box<float,3> getBoundingBox(Crag::CragNode n) const {
 
+		if (_labelVolume)
+			return getMask(n).getBoundingBox();
+
+		if (_loader)
+			return leafBoundingBoxes(n);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
 		update(n);
 		return _volumes[n].getBoundingBox();
 	}
@@ -79,11 +223,52 @@ public:
 	 */
 	void clearCache();
 
+	/**
+	 * Keep the materialized volume of n in the cache until unpin(n) is 
+	 * called, e.g., while it is used repeatedly by a feature provider.
+	 */
+	void pin(Crag::CragNode n) const { _cache.pin(_crag.id(n)); }
+
+	/**
+	 * Release a pin set with pin().
+	 */
+	void unpin(Crag::CragNode n) const { _cache.unpin(_crag.id(n)); }
+
+	/**
+	 * Set the memory budget of the cache for materialized volumes in bytes.
+	 */
+	void setCacheSize(std::size_t bytes) { _cache.setMaxBytes(bytes); }
+
+	/**
+	 * Get hit, miss, and eviction counts of the cache for materialized 
+	 * volumes.
+	 */
+	VolumeCache::Statistics getCacheStatistics() const { return _cache.getStatistics(); }
+
 protected:
 
 	util::box<float,3> computeBoundingBox() const override {
 
 		util::box<float, 3> bb;
+
+		if (_labelVolume) {
+
+			for (Crag::CragNode n : _crag.nodes())
+				if (_crag.isLeafNode(n))
+					bb += getMask(n).getBoundingBox();
+
+			return bb;
+		}
+
+		if (_loader) {
+
+			for (Crag::CragNode n : _crag.nodes())
+				if (_crag.isLeafNode(n))
+					bb += _leafBoundingBoxes[n];
+
+			return bb;
+		}
+
 		for (Crag::CragNode n : _crag.nodes())
 			// Here we deliberatly ignore empty UnionVolumes. Since they are 
 			// composed of leaf nodes anyway, their bounding box does not 
@@ -96,12 +281,69 @@ protected:
 
 private:
 
+	struct LeafLabel {
+
+		LeafLabel() : label(0) {}
+
+		int                        label;
+		util::box<unsigned int, 3> bb;
+	};
+
+	// get the union of the volumes of the children of n, using materialized 
+	// volumes from the cache where available
+	UnionVolume childVolumes(Crag::CragNode n) const;
+
+	// same as childVolumes() for leaf node volumes that are loaded on demand
+	UnionVolume loadedChildVolumes(Crag::CragNode n) const;
+
+	// get a leaf node volume that is loaded on demand
+	std::shared_ptr<CragVolume> loadLeafVolume(Crag::CragNode n) const;
+
+	// the bounding box of all leaf nodes under n
+	util::box<float, 3> leafBoundingBoxes(Crag::CragNode n) const;
+
+	// the distinct leaf labels under n, and their combined discrete bounding 
+	// box in the label volume
+	std::vector<LeafLabel> getLeafLabels(Crag::CragNode n, util::box<unsigned int, 3>& bb) const;
+
+	// create the volume of n from the label volume
+	std::shared_ptr<CragVolume> materializeLabels(Crag::CragNode n) const;
+
+	// call f(x, y, z) for each voxel with one of the given leaf labels, 
+	// relative to bb
+	template <typename F>
+	void forEachLabelVoxel(const std::vector<LeafLabel>& leaves, const util::box<unsigned int, 3>& bb, F f) const {
+
+		const LabelMaskView::LabelVolume& labels = *_labelVolume;
+
+		// only the bounding box of each label is visited, and each voxel is 
+		// compared to a single label
+		for (const LeafLabel& leaf : leaves)
+			for (unsigned int z = leaf.bb.min().z(); z < leaf.bb.max().z(); z++)
+			for (unsigned int y = leaf.bb.min().y(); y < leaf.bb.max().y(); y++)
+			for (unsigned int x = leaf.bb.min().x(); x < leaf.bb.max().x(); x++)
+				if (labels(x, y, z) == leaf.label)
+					f(x - bb.min().x(), y - bb.min().y(), z - bb.min().z());
+	}
+
 	void update(Crag::CragNode n) const;
 
 	const Crag& _crag;
 
 	mutable Crag::NodeMap<UnionVolume> _volumes;
-	mutable cache<Crag::CragNode, std::shared_ptr<CragVolume>> _cache;
+	mutable VolumeCache _cache;
+
+	// protects _volumes for concurrent const access
+	mutable std::mutex _mutex;
+
+	std::shared_ptr<const LabelMaskView::LabelVolume> _labelVolume;
+	Crag::NodeMap<LeafLabel>                           _leafLabels;
+
+	VolumeLoader                       _loader;
+	Crag::NodeMap<util::box<float, 3>> _leafBoundingBoxes;
+
+	// serializes calls to _loader
+	mutable std::mutex _loaderMutex;
 };
 
 #endif // CANDIDATE_MC_CRAG_CRAG_VOLUMES_H__
@@ -1,5 +1,8 @@
+#include "CragBuilder.h"
 #include "DownSampler.h"
+#include "Parallel.h"
 #include <util/Logger.h>
+#include <util/exceptions.h>
 #include <util/timing.h>
 
 logger::LogChannel downsamplerlog("downsamplerlog", "[DownSampler] ");
@@ -11,111 +14,182 @@ DownSampler::process(const Crag& crag, const CragVolumes& volumes, Crag& downSam
 
 	UTIL_TIME_METHOD;
 
-	_copyMap.clear();
-	_sizes.clear();
+	CragHierarchyIndex index(crag);
 
-	// downsample the graph
-	for (Crag::CragNode n : crag.nodes()) {
+	const int numNodes = index.numNodes();
 
-		if (crag.isRootNode(n)) {
+	// by post-order rank: the rank of the first descendant (the descendants of
+	// a node are the ranks [firstDescendant, rank]) and the number of children
+	std::vector<int> firstDescendants(numNodes);
+	std::vector<int> numChildren(numNodes, 0);
+	std::vector<int> roots;
 
-			LOG_DEBUG(downsamplerlog)
-					<< "downsampling below root node " << crag.id(n)
-					<< std::endl;
+	for (int r = 0; r < numNodes; r++) {
 
-			downSampleCopy(
-					crag,
-					volumes,
-					n, /* root nodes are always valid parents... */
-					n,
-					false, /* ...and not single children */
-					downSampled);
-		}
+		Crag::CragNode n = index.nodeAtRank(r);
+
+		int numParents = crag.outArcs(n).size();
+
+		if (numParents > 1)
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"only subset trees can be downsampled, node " <<
+					crag.id(n) << " has more than one parent");
+
+		if (numParents == 0)
+			roots.push_back(r);
+
+		firstDescendants[r] = index.descendantIntervals(n).begin()->begin;
+		numChildren[r] = crag.inArcs(n).size();
 	}
 
-	// make sure all copied nodes have a valid volume
-	unsigned int numOriginalNodes = 0;
-	unsigned int numDownsampledNodes = 0;
-	for (Crag::CragNode n : crag.nodes()) {
+	std::vector<int> sizes;
+	if (_minSize >= 0)
+		sizes = computeSizes(volumes, index, firstDescendants, roots);
+
+	// for each tree, the ranks of the nodes to copy in DFS pre-order, and the
+	// position of the copied parent of each of them in this list (-1 for the
+	// root)
+	std::vector<std::vector<int>> copies(roots.size());
+	std::vector<std::vector<int>> copyParents(roots.size());
+
+	parallelFor(roots.size(), [&](std::size_t t) {
+
+		// the node, the position of the last copied ancestor (the last valid
+		// parent, i.e., a node with more than one valid child or a root node),
+		// and whether the node is a single child
+		struct Visit {
+
+			int  rank;
+			int  parent;
+			bool singleChild;
+		};
+
+		std::vector<Visit> stack;
+		stack.push_back(Visit{roots[t], -1, false});
+
+		while (!stack.empty()) {
+
+			Visit v = stack.back();
+			stack.pop_back();
+
+			int  r      = v.rank;
+			bool isLeaf = (firstDescendants[r] == r);
+			bool isRoot = (v.parent < 0);
+
+			bool valid;
+			if (_minSize >= 0)
+				valid = (sizes[r] >= _minSize || isRoot);
+			else
+				valid = (isLeaf || isRoot);
+
+			// if n is too small (and we have a size threshold), there is
+			// nothing to copy anymore
+			if (_minSize >= 0 && !valid)
+				continue;
+
+			int parent = v.parent;
+
+			// n is valid and not a single child -- copy it and make it the
+			// last valid parent
+			if (valid && !v.singleChild) {
+
+				copies[t].push_back(r);
+				copyParents[t].push_back(v.parent);
+				parent = copies[t].size() - 1;
+			}
+
+			// in post-order, the last child of r is r - 1, and each child
+			// directly follows the descendants of its previous sibling, push
+			// them last to first to visit them in the order of inArcs()
+			bool singleChild = (numChildren[r] == 1);
+			for (int c = r - 1; c >= firstDescendants[r]; c = firstDescendants[c] - 1)
+				stack.push_back(Visit{c, parent, singleChild});
+		}
+	});
 
-		numOriginalNodes++;
+	// add the copies tree by tree, in the order they would have been added
+	// by a sequential traversal
+	CragBuilder builder(downSampled);
 
-		if (!_copyMap.count(n))
-			continue;
+	std::size_t numCopies = 0;
+	for (const auto& c : copies)
+		numCopies += c.size();
 
-		numDownsampledNodes++;
-		Crag::CragNode copy = _copyMap[n];
+	builder.reserveNodes(numCopies);
+	builder.reserveArcs(numCopies);
 
-		downSampledVolumes.setVolume(copy, volumes[n]);
+	std::vector<Crag::CragNode> originals;
+	originals.reserve(numCopies);
+
+	for (std::size_t t = 0; t < roots.size(); t++) {
+
+		CragBuilder::Slot first = builder.numSlots();
+
+		for (std::size_t i = 0; i < copies[t].size(); i++) {
+
+			Crag::CragNode n = index.nodeAtRank(copies[t][i]);
+
+			CragBuilder::Slot copy = builder.addNode(crag.type(n));
+			if (copyParents[t][i] >= 0)
+				builder.addSubsetArc(copy, first + copyParents[t][i]);
+
+			originals.push_back(n);
+		}
 	}
 
+	std::vector<Crag::CragNode> copyNodes = builder.build();
+
+	// make sure all copied nodes have a valid volume
+	std::vector<std::shared_ptr<CragVolume>> copyVolumes(numCopies);
+	parallelFor(numCopies, [&](std::size_t i) {
+
+		copyVolumes[i] = volumes[originals[i]];
+	});
+
+	for (std::size_t i = 0; i < numCopies; i++)
+		downSampledVolumes.setVolume(copyNodes[i], copyVolumes[i]);
+
 	LOG_USER(downsamplerlog)
 			<< "downsampled CRAG contains "
-			<< numDownsampledNodes << " nodes, "
-			<< (numOriginalNodes - numDownsampledNodes) << " less "
+			<< numCopies << " nodes, "
+			<< (numNodes - numCopies) << " less "
 			<< "then original CRAG"
 			<< std::endl;
 }
 
-void
-DownSampler::downSampleCopy(const Crag& source, const CragVolumes& sourceVolumes, Crag::CragNode parent, Crag::CragNode n, bool singleChild, Crag& target) {
-
-	// parent is the last valid parent node, i.e., a node with more than one 
-	// valid child or a root node
-	//
-	// n is the current traversal node below parent
-	//
-	// singleChild is true, if n is a single child
+std::vector<int>
+DownSampler::computeSizes(
+		const CragVolumes&        volumes,
+		const CragHierarchyIndex& index,
+		const std::vector<int>&   firstDescendants,
+		const std::vector<int>&   roots) {
 
-	bool valid;
-	if (_minSize >= 0)
-		valid = (size(source, sourceVolumes, n) >= _minSize || source.isRootNode(n));
-	else
-		valid = (source.isLeafNode(n) || source.isRootNode(n));
+	UTIL_TIME_METHOD;
 
-	// if n is too small (and we have a size threshold), there is nothing to copy anymore, we can stop
-	if (_minSize >= 0 && !valid)
-		return;
+	std::vector<int> sizes(index.numNodes(), 0);
 
-	// n is valid and not a single child -- copy it to the target graph
-	if (valid && !singleChild) {
+	parallelFor(roots.size(), [&](std::size_t t) {
 
-		Crag::CragNode copy = target.addNode(source.type(n));
-		_copyMap[n] = copy;
+		int root = roots[t];
 
-		// for the first call, root == parent == n
-		if (n != parent)
-			target.addSubsetArc(copy, _copyMap[parent]);
+		for (int r = firstDescendants[root]; r <= root; r++) {
 
-		// n is now the previous valid parent
-		parent = n;
-	}
+			Crag::CragNode n = index.nodeAtRank(r);
 
-	int numChildren = source.inArcs(n).size();
+			// volumes that are the union of the (disjoint) children's volumes
+			// do not need to be materialized to count their voxels
+			if (volumes.needsMaterialization(n)) {
 
-	for (Crag::CragArc childEdge : source.inArcs(n))
-		downSampleCopy(
-				source,
-				sourceVolumes,
-				parent,
-				childEdge.source(),
-				(numChildren == 1),
-				target);
-}
+				for (int c = r - 1; c >= firstDescendants[r]; c = firstDescendants[c] - 1)
+					sizes[r] += sizes[c];
 
-int
-DownSampler::size(const Crag& crag, const CragVolumes& volumes, Crag::CragNode n) {
+				continue;
+			}
 
-	UTIL_TIME_METHOD;
-
-	if (_sizes.count(n))
-		return _sizes[n];
-
-	int nodeSize = 0;
-	for (auto& p : volumes[n]->data())
-		if (p)
-			nodeSize++;
-	_sizes[n] = nodeSize;
+			sizes[r] = volumes.numVoxels(n);
+		}
+	});
 
-	return nodeSize;
+	return sizes;
 }
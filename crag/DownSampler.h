@@ -1,10 +1,16 @@
 #ifndef CANDIDATE_MC_CRAG_DOWN_SAMPLER_H__
 #define CANDIDATE_MC_CRAG_DOWN_SAMPLER_H__
 
-#include <map>
+#include <vector>
 #include "Crag.h"
+#include "CragHierarchyIndex.h"
 #include "CragVolumes.h"
 
+/**
+ * Copies a CRAG without the candidates that are too small, or without all
+ * intermediate candidates. The subset trees of the CRAG are processed in
+ * parallel.
+ */
 class DownSampler {
 
 public:
@@ -18,7 +24,9 @@ public:
 		_minSize(minSize) {}
 
 	/**
-	 * Downsample the given CRAG.
+	 * Downsample the given CRAG. Each node of the CRAG can have at most one 
+	 * parent. For the size threshold, the leaf node volumes are assumed to be 
+	 * disjoint.
 	 *
 	 * @param[in]  crag
 	 *                    The CRAG to downsample.
@@ -33,14 +41,15 @@ public:
 
 private:
 
-	void downSampleCopy(const Crag& source, const CragVolumes& volumes, Crag::CragNode parent, Crag::CragNode n, bool singleChild, Crag& target);
-
-	int size(const Crag& crag, const CragVolumes& volumes, Crag::CragNode n);
+	// the number of voxels of each node by post-order rank, computed bottom-up 
+	// in the subset trees with the given roots
+	std::vector<int> computeSizes(
+			const CragVolumes&        volumes,
+			const CragHierarchyIndex& index,
+			const std::vector<int>&   firstDescendants,
+			const std::vector<int>&   roots);
 
 	int _minSize;
-
-	std::map<Crag::CragNode, Crag::CragNode> _copyMap;
-	std::map<Crag::CragNode, int> _sizes;
 };
 
 #endif // CANDIDATE_MC_CRAG_DOWN_SAMPLER_H__
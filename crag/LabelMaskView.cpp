@@ -0,0 +1,37 @@
+#include "LabelMaskView.h"
+
+LabelMaskView::LabelMaskView(
+		std::shared_ptr<const LabelVolume> labelVolume,
+		const util::box<unsigned int, 3>&  bb,
+		std::vector<int>                   labels) :
+	_labelVolume(labelVolume),
+	_bb(bb),
+	_labels(std::move(labels)) {
+
+	setResolution(_labelVolume->getResolution());
+	setOffset(_labelVolume->getOffset() + _bb.min()*_labelVolume->getResolution());
+	setDiscreteBoundingBoxDirty();
+}
+
+std::size_t
+LabelMaskView::count() const {
+
+	std::size_t count = 0;
+	forEachVoxel([&](unsigned int, unsigned int, unsigned int) { count++; });
+
+	return count;
+}
+
+std::shared_ptr<CragVolume>
+LabelMaskView::materialize() const {
+
+	auto volume = std::make_shared<CragVolume>(width(), height(), depth(), 0);
+	volume->setResolution(getResolution());
+	volume->setOffset(getOffset());
+
+	forEachVoxel([&](unsigned int x, unsigned int y, unsigned int z) {
+		(*volume)(x, y, z) = 1;
+	});
+
+	return volume;
+}
@@ -0,0 +1,108 @@
+#ifndef CANDIDATE_MC_CRAG_LABEL_MASK_VIEW_H__
+#define CANDIDATE_MC_CRAG_LABEL_MASK_VIEW_H__
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <imageprocessing/DiscreteVolume.h>
+#include <imageprocessing/ExplicitVolume.h>
+#include "CragVolume.h"
+
+/**
+ * A binary volume that is defined by a set of labels in a label volume,
+ * restricted to a bounding box. A voxel is set if its label is one of the
+ * labels of the view. The label volume is not copied.
+ *
+ * Provides the same read interface as CragVolume (voxels are 1 or 0), with
+ * positions relative to the bounding box.
+ */
+class LabelMaskView : public DiscreteVolume {
+
+public:
+
+	typedef ExplicitVolume<int> LabelVolume;
+
+	LabelMaskView() {}
+
+	/**
+	 * Create a view on the given label volume.
+	 *
+	 * @param labelVolume
+	 *              The label volume.
+	 * @param bb
+	 *              The discrete bounding box of the view in the label volume.
+	 * @param labels
+	 *              The sorted labels that are part of the view.
+	 */
+	LabelMaskView(
+			std::shared_ptr<const LabelVolume> labelVolume,
+			const util::box<unsigned int, 3>&  bb,
+			std::vector<int>                   labels);
+
+	unsigned int width()  const { return _bb.width(); }
+	unsigned int height() const { return _bb.height(); }
+	unsigned int depth()  const { return _bb.depth(); }
+
+	unsigned char operator()(unsigned int x, unsigned int y, unsigned int z) const {
+
+		return contains((*_labelVolume)(_bb.min().x() + x, _bb.min().y() + y, _bb.min().z() + z));
+	}
+
+	/**
+	 * Test whether the given label is part of this view.
+	 */
+	bool contains(int label) const {
+
+		if (_labels.size() == 1)
+			return label == _labels[0];
+
+		return std::binary_search(_labels.begin(), _labels.end(), label);
+	}
+
+	/**
+	 * The sorted labels of this view.
+	 */
+	const std::vector<int>& getLabels() const { return _labels; }
+
+	/**
+	 * Call f(x, y, z) for each set voxel, with positions relative to the
+	 * bounding box.
+	 */
+	template <typename F>
+	void forEachVoxel(F f) const {
+
+		for (unsigned int z = 0; z < depth();  z++)
+		for (unsigned int y = 0; y < height(); y++)
+		for (unsigned int x = 0; x < width();  x++)
+			if ((*this)(x, y, z))
+				f(x, y, z);
+	}
+
+	/**
+	 * The number of set voxels.
+	 */
+	std::size_t count() const;
+
+	/**
+	 * Create a CragVolume copy of this view.
+	 */
+	std::shared_ptr<CragVolume> materialize() const;
+
+protected:
+
+	util::box<unsigned int,3> computeDiscreteBoundingBox() const override {
+
+		return util::box<unsigned int,3>(
+				util::point<unsigned int,3>(),
+				util::point<unsigned int,3>(width(), height(), depth()));
+	}
+
+private:
+
+	std::shared_ptr<const LabelVolume> _labelVolume;
+	util::box<unsigned int, 3>         _bb;
+	std::vector<int>                   _labels;
+};
+
+#endif // CANDIDATE_MC_CRAG_LABEL_MASK_VIEW_H__
+
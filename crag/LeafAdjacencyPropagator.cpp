@@ -0,0 +1,8 @@
+#include "LeafAdjacencyPropagator.h"
+
+void
+LeafAdjacencyPropagator::annotate(Crag& crag, const CragVolumes&) {
+
+	if (optionCragType.as<std::string>() == "full")
+		propagateLeafAdjacencies(crag);
+}
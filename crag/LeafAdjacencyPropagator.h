@@ -0,0 +1,24 @@
+#ifndef CANDIDATE_MC_CRAG_LEAF_ADJACENCY_PROPAGATOR_H__
+#define CANDIDATE_MC_CRAG_LEAF_ADJACENCY_PROPAGATOR_H__
+
+#include "AdjacencyAnnotator.h"
+
+/**
+ * An adjacency annotator for CRAGs that already have adjacency edges between 
+ * their leaf nodes, e.g., because they were taken from the region adjacency 
+ * graph that was used to create the CRAG. The leaf node adjacencies are only 
+ * propagated to super-candidates, without looking at the volumes.
+ */
+class LeafAdjacencyPropagator : public AdjacencyAnnotator {
+
+public:
+
+	/**
+	 * Add adjacency edges between super-candidates of adjacent leaf nodes, if 
+	 * option cragType is 'full'.
+	 */
+	void annotate(Crag& crag, const CragVolumes& volumes) override;
+};
+
+#endif // CANDIDATE_MC_CRAG_LEAF_ADJACENCY_PROPAGATOR_H__
+
@@ -39,6 +39,7 @@ MergeTreeParser::getCrag(Crag& crag, CragVolumes& volumes) {
 			_maxRegionSize);
 
 	parser.parse(visitor);
+	visitor.finish();
 }
 
 MergeTreeParser::MergeTreeVisitor::MergeTreeVisitor(
@@ -51,11 +52,10 @@ MergeTreeParser::MergeTreeVisitor::MergeTreeVisitor(
 		unsigned int                 maxRegionSize) :
 	_resolution(resolution),
 	_offset(offset),
-	_crag(crag),
 	_volumes(volumes),
 	_minSize(minRegionSize),
 	_maxSize(maxRegionSize),
-	_extents(_crag),
+	_builder(crag),
 	_maxMerges(maxMerges) {}
 
 void
@@ -82,12 +82,12 @@ MergeTreeParser::MergeTreeVisitor::finalizeComponent(
 
 	// get all prospective children of this component
 
-	std::vector<Crag::CragNode> children;
+	std::vector<CragBuilder::Slot> children;
 	int level = 0;
 	while (!_roots.empty() && contained(_extents[_roots.top()], std::make_pair(begin, end))) {
 
 		children.push_back(_roots.top());
-		level = std::max(level, _crag.getLevel(_roots.top()) + 1);
+		level = std::max(level, _levels[_roots.top()] + 1);
 		_roots.pop();
 	}
 
@@ -101,12 +101,13 @@ MergeTreeParser::MergeTreeVisitor::finalizeComponent(
 	LOG_ALL(mergetreeparserlog) << "add it to crag" << std::endl;
 
 	// create a node (all nodes from a 2D merge-tree are slice nodes)
-	Crag::CragNode node = _crag.addNode(Crag::SliceNode);
-	_extents[node] = std::make_pair(begin, end);
+	CragBuilder::Slot node = _builder.addNode(Crag::SliceNode);
+	_extents.push_back(std::make_pair(begin, end));
+	_levels.push_back(level);
 
 	// connect it to children
-	for (Crag::CragNode child : children)
-		_crag.addSubsetArc(child, node);
+	for (CragBuilder::Slot child : children)
+		_builder.addSubsetArc(child, node);
 
 	bool isLeafNode = (level == 0);
 	LOG_ALL(mergetreeparserlog) << "is" << (isLeafNode ? "" : " not") << " a leaf node" << std::endl;
@@ -136,8 +137,21 @@ MergeTreeParser::MergeTreeVisitor::finalizeComponent(
 
 	volume->setResolution(_resolution);
 	volume->setOffset(volumeOffset);
-	_volumes.setVolume(node, volume);
+	_regionVolumes.push_back(volume);
 
 	// put the new node on the stack
 	_roots.push(node);
 }
+
+void
+MergeTreeParser::MergeTreeVisitor::finish() {
+
+	std::vector<Crag::CragNode> nodes = _builder.build();
+
+	for (std::size_t i = 0; i < nodes.size(); i++)
+		_volumes.setVolume(nodes[i], _regionVolumes[i]);
+
+	_extents.clear();
+	_levels.clear();
+	_regionVolumes.clear();
+}
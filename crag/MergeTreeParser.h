@@ -8,6 +8,7 @@
 #include <imageprocessing/ImageLevelParser.h>
 #include "Crag.h"
 #include "CragVolumes.h"
+#include "CragBuilder.h"
 
 class MergeTreeParser {
 
@@ -50,7 +51,8 @@ private:
 
 		/**
 		 * Create a merge tree visitor. The visitor will create ExplicitVolumes 
-		 * for each leaf node.
+		 * for each node. Nodes and volumes are collected and only added to 
+		 * the CRAG by a call to finish().
 		 *
 		 * @param resolution
 		 *              The resolution of the merge tree image.
@@ -93,6 +95,11 @@ private:
 				PixelList::const_iterator    begin,
 				PixelList::const_iterator    end);
 
+		/**
+		 * Add all collected nodes and their volumes to the CRAG.
+		 */
+		void finish();
+
 	private:
 
 		// is the first range contained in the second?
@@ -106,7 +113,6 @@ private:
 		util::point<float, 3> _resolution;
 		util::point<float, 3> _offset;
 
-		Crag&        _crag;
 		CragVolumes& _volumes;
 
 		unsigned int _minSize;
@@ -118,11 +124,16 @@ private:
 		PixelList::const_iterator _prevBegin;
 		PixelList::const_iterator _prevEnd;
 
+		// collects nodes and subset arcs
+		CragBuilder _builder;
+
 		// stack of open root nodes while constructing the tree
-		std::stack<Crag::CragNode> _roots;
+		std::stack<CragBuilder::Slot> _roots;
 
-		// extents of all regions
-		Crag::NodeMap<std::pair<PixelList::const_iterator, PixelList::const_iterator>> _extents;
+		// extents, levels, and volumes of all regions, by slot
+		std::vector<std::pair<PixelList::const_iterator, PixelList::const_iterator>> _extents;
+		std::vector<int> _levels;
+		std::vector<std::shared_ptr<CragVolume>> _regionVolumes;
 
 		int _maxMerges;
 	};
@@ -0,0 +1,23 @@
+#include <algorithm>
+#include <util/ProgramOptions.h>
+#include "Parallel.h"
+
+util::ProgramOption optionNumThreads(
+		util::_module           = "crag",
+		util::_long_name        = "numThreads",
+		util::_description_text = "The number of threads to use for parallel computations. "
+		                          "Set to 0 (default) to use all available cores.",
+		util::_default_value    = 0);
+
+thread_local bool detail::inParallelFor = false;
+
+int
+numThreads() {
+
+	int threads = optionNumThreads.as<int>();
+
+	if (threads <= 0)
+		threads = std::thread::hardware_concurrency();
+
+	return std::max(threads, 1);
+}
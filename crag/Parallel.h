@@ -0,0 +1,94 @@
+#ifndef CANDIDATE_MC_CRAG_PARALLEL_H__
+#define CANDIDATE_MC_CRAG_PARALLEL_H__
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Get the number of threads to use for parallel computations. This is the
+ * value of the program option numThreads, or the number of available cores
+ * if this option is not set (or zero).
+ */
+int numThreads();
+
+namespace detail {
+
+// true in threads that are currently executing a parallelFor
+extern thread_local bool inParallelFor;
+
+} // namespace detail
+
+/**
+ * Call f(i) for each i in [0, num) on numThreads() threads. Indices are
+ * handed out dynamically, such that each thread gets the next unprocessed
+ * index once it is done with the previous one. The calling thread is one of
+ * the worker threads.
+ *
+ * If f throws an exception, no further indices are handed out and the first
+ * exception is rethrown in the calling thread after all workers finished.
+ *
+ * Nested calls (from within f) are executed serially in the calling worker
+ * thread.
+ */
+template <typename F>
+void parallelFor(std::size_t num, F f) {
+
+	std::size_t threads = std::min(static_cast<std::size_t>(numThreads()), num);
+
+	if (threads <= 1 || detail::inParallelFor) {
+
+		for (std::size_t i = 0; i < num; i++)
+			f(i);
+		return;
+	}
+
+	std::atomic<std::size_t> next(0);
+	std::exception_ptr       error;
+	std::mutex               errorMutex;
+
+	auto worker = [&]() {
+
+		bool wasInParallelFor = detail::inParallelFor;
+		detail::inParallelFor = true;
+
+		while (true) {
+
+			std::size_t i = next++;
+			if (i >= num)
+				break;
+
+			try {
+
+				f(i);
+
+			} catch (...) {
+
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if (!error)
+					error = std::current_exception();
+				next = num;
+			}
+		}
+
+		detail::inParallelFor = wasInParallelFor;
+	};
+
+	std::vector<std::thread> workers;
+	for (std::size_t t = 1; t < threads; t++)
+		workers.emplace_back(worker);
+
+	worker();
+
+	for (std::thread& t : workers)
+		t.join();
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+#endif // CANDIDATE_MC_CRAG_PARALLEL_H__
+
@@ -1,35 +1,24 @@
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
 #include <util/Logger.h>
 #include <util/ProgramOptions.h>
 #include <util/box.hpp>
 #include <util/timing.h>
+#include "Parallel.h"
 #include "PlanarAdjacencyAnnotator.h"
-#include <vigra/impex.hxx>
 #include <vigra/functorexpression.hxx>
+#include <vigra/multi_pointoperators.hxx>
 #define WITH_LEMON
 #include <vigra/multi_gridgraph.hxx>
-#include <vigra/adjacency_list_graph.hxx>
-#include <vigra/graph_algorithms.hxx>
 
 logger::LogChannel planaradjacencyannotatorlog("planaradjacencyannotatorlog", "[PlanarAdjacencyAnnotator] ");
 
-util::ProgramOption optionCragType(
-		util::_long_name        = "cragType",
-		util::_description_text = "Controls which candidates are considered for adjacency in the CRAG: "
-		                          "'full' adds edges between each adjacent candidate across all levels, "
-		                          "'flat' adds edges only between leaf nodes, and 'empty' adds no adjacency "
-		                          "edges at all. Default is 'full'.",
-		util::_default_value    = "full");
-
-namespace vigra {
-
-	// type traits to use MultiArray as NodeMap
-	template <>
-	struct GraphMapTypeTraits<MultiArray<3, int> > {
-		typedef int        Value;
-		typedef int&       Reference;
-		typedef const int& ConstReference;
-	};
-} // namespace vigra
+util::ProgramOption optionAdjacencyTileSize(
+		util::_long_name        = "adjacencyTileSize",
+		util::_description_text = "The edge length in voxels of the tiles in which leaf node adjacencies are searched "
+		                          "for in parallel. The memory needed is bounded by one tile per thread.",
+		util::_default_value    = 256);
 
 void
 PlanarAdjacencyAnnotator::annotate(Crag& crag, const CragVolumes& volumes) {
@@ -55,89 +44,137 @@ PlanarAdjacencyAnnotator::annotate(Crag& crag, const CragVolumes& volumes) {
 	if (resolution.isZero())
 		return;
 
-	// create a vigra multi-array large enough to hold all volumes
-	vigra::MultiArray<3, int> ids(
-			vigra::Shape3(
-				cragBB.width() /resolution.x(),
-				cragBB.height()/resolution.y(),
-				cragBB.depth() /resolution.z()),
-			std::numeric_limits<int>::max());
+	// the grid spans the bounding box of all volumes
+	vigra::Shape3 shape(
+			cragBB.width() /resolution.x() + 0.5,
+			cragBB.height()/resolution.y() + 0.5,
+			cragBB.depth() /resolution.z() + 0.5);
 
-	for (Crag::NodeIt n(crag); n != lemon::INVALID; ++n) {
+	vigra::GridGraph<3> grid(
+			shape,
+			_neighborhood == Direct ? vigra::DirectNeighborhood : vigra::IndirectNeighborhood);
+
+	// offsets to the neighbors that come later in scan order, such that each 
+	// grid edge is found exactly once from its first voxel
+	std::vector<vigra::Shape3> offsets;
+	for (int z = -1; z <= 1; z++)
+	for (int y = -1; y <= 1; y++)
+	for (int x = -1; x <= 1; x++) {
+
+		if (z < 0 || (z == 0 && (y < 0 || (y == 0 && x <= 0))))
+			continue;
+
+		if (_neighborhood == Direct && std::abs(x) + std::abs(y) + std::abs(z) != 1)
+			continue;
+
+		offsets.push_back(vigra::Shape3(x, y, z));
+	}
+
+	// the positions of the leaf nodes in the grid
+	std::vector<Leaf> leaves;
+	for (Crag::CragNode n : crag.nodes()) {
 
 		if (!crag.isLeafNode(n))
 			continue;
 
-		const util::point<float, 3>&      volumeOffset     = volumes[n]->getOffset();
-		const util::box<unsigned int, 3>& volumeDiscreteBB = volumes[n]->getDiscreteBoundingBox();
+		util::box<float, 3> bb = volumes.getBoundingBox(n);
 
-		util::point<unsigned int, 3> begin = (volumeOffset - cragBB.min())/resolution;
-		util::point<unsigned int, 3> end   = begin +
-				util::point<unsigned int, 3>(
-						volumeDiscreteBB.width(),
-						volumeDiscreteBB.height(),
-						volumeDiscreteBB.depth());
+		if (bb.isZero())
+			continue;
 
-		vigra::combineTwoMultiArrays(
-				volumes[n]->data(),
-				ids.subarray(
-						vigra::Shape3(
-								begin.x(),
-								begin.y(),
-								begin.z()),
-						vigra::Shape3(
-								end.x(),
-								end.y(),
-								end.z())),
-				ids.subarray(
-						vigra::Shape3(
-								begin.x(),
-								begin.y(),
-								begin.z()),
-						vigra::Shape3(
-								end.x(),
-								end.y(),
-								end.z())),
-				vigra::functor::ifThenElse(
-						vigra::functor::Arg1() == vigra::functor::Param(1),
-						vigra::functor::Param(crag.id(n)),
-						vigra::functor::Arg2()
-				));
+		Leaf leaf;
+		leaf.node = n;
+		for (int d = 0; d < 3; d++) {
+
+			leaf.begin[d] = (bb.min()[d] - cragBB.min()[d])/resolution[d] + 0.5;
+			leaf.end[d]   = (bb.max()[d] - cragBB.min()[d])/resolution[d] + 0.5;
+		}
+
+		leaves.push_back(leaf);
 	}
 
-	//vigra::exportImage(
-			//ids.bind<2>(0),
-			//vigra::ImageExportInfo("debug/ids.tif"));
+	// assign the leaves to all tiles they overlap with, including the margin 
+	// of one voxel around each tile
+	int tileSize = std::max(1, optionAdjacencyTileSize.as<int>());
 
-	typedef vigra::GridGraph<3>       GridGraphType;
-	typedef vigra::AdjacencyListGraph RagType;
+	vigra::Shape3 numTiles;
+	for (int d = 0; d < 3; d++)
+		numTiles[d] = (shape[d] + tileSize - 1)/tileSize;
 
-	GridGraphType grid(
-			ids.shape(),
-			_neighborhood == Direct ? vigra::DirectNeighborhood : vigra::IndirectNeighborhood);
-	RagType rag;
-	RagType::EdgeMap<std::vector<GridGraphType::Edge>> affiliatedEdges;
+	std::vector<std::vector<const Leaf*>> tileLeaves(numTiles[0]*numTiles[1]*numTiles[2]);
+
+	for (const Leaf& leaf : leaves) {
+
+		vigra::Shape3 first, last;
+		for (int d = 0; d < 3; d++) {
+
+			first[d] = std::max(vigra::MultiArrayIndex(0), (leaf.begin[d] + tileSize - 1)/tileSize - 1);
+			last[d]  = std::min(numTiles[d] - 1, leaf.end[d]/tileSize);
+		}
+
+		vigra::Shape3 t;
+		for (t[2] = first[2]; t[2] <= last[2]; t[2]++)
+		for (t[1] = first[1]; t[1] <= last[1]; t[1]++)
+		for (t[0] = first[0]; t[0] <= last[0]; t[0]++)
+			tileLeaves[t[0] + numTiles[0]*(t[1] + numTiles[1]*t[2])].push_back(&leaf);
+	}
+
+	LOG_DEBUG(planaradjacencyannotatorlog)
+			<< "searching for adjacencies in " << tileLeaves.size()
+			<< " tiles of size " << tileSize << std::endl;
+
+	std::vector<GridEdges> tileEdges(tileLeaves.size());
+
+	parallelFor(tileLeaves.size(), [&](std::size_t i) {
 
-	vigra::makeRegionAdjacencyGraph(
-			grid,
-			ids,
-			rag,
-			affiliatedEdges,
-			std::numeric_limits<int>::max());
+		vigra::Shape3 t(
+				i%numTiles[0],
+				(i/numTiles[0])%numTiles[1],
+				i/(numTiles[0]*numTiles[1]));
+
+		vigra::Shape3 begin = t*tileSize;
+		vigra::Shape3 end   = min(begin + vigra::Shape3(tileSize), shape);
+
+		findTileAdjacencies(crag, volumes, tileLeaves[i], grid, offsets, begin, end, tileEdges[i]);
+	});
+
+	// collect the grid edges in the order of the tiles, and sort them to not 
+	// depend on the tiling
+	GridEdges gridEdges;
+	for (GridEdges& edges : tileEdges) {
+
+		for (auto& p : edges) {
+
+			std::vector<int64_t>& ids = gridEdges[p.first];
+			ids.insert(ids.end(), p.second.begin(), p.second.end());
+		}
+
+		GridEdges().swap(edges);
+	}
 
 	unsigned int numAdded = 0;
 	crag.setGridGraph(grid);
-	for (RagType::EdgeIt e(rag); e != lemon::INVALID; ++e) {
 
-		int u = rag.id(rag.u(*e));
-		int v = rag.id(rag.v(*e));
+	std::size_t numAffiliatedEdges = 0;
+	for (auto& p : gridEdges)
+		numAffiliatedEdges += p.second.size();
+	crag.reserveAffiliatedEdges(numAffiliatedEdges);
+
+	for (auto& p : gridEdges) {
+
+		int u = p.first.first;
+		int v = p.first.second;
+
+		std::vector<int64_t>& ids = p.second;
+		std::sort(ids.begin(), ids.end());
 
 		Crag::CragEdge newEdge = crag.addAdjacencyEdge(
 				crag.nodeFromId(u),
 				crag.nodeFromId(v));
-		crag.setAffiliatedEdges(
+		crag.setAffiliatedEdgeIds(
 				newEdge,
-				affiliatedEdges[*e]);
+				ids.data(),
+				ids.data() + ids.size());
 		numAdded++;
 
 		LOG_ALL(planaradjacencyannotatorlog)
@@ -152,3 +189,84 @@ PlanarAdjacencyAnnotator::annotate(Crag& crag, const CragVolumes& volumes) {
 	if (optionCragType.as<std::string>() == "full")
 		propagateLeafAdjacencies(crag);
 }
+
+void
+PlanarAdjacencyAnnotator::findTileAdjacencies(
+		const Crag&                       crag,
+		const CragVolumes&                volumes,
+		const std::vector<const Leaf*>&   leaves,
+		const vigra::GridGraph<3>&        grid,
+		const std::vector<vigra::Shape3>& offsets,
+		const vigra::Shape3&              begin,
+		const vigra::Shape3&              end,
+		GridEdges&                        gridEdges) {
+
+	const int background = std::numeric_limits<int>::max();
+
+	// paint the leaves into the tile and a margin of one voxel around it
+	vigra::Shape3 paintBegin = max(begin - vigra::Shape3(1), vigra::Shape3(0));
+	vigra::Shape3 paintEnd   = min(end + vigra::Shape3(1), grid.shape());
+
+	vigra::MultiArray<3, int> ids(paintEnd - paintBegin, background);
+
+	for (const Leaf* leaf : leaves) {
+
+		std::shared_ptr<CragVolume> volume = volumes[leaf->node];
+
+		vigra::Shape3 leafEnd = leaf->begin + volume->data().shape();
+
+		vigra::Shape3 from = max(leaf->begin, paintBegin);
+		vigra::Shape3 to   = min(leafEnd, paintEnd);
+
+		if (!allLess(from, to))
+			continue;
+
+		vigra::combineTwoMultiArrays(
+				volume->data().subarray(from - leaf->begin, to - leaf->begin),
+				ids.subarray(from - paintBegin, to - paintBegin),
+				ids.subarray(from - paintBegin, to - paintBegin),
+				vigra::functor::ifThenElse(
+						vigra::functor::Arg1() == vigra::functor::Param(1),
+						vigra::functor::Param(crag.id(leaf->node)),
+						vigra::functor::Arg2()
+				));
+	}
+
+	// the edges of the current pair of leaves, consecutive voxels are likely 
+	// to be on the same boundary
+	std::pair<int, int>   current(background, background);
+	std::vector<int64_t>* currentIds = 0;
+
+	vigra::Shape3 p;
+	for (p[2] = begin[2]; p[2] < end[2]; p[2]++)
+	for (p[1] = begin[1]; p[1] < end[1]; p[1]++)
+	for (p[0] = begin[0]; p[0] < end[0]; p[0]++) {
+
+		int a = ids[p - paintBegin];
+
+		if (a == background)
+			continue;
+
+		for (const vigra::Shape3& offset : offsets) {
+
+			vigra::Shape3 q = p + offset;
+
+			if (!ids.isInside(q - paintBegin))
+				continue;
+
+			int b = ids[q - paintBegin];
+
+			if (b == a || b == background)
+				continue;
+
+			std::pair<int, int> pair(std::min(a, b), std::max(a, b));
+			if (pair != current) {
+
+				current    = pair;
+				currentIds = &gridEdges[pair];
+			}
+
+			currentIds->push_back(grid.id(grid.findEdge(p, q)));
+		}
+	}
+}
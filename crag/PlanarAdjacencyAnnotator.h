@@ -1,11 +1,21 @@
 #ifndef CANDIDATE_MC_CRAG_PLANAR_ADJACENCY_ANNOTATOR_H__
 #define CANDIDATE_MC_CRAG_PLANAR_ADJACENCY_ANNOTATOR_H__
 
+#include <map>
+#include <vector>
 #include "AdjacencyAnnotator.h"
 
+extern util::ProgramOption optionAdjacencyTileSize;
+
 /**
  * A CRAG adjacency annotator that extends a given CRAG with adjacency edges, if 
  * the respective candidates are touching.
+ *
+ * The leaf node volumes are painted into tiles of the CRAG bounding box (of 
+ * the size given by program option adjacencyTileSize), which are processed in 
+ * parallel. Each tile is painted with a margin of one voxel, such that 
+ * adjacencies across tile faces are found by the tile containing the lower 
+ * voxel.
  */
 class PlanarAdjacencyAnnotator : public AdjacencyAnnotator {
 
@@ -35,6 +45,30 @@ public:
 
 private:
 
+	// a leaf node and the begin and end of its volume in the grid
+	struct Leaf {
+
+		Crag::CragNode node;
+		vigra::Shape3  begin;
+		vigra::Shape3  end;
+	};
+
+	// the ids of the grid edges between adjacent leaf nodes (by pairs of CRAG 
+	// ids)
+	typedef std::map<std::pair<int, int>, std::vector<int64_t>> GridEdges;
+
+	// find the grid edges between the given leaves that start in the tile 
+	// [begin, end)
+	void findTileAdjacencies(
+			const Crag&                       crag,
+			const CragVolumes&                volumes,
+			const std::vector<const Leaf*>&   leaves,
+			const vigra::GridGraph<3>&        grid,
+			const std::vector<vigra::Shape3>& offsets,
+			const vigra::Shape3&              begin,
+			const vigra::Shape3&              end,
+			GridEdges&                        gridEdges);
+
 	Neighborhood _neighborhood;
 };
 
@@ -1,3 +1,4 @@
+#include <cstring>
 #include "UnionVolume.h"
 
 std::shared_ptr<CragVolume>
@@ -21,6 +22,7 @@ UnionVolume::materialize() const {
 	util::point<unsigned int, 3> materializedOffset = bb.min()/resolution;
 
 	// combine union
+	bool first = true;
 	for (auto v : _union) {
 
 		const CragVolume& volume = *v;
@@ -34,21 +36,26 @@ UnionVolume::materialize() const {
 		// volume
 		util::point<unsigned int, 3> offset = volumeOffset - materializedOffset;
 
-		// copy volume into materialized
+		// check once per volume that it fits, instead of for every voxel
+		UTIL_ASSERT_REL(offset.x() + volume.width(),  <=, dbb.width());
+		UTIL_ASSERT_REL(offset.y() + volume.height(), <=, dbb.height());
+		UTIL_ASSERT_REL(offset.z() + volume.depth(),  <=, dbb.depth());
+
+		// copy volume into materialized, one row at a time
 		for (unsigned int z = 0; z < volume.depth();  z++)
-		for (unsigned int y = 0; y < volume.height(); y++)
-		for (unsigned int x = 0; x < volume.width();  x++) {
-
-			UTIL_ASSERT_REL(offset.x() + x, <, dbb.width());
-			UTIL_ASSERT_REL(offset.y() + y, <, dbb.height());
-			UTIL_ASSERT_REL(offset.z() + z, <, dbb.depth());
-
-			if (volume(x, y, z) > 0)
-				materialized(
-						offset.x() + x,
-						offset.y() + y,
-						offset.z() + z) = volume(x, y, z);
+		for (unsigned int y = 0; y < volume.height(); y++) {
+
+			const unsigned char* src = &volume.data()(0, y, z);
+			unsigned char*       dst = &materialized.data()(offset.x(), offset.y() + y, offset.z() + z);
+
+			// materialized is still empty
+			if (first)
+				std::memcpy(dst, src, volume.width());
+			else
+				combineRow(dst, src, volume.width());
 		}
+
+		first = false;
 	}
 
 	UTIL_ASSERT_REL(bb, ==, materialized.getBoundingBox());
@@ -69,6 +69,17 @@ private:
 
 	void updateResolutionOffset();
 
+	/**
+	 * Set each voxel of dst to the value of the corresponding voxel in src, if 
+	 * the latter is not zero.
+	 */
+	static inline void combineRow(unsigned char* dst, const unsigned char* src, unsigned int width) {
+
+		// branch-free, such that the compiler can vectorize it
+		for (unsigned int x = 0; x < width; x++)
+			dst[x] = (src[x] ? src[x] : dst[x]);
+	}
+
 	std::vector<std::shared_ptr<CragVolume>> _union;
 	util::box<unsigned int, 3> _discreteBb;
 };
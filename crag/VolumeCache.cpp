@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <util/exceptions.h>
+#include "VolumeCache.h"
+
+VolumeCache::VolumeCache(std::size_t maxBytes, std::size_t numShards) :
+	_shards(std::max(numShards, static_cast<std::size_t>(1))),
+	_maxBytes(maxBytes),
+	_bytes(0) {}
+
+void
+VolumeCache::setMaxBytes(std::size_t maxBytes) {
+
+	_maxBytes = maxBytes;
+
+	evict();
+}
+
+std::shared_ptr<CragVolume>
+VolumeCache::get(int id) {
+
+	Shard& s = shard(id);
+	std::lock_guard<std::mutex> lock(s.mutex);
+
+	auto i = s.index.find(id);
+	if (i == s.index.end()) {
+
+		s.misses++;
+		return std::shared_ptr<CragVolume>();
+	}
+
+	s.hits++;
+
+	// move to front
+	s.entries.splice(s.entries.begin(), s.entries, i->second);
+
+	return i->second->volume;
+}
+
+std::shared_ptr<CragVolume>
+VolumeCache::put(int id, std::shared_ptr<CragVolume> volume) {
+
+	if (!volume)
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"can not cache an empty volume for node " << id);
+
+	{
+		Shard& s = shard(id);
+		std::lock_guard<std::mutex> lock(s.mutex);
+
+		// somebody else was faster
+		auto i = s.index.find(id);
+		if (i != s.index.end()) {
+
+			s.entries.splice(s.entries.begin(), s.entries, i->second);
+			return i->second->volume;
+		}
+
+		std::size_t bytes = size(*volume);
+
+		s.entries.push_front(Entry{id, volume, bytes});
+		s.index[id] = s.entries.begin();
+		s.bytes += bytes;
+		_bytes  += bytes;
+	}
+
+	evict(id);
+
+	return volume;
+}
+
+void
+VolumeCache::pin(int id) {
+
+	Shard& s = shard(id);
+	std::lock_guard<std::mutex> lock(s.mutex);
+
+	s.pins[id]++;
+}
+
+void
+VolumeCache::unpin(int id) {
+
+	{
+		Shard& s = shard(id);
+		std::lock_guard<std::mutex> lock(s.mutex);
+
+		auto i = s.pins.find(id);
+		if (i == s.pins.end())
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"node " << id << " is not pinned");
+
+		if (--i->second == 0)
+			s.pins.erase(i);
+	}
+
+	evict();
+}
+
+void
+VolumeCache::clear() {
+
+	for (Shard& s : _shards) {
+
+		std::lock_guard<std::mutex> lock(s.mutex);
+
+		for (auto i = s.entries.begin(); i != s.entries.end();) {
+
+			if (s.pins.count(i->id)) {
+
+				++i;
+				continue;
+			}
+
+			s.bytes -= i->bytes;
+			_bytes  -= i->bytes;
+			s.index.erase(i->id);
+			i = s.entries.erase(i);
+		}
+	}
+}
+
+VolumeCache::Statistics
+VolumeCache::getStatistics() const {
+
+	Statistics stats{0, 0, 0, 0, 0};
+
+	for (const Shard& s : _shards) {
+
+		std::lock_guard<std::mutex> lock(s.mutex);
+
+		stats.hits      += s.hits;
+		stats.misses    += s.misses;
+		stats.evictions += s.evictions;
+		stats.entries   += s.entries.size();
+		stats.bytes     += s.bytes;
+	}
+
+	return stats;
+}
+
+std::size_t
+VolumeCache::size(const CragVolume& volume) {
+
+	return
+			sizeof(CragVolume) +
+			static_cast<std::size_t>(volume.width())*volume.height()*volume.depth()*sizeof(CragVolume::value_type);
+}
+
+void
+VolumeCache::evict(int keep) {
+
+	if (_bytes <= _maxBytes)
+		return;
+
+	std::lock_guard<std::mutex> evictionLock(_evictionMutex);
+
+	// the shard of keep is visited last in each round
+	std::size_t first = (keep < 0 ? 0 : shardIndex(keep) + 1);
+
+	bool evicted = true;
+	while (_bytes > _maxBytes && evicted) {
+
+		evicted = false;
+
+		for (std::size_t j = 0; j < _shards.size() && _bytes > _maxBytes; j++) {
+
+			Shard& s = _shards[(first + j)%_shards.size()];
+			std::lock_guard<std::mutex> lock(s.mutex);
+
+			if (evictOne(s, keep))
+				evicted = true;
+		}
+	}
+}
+
+bool
+VolumeCache::evictOne(Shard& s, int keep) {
+
+	for (auto i = s.entries.end(); i != s.entries.begin();) {
+
+		--i;
+
+		if (i->id == keep || s.pins.count(i->id))
+			continue;
+
+		s.bytes -= i->bytes;
+		_bytes  -= i->bytes;
+		s.index.erase(i->id);
+		s.entries.erase(i);
+		s.evictions++;
+
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,155 @@
+#ifndef CANDIDATE_MC_CRAG_VOLUME_CACHE_H__
+#define CANDIDATE_MC_CRAG_VOLUME_CACHE_H__
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "CragVolume.h"
+
+/**
+ * A thread-safe least-recently-used cache for materialized CragVolumes, keyed
+ * by node id and limited by the total number of bytes of the cached volumes.
+ *
+ * The cache is split into shards by node id, each with its own lock, such that
+ * concurrent accesses to different nodes rarely contend. The memory budget is
+ * shared by all shards. A newly added volume is always admitted, even if it is
+ * larger than the budget; to make room for it, the least recently used
+ * volumes of the other shards are evicted first (one per shard, round-robin).
+ * Volumes are created outside of any lock, so two
+ * threads asking for the same missing node might both create it; the first
+ * one to finish gets stored and is returned to both.
+ *
+ * Pinned nodes are never evicted. Pinning a node that is not cached yet
+ * protects it as soon as it gets added. Each pin() has to be matched by an
+ * unpin(). If the budget is exceeded by pinned volumes only, the cache
+ * temporarily grows beyond it.
+ */
+class VolumeCache {
+
+public:
+
+	struct Statistics {
+
+		std::size_t hits;
+		std::size_t misses;
+		std::size_t evictions;
+		std::size_t entries;
+		std::size_t bytes;
+	};
+
+	/**
+	 * Create a cache for at most maxBytes bytes of volume data, split into
+	 * numShards shards.
+	 */
+	VolumeCache(std::size_t maxBytes, std::size_t numShards = 16);
+
+	/**
+	 * Change the memory budget. Evicts unpinned volumes if needed.
+	 */
+	void setMaxBytes(std::size_t maxBytes);
+
+	std::size_t getMaxBytes() const { return _maxBytes; }
+
+	/**
+	 * Get the volume for the given id, or a null pointer if it is not cached.
+	 */
+	std::shared_ptr<CragVolume> get(int id);
+
+	/**
+	 * Get the volume for the given id. If it is not cached, create it with
+	 * create() (without holding a lock) and add it to the cache.
+	 */
+	template <typename F>
+	std::shared_ptr<CragVolume> get(int id, F create) {
+
+		std::shared_ptr<CragVolume> volume = get(id);
+		if (volume)
+			return volume;
+
+		return put(id, create());
+	}
+
+	/**
+	 * Add a volume to the cache. If there is already a volume for this id,
+	 * the cached one is kept and returned. Otherwise, volume is returned.
+	 */
+	std::shared_ptr<CragVolume> put(int id, std::shared_ptr<CragVolume> volume);
+
+	/**
+	 * Protect the volume with the given id from eviction.
+	 */
+	void pin(int id);
+
+	/**
+	 * Release a pin set with pin().
+	 */
+	void unpin(int id);
+
+	/**
+	 * Remove all unpinned volumes.
+	 */
+	void clear();
+
+	/**
+	 * Get the accumulated counters of all shards.
+	 */
+	Statistics getStatistics() const;
+
+	/**
+	 * The number of bytes accounted for a volume.
+	 */
+	static std::size_t size(const CragVolume& volume);
+
+private:
+
+	struct Entry {
+
+		int                         id;
+		std::shared_ptr<CragVolume> volume;
+		std::size_t                 bytes;
+	};
+
+	struct Shard {
+
+		// most recently used first
+		std::list<Entry> entries;
+		std::unordered_map<int, std::list<Entry>::iterator> index;
+		std::unordered_map<int, int> pins;
+
+		std::size_t bytes     = 0;
+		std::size_t hits      = 0;
+		std::size_t misses    = 0;
+		std::size_t evictions = 0;
+
+		mutable std::mutex mutex;
+	};
+
+	std::size_t shardIndex(int id) const { return static_cast<unsigned int>(id)%_shards.size(); }
+
+	Shard& shard(int id) { return _shards[shardIndex(id)]; }
+
+	// remove unpinned least recently used entries from all shards until the
+	// cache fits its budget, except the entry for keep (if not negative), no
+	// shard must be locked
+	void evict(int keep = -1);
+
+	// remove the least recently used unpinned entry of a shard that is not
+	// keep, the shard has to be locked, returns false if there was none
+	bool evictOne(Shard& shard, int keep);
+
+	std::vector<Shard> _shards;
+
+	std::atomic<std::size_t> _maxBytes;
+
+	// the bytes of all cached volumes
+	std::atomic<std::size_t> _bytes;
+
+	// only one thread evicts at a time
+	std::mutex _evictionMutex;
+};
+
+#endif // CANDIDATE_MC_CRAG_VOLUME_CACHE_H__
+
@@ -6,10 +6,10 @@
 
 class EdgeFeatures {
 
-	typedef Features<Crag::CragEdge> FeaturesType;
-
 public:
 
+	typedef Features<Crag::CragEdge> FeaturesType;
+
 	EdgeFeatures(const Crag& crag) :
 			_crag(crag),
 			_features(Crag::EdgeTypes.size(), FeaturesType(crag)) {}
@@ -34,7 +34,7 @@ public:
 		return features(type).getFeatureNames();
 	}
 
-	const std::vector<double>& operator[](Crag::CragEdge e) const {
+	FeatureRow operator[](Crag::CragEdge e) const {
 
 		return features(_crag.type(e))[e];
 	}
@@ -44,6 +44,20 @@ public:
 		features(_crag.type(e)).set(e, v);
 	}
 
+	/**
+	 * Get the features of all edges of the given type, to access them as a
+	 * single matrix.
+	 */
+	const FeaturesType& getFeatures(Crag::EdgeType type) const {
+
+		return features(type);
+	}
+
+	FeaturesType& getFeatures(Crag::EdgeType type) {
+
+		return features(type);
+	}
+
 	inline unsigned int dims(Crag::EdgeType type) const {
 
 		return features(type).dims();
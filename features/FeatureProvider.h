@@ -1,6 +1,8 @@
 #ifndef CANDIDATE_MC_FEATURE_PROVIDER_H__
 #define CANDIDATE_MC_FEATURE_PROVIDER_H__
 
+#include <crag/CragHierarchyIndex.h>
+
 class FeatureProviderBase {
 
 public:
@@ -26,7 +28,13 @@ public:
 
 	void appendFeatures(const Crag& crag, NodeFeatures& nodeFeatures) override {
 
-		for (auto n : crag.nodes()) {
+		const CragHierarchyIndex& index = crag.getHierarchyIndex();
+
+		// visit nodes bottom-up, such that volumes of higher candidates can be 
+		// materialized from the volumes of their children
+		for (std::size_t r = 0; r < index.numNodes(); r++) {
+
+			Crag::CragNode n = index.nodeAtRank(r);
 
 			FeatureNodeAdaptor adaptor(nodeFeatures, n);
 			static_cast<Derived*>(this)->appendNodeFeatures(n, adaptor);
@@ -77,7 +85,7 @@ private:
 
 		inline void append(double value)                           { _features.append(_n, value); }
 		inline void append(unsigned int /*ignored*/, double value) { _features.append(_n, value); }
-		inline const std::vector<double>& getFeatures(){ return _features[_n]; }
+		inline std::vector<double> getFeatures(){ FeatureRow f = _features[_n]; return std::vector<double>(f.begin(), f.end()); }
 		inline const std::vector<std::string> getFeatureNames(Crag::NodeType type){ return _features.getFeatureNames(type); }
 
 	private:
@@ -97,7 +105,7 @@ private:
 
 		inline void append(double value)                           { _features.append(_e, value); }
 		inline void append(unsigned int /*ignored*/, double value) { _features.append(_e, value); }
-		inline const std::vector<double>& getFeatures(){ return _features[_e]; }
+		inline std::vector<double> getFeatures(){ FeatureRow f = _features[_e]; return std::vector<double>(f.begin(), f.end()); }
 		inline const std::vector<std::string> getFeatureNames(Crag::EdgeType type){ return _features.getFeatureNames(type); }
 
 	private:
@@ -1,16 +1,59 @@
 #ifndef CANDIDATE_MC_FEATURES_FEATURES_H__
 #define CANDIDATE_MC_FEATURES_FEATURES_H__
 
+#include <algorithm>
+#include <limits>
 #include <vector>
 #include <util/exceptions.h>
 #include "Crag.h"
 
+/**
+ * A read-only view on the feature vector of a single node or edge. Views are
+ * invalidated by changes to the features they were obtained from.
+ */
+class FeatureRow {
+
+public:
+
+	FeatureRow() : _data(0), _size(0) {}
+
+	FeatureRow(const double* data, std::size_t size) :
+		_data(data),
+		_size(size) {}
+
+	const double* begin() const { return _data; }
+	const double* end()   const { return _data + _size; }
+
+	std::size_t size() const { return _size; }
+	bool       empty() const { return _size == 0; }
+
+	const double& operator[](std::size_t i) const { return _data[i]; }
+
+	bool operator==(const FeatureRow& other) const {
+
+		return _size == other._size && std::equal(begin(), end(), other.begin());
+	}
+
+	bool operator!=(const FeatureRow& other) const { return !(*this == other); }
+
+private:
+
+	const double* _data;
+	std::size_t   _size;
+};
+
+/**
+ * Feature vectors for a set of nodes or edges of a CRAG. The vectors are
+ * stored as rows of a single row-major matrix, with a row index by CRAG id.
+ * Rows start stride() values apart, which is the same layout the features
+ * have in a project file if stride() == dims().
+ */
 template <typename KeyType>
 class Features {
 
 public:
 
-	Features(const Crag& crag) : _crag(crag), _dimsDirty(true) {}
+	Features(const Crag& crag) : _crag(crag), _stride(0), _numDistinctSizes(0) {}
 
 	/**
 	 * Add a single feature to the feature vector for a node. Converts nan into 
@@ -21,17 +64,23 @@ public:
 		if (feature != feature)
 			feature = 0;
 
+		int row = getOrAddRow(n);
+
 		if (feature == std::numeric_limits<double>::infinity() || feature == -std::numeric_limits<double>::infinity()) {
 
 			std::string name = "(not known yet)";
-			if (_featureNames.size() > _features[n].size())
-				name = _featureNames[_features[n].size()];
-			std::cout << "Warning: feature " << _features[n].size() << " " << name << " of element " << _crag.id(n) << " is " << feature << std::endl;
+			if (_featureNames.size() > _sizes[row])
+				name = _featureNames[_sizes[row]];
+			std::cout << "Warning: feature " << _sizes[row] << " " << name << " of element " << _crag.id(n) << " is " << feature << std::endl;
 		}
 
-		_features[n].push_back(feature);
+		// grow geometrically, features are usually appended one at a time for
+		// all rows
+		if (_sizes[row] == _stride)
+			relayout(std::max(static_cast<std::size_t>(1), 2*_stride));
 
-		_dimsDirty = true;
+		_values[row*_stride + _sizes[row]] = feature;
+		setSize(row, _sizes[row] + 1);
 	}
 
 	/**
@@ -58,46 +107,88 @@ public:
 	 */
 	inline void set(KeyType n, const std::vector<double>& v) {
 
-		_features[n] = v;
-		_dimsDirty = true;
+		int row = getOrAddRow(n);
+
+		if (v.size() > _stride)
+			relayout(v.size());
+
+		std::copy(v.begin(), v.end(), _values.begin() + row*_stride);
+		setSize(row, v.size());
 	}
 
 	/**
-	 * The size of the feature vectors.
+	 * Replace all feature vectors with one vector of dims features for each of
+	 * the given keys. Returns a pointer to the row-major matrix of the new
+	 * features (with keys.size() rows), which the caller has to fill.
 	 */
-	inline unsigned int dims() const {
+	double* reset(const std::vector<KeyType>& keys, unsigned int dims) {
 
-		if (!_dimsDirty)
-			return _dims;
+		_keys.clear();
+		_rows.clear();
+		_keys.reserve(keys.size());
 
-		_dims = 0;
+		for (KeyType k : keys) {
 
-		bool first = true;
-		int firstId = -1;
-		for (auto& p : _features) {
+			int id = _crag.id(k);
+			if (id >= static_cast<int>(_rows.size()))
+				_rows.resize(id + 1, -1);
 
-			KeyType n = p.first;
-			const std::vector<double>& f = p.second;
+			_rows[id] = _keys.size();
+			_keys.push_back(k);
+		}
 
-			if (first) {
+		_stride = dims;
+		_sizes.assign(keys.size(), dims);
+		_values.assign(keys.size()*dims, 0);
 
-				_dims = f.size();
-				first = false;
-				firstId = _crag.id(n);
+		_numRowsWithSize.assign(dims + 1, 0);
+		_numRowsWithSize[dims] = keys.size();
+		_numDistinctSizes = (keys.empty() ? 0 : 1);
 
-			} else {
+		_min.clear();
+		_max.clear();
 
-				if (f.size() != _dims)
-					UTIL_THROW_EXCEPTION(
-							UsageError,
-							"Features contains vectors of different sizes: "
-							"expected " << _dims << " (as seen for id " << firstId << ")" <<
-							", found " << f.size() << " for id " << _crag.id(n));
-			}
-		}
+		return _values.data();
+	}
+
+	/**
+	 * The keys that have a feature vector, in the order of the rows of data().
+	 */
+	const std::vector<KeyType>& keys() const { return _keys; }
+
+	/**
+	 * The row-major matrix of all feature vectors, with keys().size() rows of
+	 * dims() features each. Rows start stride() values apart, since they are
+	 * padded while features are appended.
+	 */
+	const double* data() const { return _values.data(); }
+
+	/**
+	 * The distance between the starts of two consecutive rows of data().
+	 */
+	std::size_t stride() const { return _stride; }
+
+	/**
+	 * The size of the feature vectors.
+	 */
+	inline unsigned int dims() const {
+
+		if (_numDistinctSizes == 0)
+			return 0;
+
+		if (_numDistinctSizes == 1)
+			return _sizes[0];
 
-		_dimsDirty = false;
-		return _dims;
+		// find the first row that differs from the first one, for the report
+		std::size_t row = 1;
+		while (_sizes[row] == _sizes[0])
+			row++;
+
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"Features contains vectors of different sizes: "
+				"expected " << _sizes[0] << " (as seen for id " << _crag.id(_keys[0]) << ")" <<
+				", found " << _sizes[row] << " for id " << _crag.id(_keys[row]));
 	}
 
 	/**
@@ -147,28 +238,103 @@ public:
 		return _max;
 	}
 
-	const std::vector<double>& operator[](KeyType k) const { return _features[k]; }
+	/**
+	 * Get the feature vector of a key. The vector is empty if no features
+	 * were added for the key.
+	 */
+	FeatureRow operator[](KeyType k) const {
 
-protected:
+		int row = getRow(k);
 
-	// don't allow non-const access to feature vectors
-	std::vector<double>& operator[](KeyType k) { return _features[k]; }
+		if (row < 0)
+			return FeatureRow();
+
+		return FeatureRow(_values.data() + row*_stride, _sizes[row]);
+	}
 
 private:
 
+	inline int getRow(KeyType k) const {
+
+		int id = _crag.id(k);
+
+		if (id >= static_cast<int>(_rows.size()))
+			return -1;
+
+		return _rows[id];
+	}
+
+	inline int getOrAddRow(KeyType k) {
+
+		int row = getRow(k);
+
+		if (row >= 0)
+			return row;
+
+		int id = _crag.id(k);
+		if (id >= static_cast<int>(_rows.size()))
+			_rows.resize(id + 1, -1);
+
+		row = _keys.size();
+		_rows[id] = row;
+		_keys.push_back(k);
+		_sizes.push_back(0);
+		_values.resize(_values.size() + _stride, 0);
+
+		if (_numRowsWithSize.empty())
+			_numRowsWithSize.resize(1, 0);
+		if (_numRowsWithSize[0]++ == 0)
+			_numDistinctSizes++;
+
+		return row;
+	}
+
+	// change the number of features in a row, keeping track of the number of
+	// different sizes, such that dims() does not have to visit all rows
+	void setSize(int row, unsigned int size) {
+
+		if (size >= _numRowsWithSize.size())
+			_numRowsWithSize.resize(size + 1, 0);
+
+		if (--_numRowsWithSize[_sizes[row]] == 0)
+			_numDistinctSizes--;
+		if (_numRowsWithSize[size]++ == 0)
+			_numDistinctSizes++;
+
+		_sizes[row] = size;
+	}
+
+	// change the distance between rows of the feature matrix
+	void relayout(std::size_t stride) {
+
+		if (stride == _stride)
+			return;
+
+		std::vector<double> values(_sizes.size()*stride, 0);
+
+		for (std::size_t row = 0; row < _sizes.size(); row++)
+			std::copy(
+					_values.begin() + row*_stride,
+					_values.begin() + row*_stride + _sizes[row],
+					values.begin() + row*stride);
+
+		_values.swap(values);
+		_stride = stride;
+	}
+
 	void findMinMax() {
 
 		_min.clear();
 		_max.clear();
 
-		for (auto& p : _features) {
+		for (std::size_t row = 0; row < _sizes.size(); row++) {
 
-			const std::vector<double>& f = p.second;
+			const double* f = _values.data() + row*_stride;
 
-			if (_min.size() == 0) {
+			if (row == 0) {
 
-				_min = f;
-				_max = f;
+				_min.assign(f, f + _sizes[row]);
+				_max.assign(f, f + _sizes[row]);
 
 			} else {
 
@@ -195,14 +361,9 @@ private:
 					UsageError,
 					"provided min and max have different size " << min.size() << " than features " << dims());
 
-		for (auto& p : _features) {
-
-			std::vector<double>& f = p.second;
+		for (std::size_t row = 0; row < _sizes.size(); row++) {
 
-			if (f.size() != min.size())
-				UTIL_THROW_EXCEPTION(
-						UsageError,
-						"encountered a feature with differnt size " << f.size() << " than given min " << min.size());
+			double* f = _values.data() + row*_stride;
 
 			for (unsigned int i = 0; i < min.size(); i++) {
 
@@ -216,13 +377,26 @@ private:
 
 	const Crag& _crag;
 
-	mutable std::map<KeyType, std::vector<double>> _features;
-	mutable std::vector<std::string>               _featureNames;
+	// the key of each row
+	std::vector<KeyType> _keys;
+
+	// the row of each key by CRAG id, -1 for keys without features
+	std::vector<int> _rows;
+
+	// the number of features in each row
+	std::vector<unsigned int> _sizes;
+
+	// row-major feature matrix, rows start _stride values apart
+	std::vector<double> _values;
+	std::size_t         _stride;
+
+	mutable std::vector<std::string> _featureNames;
 
 	std::vector<double> _min, _max;
 
-	mutable unsigned int _dims;
-	mutable bool         _dimsDirty;
+	// the number of rows for each size, and the number of sizes that occur
+	std::vector<std::size_t> _numRowsWithSize;
+	std::size_t              _numDistinctSizes;
 };
 
 #endif // CANDIDATE_MC_FEATURES_FEATURES_H__
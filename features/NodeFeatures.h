@@ -6,10 +6,10 @@
 
 class NodeFeatures {
 
-	typedef Features<Crag::CragNode> FeaturesType;
-
 public:
 
+	typedef Features<Crag::CragNode> FeaturesType;
+
 	NodeFeatures(const Crag& crag) :
 			_crag(crag),
 			_features(Crag::NodeTypes.size(), FeaturesType(crag)) {}
@@ -34,7 +34,7 @@ public:
 		return features(type).getFeatureNames();
 	}
 
-	const std::vector<double>& operator[](Crag::CragNode n) const {
+	FeatureRow operator[](Crag::CragNode n) const {
 
 		return features(_crag.type(n))[n];
 	}
@@ -44,6 +44,20 @@ public:
 		features(_crag.type(n)).set(n, v);
 	}
 
+	/**
+	 * Get the features of all nodes of the given type, to access them as a
+	 * single matrix.
+	 */
+	const FeaturesType& getFeatures(Crag::NodeType type) const {
+
+		return features(type);
+	}
+
+	FeaturesType& getFeatures(Crag::NodeType type) {
+
+		return features(type);
+	}
+
 	inline unsigned int dims(Crag::NodeType type) const {
 
 		return features(type).dims();
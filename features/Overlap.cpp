@@ -1,4 +1,7 @@
+#include <algorithm>
+#include <set>
 #include "Overlap.h"
+#include <crag/CragHierarchyIndex.h>
 #include <util/assert.h>
 
 double
@@ -33,6 +36,36 @@ Overlap::operator()(const CragVolume& a, const CragVolume& b) {
 	return overlap;
 }
 
+double
+Overlap::operator()(const CragVolumes& volumes, Crag::CragNode a, Crag::CragNode b) {
+
+	if (!volumes.hasLabelVolume())
+		return (*this)(*volumes[a], *volumes[b]);
+
+	const Crag& crag = volumes.getCrag();
+
+	// sorted labels of a
+	std::vector<int> labels = volumes.getMask(a).getLabels();
+
+	util::point<float, 3> resolution = volumes.getLabelVolume()->getResolution();
+	double voxelVolume = resolution.x()*resolution.y()*resolution.z();
+
+	// labels partition the volume, the overlap consists of the shared labels
+	std::set<int> shared;
+	double overlap = 0;
+	crag.getHierarchyIndex().forEachLeafNode(b, [&](Crag::CragNode l) {
+
+		int label = volumes.getLeafLabel(l);
+
+		if (!std::binary_search(labels.begin(), labels.end(), label) || !shared.insert(label).second)
+			return;
+
+		overlap += volumes.numVoxels(l)*voxelVolume;
+	});
+
+	return overlap;
+}
+
 bool
 Overlap::exceeds(const CragVolume& a, CragVolume& b, double value) {
 
@@ -14,6 +14,13 @@ public:
 	 */
 	double operator()(const CragVolume& a, const CragVolume& b);
 
+	/**
+	 * Get the volume of the overlap between the candidates a and b. For 
+	 * volumes backed by a label volume, the overlap is the size of the leaf 
+	 * labels a and b share, and the volumes are not materialized.
+	 */
+	double operator()(const CragVolumes& volumes, Crag::CragNode a, Crag::CragNode b);
+
 	/**
 	 * Check if the overlap between a and b exceeds the given value. This method 
 	 * is usually faster then computing the exact overlap.
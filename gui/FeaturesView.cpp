@@ -7,8 +7,10 @@ SoltionView::onSignal(SetEdge& signal) {
 	if (_crag.type(signal.getEdge()) == Crag::AssignmentEdge)
 		return;
 
-	if (_edgeFeatures[signal.getEdge()].size() > 0)
-		std::cout << "features of current edge: " << _edgeFeatures[signal.getEdge()] << std::endl;
+	FeatureRow features = _edgeFeatures[signal.getEdge()];
+
+	if (features.size() > 0)
+		std::cout << "features of current edge: " << std::vector<double>(features.begin(), features.end()) << std::endl;
 }
 
 void
@@ -17,10 +19,12 @@ SoltionView::onSignal(SetCandidate& signal) {
 	if (_crag.type(signal.getCandidate()) == Crag::NoAssignmentNode)
 		return;
 
-	if (_nodeFeatures[signal.getCandidate()].size() > 0)
+	FeatureRow features = _nodeFeatures[signal.getCandidate()];
+
+	if (features.size() > 0)
 		std::cout
 				<< "features node " << _crag.id(signal.getCandidate())
 				<< ":" << std::endl << "\t"
-				<< _nodeFeatures[signal.getCandidate()]
+				<< std::vector<double>(features.begin(), features.end())
 				<< std::endl;
 }
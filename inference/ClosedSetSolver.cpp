@@ -354,22 +354,18 @@ ClosedSetSolver::findViolatedConstraints(CragSolution& solution) {
 
 			Crag::Node pre(dijkstra.predNode(cur));
 
-			// here we have to iterate over all adjacent edges in order to 
 			// find (cur, pre) in CRAG, since there is no 1:1 mapping 
 			// between edges in cutGraph and _crag
-			Crag::CragIncEdgeIterator pathEdge = _crag.adjEdges(cur).begin();
-			for (; pathEdge != _crag.adjEdges(cur).end(); ++pathEdge)
-				if ((*pathEdge).opposite(cur) == pre)
-					break;
+			Crag::CragEdge pathEdge = _crag.findEdge(cur, pre);
 
-			if (pathEdge == _crag.adjEdges(cur).end())
+			if (pathEdge == lemon::INVALID)
 				UTIL_THROW_EXCEPTION(
 						Exception,
 						"could not find path edge in CRAG");
 
-			if (!solution.selected(*pathEdge))
+			if (!solution.selected(pathEdge))
 				LOG_ERROR(closedsetlog)
-						<< "edge " << edgeIdToVar(_crag.id(*pathEdge))
+						<< "edge " << edgeIdToVar(_crag.id(pathEdge))
 						<< " is not selected, but found by dijkstra"
 						<< std::endl;
 				//UTIL_THROW_EXCEPTION(
@@ -377,10 +373,10 @@ ClosedSetSolver::findViolatedConstraints(CragSolution& solution) {
 						//"edge " << edgeIdToVar(_crag.id(pathEdge)) << " is not selected, but found by dijkstra");
 
 			cycleConstraint.setCoefficient(
-					edgeIdToVar(_crag.id(*pathEdge)),
+					edgeIdToVar(_crag.id(pathEdge)),
 					1.0);
 			LOG_ALL(closedsetlog)
-					<< "(edge " << edgeIdToVar(_crag.id(*pathEdge)) << ") ";
+					<< "(edge " << edgeIdToVar(_crag.id(pathEdge)) << ") ";
 
 			lenPath++;
 			cur = pre;
@@ -26,6 +26,7 @@ util::ProgramOption optionDismissPositiveCosts(
 
 MultiCutSolver::MultiCutSolver(const Crag& crag, const Parameters& parameters) :
 	_crag(crag),
+	_csr(crag),
 	_numNodes(0),
 	_numEdges(0),
 	_solver(0),
@@ -33,8 +34,8 @@ MultiCutSolver::MultiCutSolver(const Crag& crag, const Parameters& parameters) :
 	_numPositiveCostPinConstraints(0),
 	_labels(crag) {
 
-	_numNodes = _crag.nodes().size();
-	_numEdges = _crag.edges().size();
+	_numNodes = _csr.numNodes();
+	_numEdges = _csr.numEdges();
 
 	SolverFactory factory;
 	_solver = factory.createLinearSolverBackend();
@@ -218,26 +219,25 @@ MultiCutSolver::setInitialConstraints() {
 	int numRejectionConstraints = 0;
 
 	// for each node
-	for (Crag::CragNode n : _crag.nodes()) {
+	for (unsigned int n = 0; n < _csr.numNodes(); n++) {
 
-		LinearConstraint rejectionConstraint;
+		CragCsr::Range<int> adjEdges = _csr.adjEdges(n);
 
-		int numIncEdges = 0;
+		if (adjEdges.empty())
+			continue;
 
-		// for each adjacent edge
-		for (Crag::CragEdge e : _crag.adjEdges(n)) {
+		LinearConstraint rejectionConstraint;
 
+		// for each adjacent edge
+		for (int e : adjEdges)
 			rejectionConstraint.setCoefficient(
-					edgeIdToVar(_crag.id(e)),
+					edgeIdToVar(_csr.edgeId(e)),
 					1.0);
-			numIncEdges++;
-		}
 
-		if (numIncEdges == 0)
-			continue;
+		int numIncEdges = adjEdges.size();
 
 		rejectionConstraint.setCoefficient(
-				nodeIdToVar(_crag.id(n)),
+				nodeIdToVar(_csr.nodeId(n)),
 				-numIncEdges);
 
 		rejectionConstraint.setRelation(LessEqual);
@@ -505,22 +505,18 @@ MultiCutSolver::findViolatedConstraints(CragSolution& solution) {
 
 			Crag::Node pre(dijkstra.predNode(cur));
 
-			// here we have to iterate over all adjacent edges in order to 
 			// find (cur, pre) in CRAG, since there is no 1:1 mapping 
 			// between edges in cutGraph and _crag
-			Crag::CragIncEdgeIterator pathEdge = _crag.adjEdges(cur).begin();
-			for (; pathEdge != _crag.adjEdges(cur).end(); ++pathEdge)
-				if ((*pathEdge).opposite(cur) == pre)
-					break;
+			Crag::CragEdge pathEdge = _crag.findEdge(cur, pre);
 
-			if (pathEdge == _crag.adjEdges(cur).end())
+			if (pathEdge == lemon::INVALID)
 				UTIL_THROW_EXCEPTION(
 						Exception,
 						"could not find path edge in CRAG");
 
-			if (!solution.selected(*pathEdge))
+			if (!solution.selected(pathEdge))
 				LOG_ERROR(multicutlog)
-						<< "edge " << edgeIdToVar(_crag.id(*pathEdge))
+						<< "edge " << edgeIdToVar(_crag.id(pathEdge))
 						<< " is not selected, but found by dijkstra"
 						<< std::endl;
 				//UTIL_THROW_EXCEPTION(
@@ -528,10 +524,10 @@ MultiCutSolver::findViolatedConstraints(CragSolution& solution) {
 						//"edge " << edgeIdToVar(_crag.id(pathEdge)) << " is not selected, but found by dijkstra");
 
 			cycleConstraint.setCoefficient(
-					edgeIdToVar(_crag.id(*pathEdge)),
+					edgeIdToVar(_crag.id(pathEdge)),
 					1.0);
 			LOG_ALL(multicutlog)
-					<< "(edge " << edgeIdToVar(_crag.id(*pathEdge)) << ") ";
+					<< "(edge " << edgeIdToVar(_crag.id(pathEdge)) << ") ";
 
 			lenPath++;
 			cur = pre;
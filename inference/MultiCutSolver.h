@@ -2,6 +2,7 @@
 #define CANDIDATE_MC_SOLVER_MULTI_CUT_H__
 
 #include <crag/Crag.h>
+#include <crag/CragCsr.h>
 #include <crag/CragVolumes.h>
 #include <solver/LinearSolverBackend.h>
 #include <vigra/tinyvector.hxx>
@@ -59,6 +60,9 @@ private:
 
 	const Crag& _crag;
 
+	// read-only snapshot of the CRAG for fast iteration
+	const CragCsr _csr;
+
 	unsigned int _numNodes, _numEdges;
 
 	std::map<int, unsigned int> _edgeIdToVarMap;
@@ -0,0 +1,902 @@
+#include <algorithm>
+#include <utility>
+#include <boost/lexical_cast.hpp>
+#include <lemon/list_graph.h>
+#include <util/Logger.h>
+#include <util/assert.h>
+#include <crag/CragBuilder.h>
+#include "BinaryCragStore.h"
+
+logger::LogChannel binarystorelog("binarystorelog", "[BinaryCragStore] ");
+
+void
+BinaryCragStore::saveCrag(const Crag& crag) {
+
+	std::size_t numNodes = numContiguousNodes(crag);
+
+	std::vector<int> nodeTypes(numNodes);
+	for (Crag::CragNode n : crag.nodes())
+		nodeTypes[crag.id(n)] = crag.type(n);
+
+	// edges, edge types, and affiliated edges in the order of crag.edges(),
+	// which is the order of all stored edge values
+	std::vector<int>     edges;
+	std::vector<int>     edgeTypes;
+	std::vector<int64_t> aeOffsets(1, 0);
+	std::vector<int64_t> aeIds;
+
+	std::vector<Crag::CragEdge> orderedEdges;
+	for (Crag::CragEdge e : crag.edges()) {
+
+		edges.push_back(crag.id(e.u()));
+		edges.push_back(crag.id(e.v()));
+		edgeTypes.push_back(crag.type(e));
+
+		if (crag.isLeafEdge(e)) {
+
+			Crag::AffiliatedEdges affiliatedEdges = crag.getAffiliatedEdges(e);
+			aeIds.insert(aeIds.end(), affiliatedEdges.beginIds(), affiliatedEdges.endIds());
+		}
+		aeOffsets.push_back(aeIds.size());
+
+		orderedEdges.push_back(e);
+	}
+	setStoredEdges(crag, std::move(orderedEdges));
+
+	std::vector<int> arcs;
+	for (Crag::CragArc a : crag.arcs()) {
+
+		arcs.push_back(crag.id(a.source()));
+		arcs.push_back(crag.id(a.target()));
+	}
+
+	std::vector<int> shape(3);
+	shape[0] = crag.getGridGraph().shape()[0];
+	shape[1] = crag.getGridGraph().shape()[1];
+	shape[2] = crag.getGridGraph().shape()[2];
+
+	LOG_USER(binarystorelog) << "writing CRAG... " << std::flush;
+
+	_file.write("crag/node_types", nodeTypes);
+	_file.write("crag/edges", edges, 2);
+	_file.write("crag/edge_types", edgeTypes);
+	_file.write("crag/arcs", arcs, 2);
+	_file.write("crag/grid_graph_shape", shape);
+	_file.write("crag/affiliated_edges/offsets", aeOffsets);
+	_file.write("crag/affiliated_edges/ids", aeIds);
+
+	LOG_USER(binarystorelog) << "done." << std::endl;
+}
+
+void
+BinaryCragStore::retrieveCrag(Crag& crag) {
+
+	auto nodeTypes = _file.read<int>("crag/node_types");
+	auto edges     = _file.read<int>("crag/edges");
+	auto edgeTypes = _file.read<int>("crag/edge_types");
+	auto arcs      = _file.read<int>("crag/arcs");
+
+	UTIL_ASSERT_REL(edges.size(), ==, 2*edgeTypes.size());
+
+	CragBuilder builder(crag);
+	builder.reserveNodes(nodeTypes.size());
+	builder.reserveEdges(edgeTypes.size());
+	builder.reserveArcs(arcs.size()/2);
+
+	for (int type : nodeTypes)
+		builder.addNode(static_cast<Crag::NodeType>(type));
+	for (std::size_t i = 0; i < edgeTypes.size(); i++)
+		builder.addAdjacencyEdge(edges[2*i], edges[2*i + 1], static_cast<Crag::EdgeType>(edgeTypes[i]));
+	builder.addSubsetArcs(arcs.begin(), arcs.end());
+
+	std::vector<Crag::CragNode> nodes = builder.build();
+
+	for (std::size_t i = 0; i < nodes.size(); i++)
+		UTIL_ASSERT_REL(crag.id(nodes[i]), ==, static_cast<int>(i));
+
+	std::vector<Crag::CragEdge> orderedEdges;
+	orderedEdges.reserve(edgeTypes.size());
+	for (std::size_t i = 0; i < edgeTypes.size(); i++)
+		orderedEdges.push_back(builder.getEdge(i));
+	setStoredEdges(crag, std::move(orderedEdges));
+
+	if (!_file.exists("crag/grid_graph_shape"))
+		return;
+
+	auto s = _file.read<int>("crag/grid_graph_shape");
+	crag.setGridGraph(vigra::GridGraph<3>(vigra::Shape3(s[0], s[1], s[2]), vigra::DirectNeighborhood));
+
+	auto aeOffsets = _file.read<int64_t>("crag/affiliated_edges/offsets");
+	auto aeIds     = _file.read<int64_t>("crag/affiliated_edges/ids");
+
+	UTIL_ASSERT_REL(aeOffsets.size(), ==, _edges.size() + 1);
+
+	crag.reserveAffiliatedEdges(aeIds.size());
+	for (std::size_t i = 0; i < _edges.size(); i++)
+		if (aeOffsets[i + 1] > aeOffsets[i])
+			crag.setAffiliatedEdgeIds(
+					_edges[i],
+					aeIds.data() + aeOffsets[i],
+					aeIds.data() + aeOffsets[i + 1]);
+}
+
+void
+BinaryCragStore::saveVolumes(const CragVolumes& volumes) {
+
+	_volumeRows.clear();
+
+	// only one representation of the volumes is kept, retrieveVolumes() 
+	// would otherwise prefer the label volume even if it is outdated
+	if (volumes.hasLabelVolume()) {
+
+		for (std::string name : { "serialized", "meta", "offsets", "resolutions", "index" })
+			_file.remove("volumes/" + name);
+
+		saveLabelVolumes(volumes);
+		return;
+	}
+
+	for (std::string name : { "labels", "labels_shape", "labels_geometry", "leaf_labels" })
+		_file.remove("volumes/" + name);
+
+	const Crag& crag = volumes.getCrag();
+
+	LOG_USER(binarystorelog) << "writing node volumes... " << std::flush;
+
+	// the volumes are streamed into the file one by one, they are never held
+	// in memory all at once
+	BinarySectionFile::SectionWriter<unsigned char> serialized(_file, "volumes/serialized");
+
+	std::vector<int>     meta;
+	std::vector<float>   offsets;
+	std::vector<float>   resolutions;
+	std::vector<int64_t> index;
+
+	for (Crag::CragNode n : crag.nodes()) {
+
+		// only store leaf node volumes
+		if (!crag.isLeafNode(n))
+			continue;
+
+		const CragVolume& volume = *volumes[n];
+		meta.push_back(crag.id(n));
+		meta.push_back(volume.width());
+		meta.push_back(volume.height());
+		meta.push_back(volume.depth());
+		offsets.push_back(volume.getOffset().x());
+		offsets.push_back(volume.getOffset().y());
+		offsets.push_back(volume.getOffset().z());
+		resolutions.push_back(volume.getResolution().x());
+		resolutions.push_back(volume.getResolution().y());
+		resolutions.push_back(volume.getResolution().z());
+		index.push_back(serialized.size());
+		serialized.append(volume.data().data(), volume.data().size());
+	}
+
+	serialized.finish();
+
+	_file.write("volumes/meta", meta, 4);
+	_file.write("volumes/offsets", offsets, 3);
+	_file.write("volumes/resolutions", resolutions, 3);
+	_file.write("volumes/index", index);
+
+	LOG_USER(binarystorelog) << "done." << std::endl;
+}
+
+void
+BinaryCragStore::retrieveVolumes(CragVolumes& volumes) {
+
+	if (_file.exists("volumes/labels")) {
+
+		retrieveLabelVolumes(volumes);
+		return;
+	}
+
+	if (!_file.exists("volumes/meta"))
+		return;
+
+	readVolumeIndex();
+
+	const Crag& crag = volumes.getCrag();
+
+	auto meta        = _file.read<int>("volumes/meta");
+	auto offsets     = _file.read<float>("volumes/offsets");
+	auto resolutions = _file.read<float>("volumes/resolutions");
+
+	for (std::size_t i = 0; i < meta.rows(); i++) {
+
+		const int*   m = meta.row(i);
+		const float* o = offsets.row(i);
+		const float* r = resolutions.row(i);
+
+		util::point<float, 3> offset(o[0], o[1], o[2]);
+		util::point<float, 3> size(m[1]*r[0], m[2]*r[1], m[3]*r[2]);
+
+		volumes.setLeafBoundingBox(
+				crag.nodeFromId(m[0]),
+				util::box<float, 3>(offset, offset + size));
+	}
+
+	volumes.setVolumeLoader([this, &crag](Crag::CragNode n) { return retrieveVolume(crag, n); });
+}
+
+std::shared_ptr<CragVolume>
+BinaryCragStore::retrieveVolume(const Crag& crag, Crag::CragNode n) {
+
+	readVolumeIndex();
+
+	int id = crag.id(n);
+	if (id < 0 || id >= static_cast<int>(_volumeRows.size()) || _volumeRows[id] < 0)
+		return std::shared_ptr<CragVolume>();
+
+	std::size_t row = _volumeRows[id];
+
+	auto serialized  = _file.read<unsigned char>("volumes/serialized");
+	auto meta        = _file.read<int>("volumes/meta");
+	auto offsets     = _file.read<float>("volumes/offsets");
+	auto resolutions = _file.read<float>("volumes/resolutions");
+	auto index       = _file.read<int64_t>("volumes/index");
+
+	const int*   m = meta.row(row);
+	const float* o = offsets.row(row);
+	const float* r = resolutions.row(row);
+
+	auto volume = std::make_shared<CragVolume>(m[1], m[2], m[3]);
+	volume->setResolution(r[0], r[1], r[2]);
+	volume->setOffset(o[0], o[1], o[2]);
+
+	std::size_t size = static_cast<std::size_t>(m[1])*m[2]*m[3];
+
+	UTIL_ASSERT_REL(index[row] + size, <=, serialized.size());
+
+	// only the pages of this volume are read from the file
+	std::copy(
+			serialized.data() + index[row],
+			serialized.data() + index[row] + size,
+			volume->data().data());
+
+	return volume;
+}
+
+void
+BinaryCragStore::readVolumeIndex() {
+
+	if (!_volumeRows.empty() || !_file.exists("volumes/meta"))
+		return;
+
+	auto meta = _file.read<int>("volumes/meta");
+
+	int maxId = -1;
+	for (std::size_t i = 0; i < meta.rows(); i++)
+		maxId = std::max(maxId, meta.row(i)[0]);
+
+	_volumeRows.resize(maxId + 1, -1);
+	for (std::size_t i = 0; i < meta.rows(); i++)
+		_volumeRows[meta.row(i)[0]] = i;
+}
+
+void
+BinaryCragStore::saveLabelVolumes(const CragVolumes& volumes) {
+
+	const ExplicitVolume<int>& labels = *volumes.getLabelVolume();
+
+	std::vector<int> shape(3);
+	shape[0] = labels.width();
+	shape[1] = labels.height();
+	shape[2] = labels.depth();
+
+	std::vector<float> geometry(6);
+	geometry[0] = labels.getOffset().x();
+	geometry[1] = labels.getOffset().y();
+	geometry[2] = labels.getOffset().z();
+	geometry[3] = labels.getResolution().x();
+	geometry[4] = labels.getResolution().y();
+	geometry[5] = labels.getResolution().z();
+
+	// id, label, and bounding box of each leaf node
+	std::vector<int> leafLabels;
+	for (Crag::CragNode n : volumes.getCrag().nodes()) {
+
+		if (!volumes.getCrag().isLeafNode(n))
+			continue;
+
+		const util::box<unsigned int, 3>& bb = volumes.getLeafLabelBoundingBox(n);
+
+		leafLabels.push_back(volumes.getCrag().id(n));
+		leafLabels.push_back(volumes.getLeafLabel(n));
+		leafLabels.push_back(bb.min().x());
+		leafLabels.push_back(bb.min().y());
+		leafLabels.push_back(bb.min().z());
+		leafLabels.push_back(bb.max().x());
+		leafLabels.push_back(bb.max().y());
+		leafLabels.push_back(bb.max().z());
+	}
+
+	LOG_USER(binarystorelog) << "writing label volume... " << std::flush;
+
+	_file.write("volumes/labels", labels.data().data(), labels.data().size(), shape[0]);
+	_file.write("volumes/labels_shape", shape);
+	_file.write("volumes/labels_geometry", geometry);
+	_file.write("volumes/leaf_labels", leafLabels, 8);
+
+	LOG_USER(binarystorelog) << "done." << std::endl;
+}
+
+void
+BinaryCragStore::retrieveLabelVolumes(CragVolumes& volumes) {
+
+	auto data       = _file.read<int>("volumes/labels");
+	auto shape      = _file.read<int>("volumes/labels_shape");
+	auto geometry   = _file.read<float>("volumes/labels_geometry");
+	auto leafLabels = _file.read<int>("volumes/leaf_labels");
+
+	auto labels = std::make_shared<ExplicitVolume<int>>(shape[0], shape[1], shape[2]);
+	labels->setOffset(geometry[0], geometry[1], geometry[2]);
+	labels->setResolution(geometry[3], geometry[4], geometry[5]);
+
+	UTIL_ASSERT_REL(data.size(), ==, labels->data().size());
+	std::copy(data.begin(), data.end(), labels->data().data());
+
+	volumes.setLabelVolume(labels);
+
+	for (std::size_t i = 0; i < leafLabels.rows(); i++) {
+
+		const int* l = leafLabels.row(i);
+
+		volumes.setLeafLabel(
+				volumes.getCrag().nodeFromId(l[0]),
+				l[1],
+				util::box<unsigned int, 3>(l[2], l[3], l[4], l[5], l[6], l[7]));
+	}
+}
+
+void
+BinaryCragStore::saveNodeFeatures(const Crag& crag, const NodeFeatures& features) {
+
+	LOG_USER(binarystorelog) << "saving node features... " << std::flush;
+
+	for (Crag::NodeType type : Crag::NodeTypes) {
+
+		// the feature matrix is written in the order of its rows, without the
+		// padding between them
+		const NodeFeatures::FeaturesType& typeFeatures = features.getFeatures(type);
+
+		std::vector<int> ids;
+		for (Crag::CragNode n : typeFeatures.keys())
+			ids.push_back(crag.id(n));
+
+		std::string name = std::string("features/nodes_") + boost::lexical_cast<std::string>(type);
+
+		_file.write(name + "/ids", ids);
+
+		unsigned int dims = typeFeatures.dims();
+
+		if (typeFeatures.stride() == dims) {
+
+			_file.write(name, typeFeatures.data(), ids.size()*dims, dims);
+
+		} else {
+
+			BinarySectionFile::SectionWriter<double> writer(_file, name, dims);
+			for (std::size_t row = 0; row < ids.size(); row++)
+				writer.append(typeFeatures.data() + row*typeFeatures.stride(), dims);
+			writer.finish();
+		}
+	}
+
+	LOG_USER(binarystorelog) << "done." << std::endl;
+}
+
+void
+BinaryCragStore::retrieveNodeFeatures(const Crag& crag, NodeFeatures& features) {
+
+	for (Crag::NodeType type : Crag::NodeTypes) {
+
+		std::string name = std::string("features/nodes_") + boost::lexical_cast<std::string>(type);
+
+		if (!_file.exists(name))
+			continue;
+
+		auto ids    = _file.read<int>(name + "/ids");
+		auto values = _file.read<double>(name);
+
+		std::vector<Crag::CragNode> nodes;
+		nodes.reserve(ids.size());
+		for (int id : ids)
+			nodes.push_back(crag.nodeFromId(id));
+
+		double* data = features.getFeatures(type).reset(nodes, values.cols());
+		std::copy(values.begin(), values.end(), data);
+	}
+}
+
+void
+BinaryCragStore::saveEdgeFeatures(const Crag& crag, const EdgeFeatures& features) {
+
+	LOG_USER(binarystorelog) << "saving edge features... " << std::flush;
+
+	const std::vector<Crag::CragEdge>& edges = storedEdges(crag);
+
+	for (Crag::EdgeType type : Crag::EdgeTypes) {
+
+		// positions of the edges in the stored edge list
+		std::vector<int>    indices;
+		std::vector<double> values;
+
+		for (std::size_t i = 0; i < edges.size(); i++) {
+
+			Crag::CragEdge e = edges[i];
+
+			if (e == lemon::INVALID || crag.type(e) != type)
+				continue;
+
+			UTIL_ASSERT_REL(features[e].size(), ==, features.dims(type));
+
+			indices.push_back(i);
+			values.insert(values.end(), features[e].begin(), features[e].end());
+		}
+
+		std::string name = std::string("features/edges_") + boost::lexical_cast<std::string>(type);
+
+		_file.write(name + "/indices", indices);
+		_file.write(name, values, features.dims(type));
+	}
+
+	LOG_USER(binarystorelog) << "done." << std::endl;
+}
+
+void
+BinaryCragStore::retrieveEdgeFeatures(const Crag& crag, EdgeFeatures& features) {
+
+	const std::vector<Crag::CragEdge>& edges = storedEdges(crag);
+
+	for (Crag::EdgeType type : Crag::EdgeTypes) {
+
+		std::string name = std::string("features/edges_") + boost::lexical_cast<std::string>(type);
+
+		if (!_file.exists(name))
+			continue;
+
+		auto indices = _file.read<int>(name + "/indices");
+		auto values  = _file.read<double>(name);
+
+		std::vector<Crag::CragEdge> typeEdges;
+		typeEdges.reserve(indices.size());
+
+		for (std::size_t i = 0; i < indices.size(); i++) {
+
+			Crag::CragEdge e = edges[indices[i]];
+
+			if (e == lemon::INVALID)
+				UTIL_THROW_EXCEPTION(
+						IOError,
+						"can not find stored edge " << indices[i] << " in CRAG");
+
+			typeEdges.push_back(e);
+		}
+
+		double* data = features.getFeatures(type).reset(typeEdges, values.cols());
+		std::copy(values.begin(), values.end(), data);
+	}
+}
+
+void
+BinaryCragStore::saveSkeletons(const Crag& crag, const Skeletons& skeletons) {
+
+	std::size_t numNodes = numContiguousNodes(crag);
+
+	// skeleton nodes and edges of all CRAG nodes, concatenated in the order of
+	// the CRAG node ids
+	std::vector<int64_t> nodeOffsets(1, 0);
+	std::vector<int64_t> edgeOffsets(1, 0);
+	std::vector<float>   positions;
+	std::vector<double>  diameters;
+	std::vector<int>     edges;
+	std::vector<float>   geometry;
+
+	for (std::size_t i = 0; i < numNodes; i++) {
+
+		const Skeleton&         skeleton = skeletons[crag.nodeFromId(i)];
+		const lemon::ListGraph& graph    = skeleton.graph();
+
+		std::vector<int> localIds(graph.maxNodeId() + 1);
+		int numSkeletonNodes = 0;
+
+		for (lemon::ListGraph::NodeIt node(graph); node != lemon::INVALID; ++node) {
+
+			localIds[graph.id(node)] = numSkeletonNodes++;
+
+			for (int d = 0; d < 3; d++)
+				positions.push_back(skeleton.positions()[node][d]);
+			diameters.push_back(skeleton.diameters()[node]);
+		}
+
+		for (lemon::ListGraph::EdgeIt edge(graph); edge != lemon::INVALID; ++edge) {
+
+			edges.push_back(localIds[graph.id(graph.u(edge))]);
+			edges.push_back(localIds[graph.id(graph.v(edge))]);
+		}
+
+		nodeOffsets.push_back(diameters.size());
+		edgeOffsets.push_back(edges.size()/2);
+
+		geometry.push_back(skeleton.getOffset().x());
+		geometry.push_back(skeleton.getOffset().y());
+		geometry.push_back(skeleton.getOffset().z());
+		geometry.push_back(skeleton.getResolutionX());
+		geometry.push_back(skeleton.getResolutionY());
+		geometry.push_back(skeleton.getResolutionZ());
+	}
+
+	_file.write("skeletons/node_offsets", nodeOffsets);
+	_file.write("skeletons/edge_offsets", edgeOffsets);
+	_file.write("skeletons/positions", positions, 3);
+	_file.write("skeletons/diameters", diameters);
+	_file.write("skeletons/edges", edges, 2);
+	_file.write("skeletons/geometry", geometry, 6);
+}
+
+void
+BinaryCragStore::retrieveSkeletons(const Crag& crag, Skeletons& skeletons) {
+
+	if (!_file.exists("skeletons/node_offsets"))
+		return;
+
+	auto nodeOffsets = _file.read<int64_t>("skeletons/node_offsets");
+	auto edgeOffsets = _file.read<int64_t>("skeletons/edge_offsets");
+	auto positions   = _file.read<float>("skeletons/positions");
+	auto diameters   = _file.read<double>("skeletons/diameters");
+	auto edges       = _file.read<int>("skeletons/edges");
+	auto geometry    = _file.read<float>("skeletons/geometry");
+
+	std::vector<lemon::ListGraph::Node> nodes;
+
+	for (std::size_t i = 0; i + 1 < nodeOffsets.size(); i++) {
+
+		// skip empty skeletons
+		if (nodeOffsets[i + 1] == nodeOffsets[i])
+			continue;
+
+		Skeleton skeleton;
+		lemon::ListGraph& graph = skeleton.graph();
+
+		nodes.clear();
+		for (int64_t j = nodeOffsets[i]; j < nodeOffsets[i + 1]; j++) {
+
+			lemon::ListGraph::Node node = graph.addNode();
+
+			Skeleton::Position position;
+			for (int d = 0; d < 3; d++)
+				position[d] = positions.row(j)[d];
+
+			skeleton.positions()[node] = position;
+			skeleton.diameters()[node] = diameters[j];
+			nodes.push_back(node);
+		}
+
+		for (int64_t j = edgeOffsets[i]; j < edgeOffsets[i + 1]; j++)
+			graph.addEdge(nodes[edges.row(j)[0]], nodes[edges.row(j)[1]]);
+
+		const float* g = geometry.row(i);
+		skeleton.setOffset(g[0], g[1], g[2]);
+		skeleton.setResolution(g[3], g[4], g[5]);
+
+		skeletons[crag.nodeFromId(i)] = std::move(skeleton);
+	}
+}
+
+void
+BinaryCragStore::saveVolumeRays(const VolumeRays& rays) {
+
+	std::size_t numNodes = numContiguousNodes(rays.getCrag());
+
+	std::vector<int64_t> offsets(1, 0);
+	std::vector<float>   data;
+
+	for (std::size_t i = 0; i < numNodes; i++) {
+
+		for (auto ray : rays[rays.getCrag().nodeFromId(i)]) {
+
+			data.push_back(ray.position().x());
+			data.push_back(ray.position().y());
+			data.push_back(ray.position().z());
+			data.push_back(ray.direction().x());
+			data.push_back(ray.direction().y());
+			data.push_back(ray.direction().z());
+		}
+
+		offsets.push_back(data.size()/6);
+	}
+
+	_file.write("volume_rays/offsets", offsets);
+	_file.write("volume_rays/rays", data, 6);
+}
+
+void
+BinaryCragStore::retrieveVolumeRays(VolumeRays& rays) {
+
+	if (!_file.exists("volume_rays/offsets"))
+		return;
+
+	auto offsets = _file.read<int64_t>("volume_rays/offsets");
+	auto data    = _file.read<float>("volume_rays/rays");
+
+	for (std::size_t i = 0; i + 1 < offsets.size(); i++) {
+
+		Crag::CragNode n = rays.getCrag().nodeFromId(i);
+
+		for (int64_t j = offsets[i]; j < offsets[i + 1]; j++) {
+
+			const float* r = data.row(j);
+
+			util::ray<float, 3> ray;
+			ray.position().x()  = r[0];
+			ray.position().y()  = r[1];
+			ray.position().z()  = r[2];
+			ray.direction().x() = r[3];
+			ray.direction().y() = r[4];
+			ray.direction().z() = r[5];
+
+			rays[n].push_back(ray);
+		}
+	}
+}
+
+void
+BinaryCragStore::saveFeatureWeights(const FeatureWeights& weights) {
+
+	writeWeights(weights, "feature_weights");
+}
+
+void
+BinaryCragStore::retrieveFeatureWeights(FeatureWeights& weights) {
+
+	readWeights(weights, "feature_weights");
+}
+
+void
+BinaryCragStore::saveFeaturesMin(const FeatureWeights& min) {
+
+	writeWeights(min, "features_min");
+}
+
+void
+BinaryCragStore::retrieveFeaturesMin(FeatureWeights& min) {
+
+	readWeights(min, "features_min");
+}
+
+void
+BinaryCragStore::saveFeaturesMax(const FeatureWeights& max) {
+
+	writeWeights(max, "features_max");
+}
+
+void
+BinaryCragStore::retrieveFeaturesMax(FeatureWeights& max) {
+
+	readWeights(max, "features_max");
+}
+
+void
+BinaryCragStore::saveCosts(const Crag& crag, const Costs& costs, std::string name) {
+
+	std::size_t numNodes = numContiguousNodes(crag);
+	const std::vector<Crag::CragEdge>& edges = storedEdges(crag);
+
+	std::vector<double> nodeCosts(numNodes);
+	for (std::size_t i = 0; i < numNodes; i++)
+		nodeCosts[i] = costs.node[crag.nodeFromId(i)];
+
+	std::vector<double> edgeCosts(edges.size(), 0);
+	for (std::size_t i = 0; i < edges.size(); i++)
+		if (edges[i] != lemon::INVALID)
+			edgeCosts[i] = costs.edge[edges[i]];
+
+	_file.write("costs/" + name + "/nodes", nodeCosts);
+	_file.write("costs/" + name + "/edges", edgeCosts);
+}
+
+void
+BinaryCragStore::retrieveCosts(const Crag& crag, Costs& costs, std::string name) {
+
+	auto nodeCosts = _file.read<double>("costs/" + name + "/nodes");
+	auto edgeCosts = _file.read<double>("costs/" + name + "/edges");
+
+	const std::vector<Crag::CragEdge>& edges = storedEdges(crag);
+
+	UTIL_ASSERT_REL(edgeCosts.size(), ==, edges.size());
+
+	for (std::size_t i = 0; i < nodeCosts.size(); i++)
+		costs.node[crag.nodeFromId(i)] = nodeCosts[i];
+
+	for (std::size_t i = 0; i < edges.size(); i++)
+		if (edges[i] != lemon::INVALID)
+			costs.edge[edges[i]] = edgeCosts[i];
+}
+
+std::vector<std::string>
+BinaryCragStore::getCostsNames() {
+
+	return getNames("costs/", "/nodes");
+}
+
+void
+BinaryCragStore::saveSolution(
+		const Crag&         crag,
+		const CragSolution& solution,
+		std::string         name) {
+
+	std::size_t numNodes = numContiguousNodes(crag);
+	const std::vector<Crag::CragEdge>& edges = storedEdges(crag);
+
+	std::vector<unsigned char> selectedNodes(numNodes);
+	for (std::size_t i = 0; i < numNodes; i++)
+		selectedNodes[i] = solution.selected(crag.nodeFromId(i));
+
+	std::vector<unsigned char> selectedEdges(edges.size(), 0);
+	for (std::size_t i = 0; i < edges.size(); i++)
+		if (edges[i] != lemon::INVALID)
+			selectedEdges[i] = solution.selected(edges[i]);
+
+	_file.write("solutions/" + name + "/nodes", selectedNodes);
+	_file.write("solutions/" + name + "/edges", selectedEdges);
+}
+
+void
+BinaryCragStore::retrieveSolution(
+		const Crag&   crag,
+		CragSolution& solution,
+		std::string   name) {
+
+	auto selectedNodes = _file.read<unsigned char>("solutions/" + name + "/nodes");
+	auto selectedEdges = _file.read<unsigned char>("solutions/" + name + "/edges");
+
+	const std::vector<Crag::CragEdge>& edges = storedEdges(crag);
+
+	UTIL_ASSERT_REL(selectedEdges.size(), ==, edges.size());
+
+	for (std::size_t i = 0; i < selectedNodes.size(); i++)
+		solution.setSelected(crag.nodeFromId(i), selectedNodes[i]);
+
+	for (Crag::CragEdge e : crag.edges())
+		solution.setSelected(e, false);
+
+	for (std::size_t i = 0; i < edges.size(); i++)
+		if (edges[i] != lemon::INVALID)
+			solution.setSelected(edges[i], selectedEdges[i]);
+}
+
+std::vector<std::string>
+BinaryCragStore::getSolutionNames() {
+
+	return getNames("solutions/", "/nodes");
+}
+
+const std::vector<Crag::CragEdge>&
+BinaryCragStore::storedEdges(const Crag& crag) {
+
+	// the CRAG might have been modified (or another one been created at the
+	// same address) since its edges were resolved
+	if (
+			_edgesCrag     == &crag            &&
+			_edgesNumNodes == crag.numNodes()  &&
+			_edgesNumEdges == crag.numEdges())
+		return _edges;
+
+	if (!_file.exists("crag/edges"))
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"the CRAG has to be stored before edge values");
+
+	auto edges = _file.read<int>("crag/edges");
+
+	std::vector<Crag::CragEdge> orderedEdges;
+	orderedEdges.reserve(edges.rows());
+	for (std::size_t i = 0; i < edges.rows(); i++)
+		orderedEdges.push_back(
+				crag.findEdge(
+						crag.nodeFromId(edges.row(i)[0]),
+						crag.nodeFromId(edges.row(i)[1])));
+	setStoredEdges(crag, std::move(orderedEdges));
+
+	return _edges;
+}
+
+void
+BinaryCragStore::setStoredEdges(const Crag& crag, std::vector<Crag::CragEdge> edges) {
+
+	_edges         = std::move(edges);
+	_edgesCrag     = &crag;
+	_edgesNumNodes = crag.numNodes();
+	_edgesNumEdges = crag.numEdges();
+}
+
+std::size_t
+BinaryCragStore::numContiguousNodes(const Crag& crag) {
+
+	std::size_t numNodes = 0;
+	int         maxId    = -1;
+	for (Crag::CragNode n : crag.nodes()) {
+
+		maxId = std::max(maxId, crag.id(n));
+		numNodes++;
+	}
+
+	if (maxId + 1 != static_cast<int>(numNodes))
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"node ids of stored CRAGs have to be contiguous, use CragBuilder::compact() first");
+
+	return numNodes;
+}
+
+void
+BinaryCragStore::writeWeights(const FeatureWeights& weights, std::string name) {
+
+	for (Crag::NodeType type : Crag::NodeTypes)
+		_file.write(
+				name + "/node_" + boost::lexical_cast<std::string>(type),
+				weights[type]);
+
+	for (Crag::EdgeType type : Crag::EdgeTypes)
+		_file.write(
+				name + "/edge_" + boost::lexical_cast<std::string>(type),
+				weights[type]);
+}
+
+void
+BinaryCragStore::readWeights(FeatureWeights& weights, std::string name) {
+
+	bool found = false;
+
+	for (Crag::NodeType type : Crag::NodeTypes) {
+
+		std::string section = name + "/node_" + boost::lexical_cast<std::string>(type);
+
+		if (!_file.exists(section))
+			continue;
+
+		auto w = _file.read<double>(section);
+		weights[type].assign(w.begin(), w.end());
+		found = true;
+	}
+
+	for (Crag::EdgeType type : Crag::EdgeTypes) {
+
+		std::string section = name + "/edge_" + boost::lexical_cast<std::string>(type);
+
+		if (!_file.exists(section))
+			continue;
+
+		auto w = _file.read<double>(section);
+		weights[type].assign(w.begin(), w.end());
+		found = true;
+	}
+
+	if (!found)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"no " << name << " stored in " << _file.getFilename());
+}
+
+std::vector<std::string>
+BinaryCragStore::getNames(std::string prefix, std::string suffix) {
+
+	std::vector<std::string> names;
+
+	for (const std::string& section : _file.getSectionNames()) {
+
+		if (section.size() <= prefix.size() + suffix.size())
+			continue;
+
+		if (
+				section.compare(0, prefix.size(), prefix) != 0 ||
+				section.compare(section.size() - suffix.size(), suffix.size(), suffix) != 0)
+			continue;
+
+		names.push_back(section.substr(prefix.size(), section.size() - prefix.size() - suffix.size()));
+	}
+
+	return names;
+}
@@ -0,0 +1,196 @@
+#ifndef CANDIDATE_MC_IO_BINARY_CRAG_STORE_H__
+#define CANDIDATE_MC_IO_BINARY_CRAG_STORE_H__
+
+#include "BinarySectionFile.h"
+#include "CragStore.h"
+
+/**
+ * A crag store that keeps the CRAG, volumes, features, weights, costs, and
+ * solutions as flat arrays in a single memory-mapped file (see
+ * BinarySectionFile). Retrieving does not parse the file, the CRAG is built
+ * from the arrays in one pass, and leaf node volumes are only read when they
+ * are accessed.
+ *
+ * Node ids of stored CRAGs have to be contiguous (see CragBuilder::compact).
+ * Edge values (features, costs, solutions) are stored in the order of the
+ * edges of the stored CRAG, the CRAG has therefore to be saved before them.
+ */
+class BinaryCragStore : public CragStore {
+
+public:
+
+	BinaryCragStore(std::string filename) :
+		_file(filename),
+		_edgesCrag(0),
+		_edgesNumNodes(0),
+		_edgesNumEdges(0) {}
+
+	/**
+	 * Store a candidate region adjacency graph (CRAG).
+	 */
+	void saveCrag(const Crag& crag) override;
+
+	/**
+	 * Save CRAG volumes. This will only store the volumes of leaf nodes, others
+	 * can be assembled from them. Volumes backed by a label volume are stored
+	 * as the label volume and the labels of the leaf nodes.
+	 */
+	void saveVolumes(const CragVolumes& volumes) override;
+
+	/**
+	 * Store features for the candidates (i.e., the nodes) of a CRAG.
+	 */
+	void saveNodeFeatures(const Crag& crag, const NodeFeatures& features) override;
+
+	/**
+	 * Store features for adjacent candidates (i.e., the edges) of a CRAG.
+	 */
+	void saveEdgeFeatures(const Crag& crag, const EdgeFeatures& features) override;
+
+	/**
+	 * Store the skeletons for candidates of a CRAG.
+	 */
+	void saveSkeletons(const Crag& crag, const Skeletons& skeletons) override;
+
+	/**
+	 * Store the volume rays for candidates of a CRAG.
+	 */
+	void saveVolumeRays(const VolumeRays& rays) override;
+
+	/**
+	 * Store a set of feature weights.
+	 */
+	void saveFeatureWeights(const FeatureWeights& weights) override;
+
+	/**
+	 * Store the min and max values of the node features.
+	 */
+	void saveFeaturesMin(const FeatureWeights& min) override;
+	void saveFeaturesMax(const FeatureWeights& max) override;
+
+	/**
+	 * Save node and edge costs (or loss) under the given name.
+	 */
+	void saveCosts(const Crag& crag, const Costs& costs, std::string name) override;
+
+	/**
+	 * Retrieve the candidate region adjacency graph (CRAG) associated to this
+	 * store.
+	 */
+	void retrieveCrag(Crag& crag) override;
+
+	/**
+	 * Retrieve the volumes of CRAG candidates. Leaf node volumes are read from
+	 * the memory map when they are first accessed, this store has therefore to
+	 * outlive the given volumes.
+	 */
+	void retrieveVolumes(CragVolumes& volumes) override;
+
+	/**
+	 * Retrieve the volume of a single leaf node. Returns a null pointer if
+	 * there is no volume stored for n.
+	 */
+	std::shared_ptr<CragVolume> retrieveVolume(const Crag& crag, Crag::CragNode n) override;
+
+	/**
+	 * Retrieve features for the candidates (i.e., the nodes) of the CRAG
+	 * associated to this store.
+	 */
+	void retrieveNodeFeatures(const Crag& crag, NodeFeatures& features) override;
+
+	/**
+	 * Retrieve features for adjacent candidates (i.e., the edges) of the CRAG
+	 * associated to this store.
+	 */
+	void retrieveEdgeFeatures(const Crag& crag, EdgeFeatures& features) override;
+
+	/**
+	 * Retrieve the min and max values of the node features.
+	 */
+	void retrieveFeaturesMin(FeatureWeights& min) override;
+	void retrieveFeaturesMax(FeatureWeights& max) override;
+
+	/**
+	 * Retrieve skeletons for the candidates of the CRAG.
+	 */
+	void retrieveSkeletons(const Crag& crag, Skeletons& skeletons) override;
+
+	/**
+	 * Retrieve volume rays for the candidates of the CRAG.
+	 */
+	void retrieveVolumeRays(VolumeRays& rays) override;
+
+	/**
+	 * Retrieve feature weights.
+	 */
+	void retrieveFeatureWeights(FeatureWeights& weights) override;
+
+	/**
+	 * Retrieve node and edge costs (or loss) of the given name.
+	 */
+	void retrieveCosts(const Crag& crag, Costs& costs, std::string name) override;
+
+	/**
+	 * Get a list of the names of all stored costs.
+	 */
+	std::vector<std::string> getCostsNames() override;
+
+	/**
+	 * Store a solution with a given name.
+	 */
+	void saveSolution(
+			const Crag&         crag,
+			const CragSolution& solution,
+			std::string         name) override;
+
+	/**
+	 * Retrieve the solution with the given name.
+	 */
+	void retrieveSolution(
+			const Crag&   crag,
+			CragSolution& solution,
+			std::string   name) override;
+
+	/**
+	 * Get a list of the names of all stored segmentations.
+	 */
+	std::vector<std::string> getSolutionNames() override;
+
+private:
+
+	// the edges of crag in the order in which they are stored
+	const std::vector<Crag::CragEdge>& storedEdges(const Crag& crag);
+
+	// remember the edges of crag in the order in which they are stored
+	void setStoredEdges(const Crag& crag, std::vector<Crag::CragEdge> edges);
+
+	// the number of nodes of crag, throws if the node ids are not contiguous
+	static std::size_t numContiguousNodes(const Crag& crag);
+
+	// find the rows of the stored volumes, if not done already
+	void readVolumeIndex();
+
+	void writeWeights(const FeatureWeights& weights, std::string name);
+	void readWeights(FeatureWeights& weights, std::string name);
+
+	// get the names of sections "<prefix><name><suffix>"
+	std::vector<std::string> getNames(std::string prefix, std::string suffix);
+
+	void saveLabelVolumes(const CragVolumes& volumes);
+	void retrieveLabelVolumes(CragVolumes& volumes);
+
+	BinarySectionFile _file;
+
+	// edges of the last CRAG that was stored, retrieved, or resolved, and the
+	// number of its nodes and edges at that time (to detect changes to it)
+	std::vector<Crag::CragEdge> _edges;
+	const Crag*                 _edgesCrag;
+	std::size_t                 _edgesNumNodes;
+	std::size_t                 _edgesNumEdges;
+
+	// the row in the volume sections for each node id, or -1
+	std::vector<int> _volumeRows;
+};
+
+#endif // CANDIDATE_MC_IO_BINARY_CRAG_STORE_H__
+
@@ -0,0 +1,455 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <util/Logger.h>
+#include "BinarySectionFile.h"
+
+logger::LogChannel binarysectionfilelog("binarysectionfilelog", "[BinarySectionFile] ");
+
+// on-disk layout of the file header, followed by the sections
+struct BinaryFileHeader {
+
+	char     magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	char     padding[48];
+};
+
+// on-disk layout of a section header, followed by the name and the data
+struct BinarySectionHeader {
+
+	uint32_t magic;
+	uint32_t version;
+	uint32_t type;
+	uint32_t elementSize;
+	uint64_t size;
+	uint64_t cols;
+	uint64_t nameLength;
+	// start of the data and end of the section, relative to the header
+	uint64_t data;
+	uint64_t end;
+	uint64_t reserved;
+};
+
+static_assert(sizeof(BinaryFileHeader)    == 64, "unexpected size of file header");
+static_assert(sizeof(BinarySectionHeader) == 64, "unexpected size of section header");
+
+static const char     FileMagic[8] = {'C', 'M', 'C', 'S', 'E', 'C', 'T', 0};
+static const uint32_t SectionMagic = 0x54434553;
+
+// the element type of sections that mark the removal of earlier sections
+static const uint32_t RemovedType = 0;
+
+BinarySectionFile::BinarySectionFile(std::string filename) :
+	_filename(filename),
+	_fd(-1),
+	_map(0),
+	_mapSize(0),
+	_end(0),
+	_unused(0),
+	_writing(false) {
+
+	_fd = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+
+	// read-only files can still be read
+	if (_fd < 0)
+		_fd = open(filename.c_str(), O_RDONLY);
+
+	if (_fd < 0)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"could not open " << filename << ": " << std::strerror(errno));
+
+	try {
+
+		struct stat s;
+		fstat(_fd, &s);
+
+		if (s.st_size == 0) {
+
+			BinaryFileHeader header;
+			std::memset(&header, 0, sizeof(header));
+			std::memcpy(header.magic, FileMagic, sizeof(FileMagic));
+			header.version = Version;
+
+			writeAt(0, &header, sizeof(header));
+		}
+
+		map();
+
+	} catch (...) {
+
+		unmap();
+		close(_fd);
+		throw;
+	}
+}
+
+BinarySectionFile::~BinarySectionFile() {
+
+	unmap();
+
+	if (_fd >= 0)
+		close(_fd);
+}
+
+std::vector<std::string>
+BinarySectionFile::getSectionNames() const {
+
+	std::vector<std::string> names;
+	for (const auto& p : _sections)
+		names.push_back(p.first);
+
+	return names;
+}
+
+void
+BinarySectionFile::writeSection(
+		const std::string& name,
+		uint32_t           type,
+		std::size_t        elementSize,
+		const void*        data,
+		std::size_t        size,
+		std::size_t        cols) {
+
+	// write the data first, such that the section only becomes visible after
+	// it is complete
+	beginSection(name);
+
+	try {
+
+		appendSection(name, 0, data, size*elementSize);
+		finishSection(name, type, elementSize, size, cols);
+
+	} catch (...) {
+
+		_writing = false;
+		throw;
+	}
+}
+
+void
+BinarySectionFile::remove(std::string name) {
+
+	if (!exists(name))
+		return;
+
+	beginSection(name);
+
+	try {
+
+		finishSection(name, RemovedType, 1, 0, 1);
+
+	} catch (...) {
+
+		_writing = false;
+		throw;
+	}
+}
+
+void
+BinarySectionFile::beginSection(const std::string& name) {
+
+	if (_writing)
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"can not write section " << name << " to " << _filename << " while another section is written");
+
+	_writing = true;
+}
+
+void
+BinarySectionFile::appendSection(const std::string& name, uint64_t offset, const void* data, std::size_t size) {
+
+	writeAt(_end + dataOffset(name) + offset, data, size);
+}
+
+void
+BinarySectionFile::finishSection(
+		const std::string& name,
+		uint32_t           type,
+		std::size_t        elementSize,
+		std::size_t        size,
+		std::size_t        cols) {
+
+	BinarySectionHeader header;
+	std::memset(&header, 0, sizeof(header));
+	header.magic       = SectionMagic;
+	header.version     = Version;
+	header.type        = type;
+	header.elementSize = elementSize;
+	header.size        = size;
+	header.cols        = cols;
+	header.nameLength  = name.size();
+	header.data        = dataOffset(name);
+	header.end         = align(header.data + size*elementSize);
+
+	uint64_t position = _end;
+
+	if (ftruncate(_fd, position + header.end) != 0)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"could not resize " << _filename << ": " << std::strerror(errno));
+
+	// the header is written last, the section is not visible before
+	std::vector<char> prefix(header.data, 0);
+	std::memcpy(prefix.data(), &header, sizeof(header));
+	std::memcpy(prefix.data() + sizeof(header), name.data(), name.size());
+	writeAt(position, prefix.data(), prefix.size());
+
+	_writing = false;
+
+	map();
+
+	if (_unused >= MinUnusedSize && 2*_unused > _mapSize) {
+
+		// the section was written already, failing to reclaim space is not
+		// an error
+		try {
+
+			compact();
+
+		} catch (IOError& e) {
+
+			LOG_ERROR(binarysectionfilelog)
+					<< "could not compact " << _filename << ": "
+					<< e.what() << std::endl;
+		}
+	}
+}
+
+void
+BinarySectionFile::compact() {
+
+	if (_writing)
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"can not compact " << _filename << " while a section is written");
+
+	if (_unused == 0)
+		return;
+
+	LOG_DEBUG(binarysectionfilelog)
+			<< "compacting " << _filename << ", reclaiming "
+			<< _unused << " bytes" << std::endl;
+
+	// keep the sections in the order in which they were written
+	std::vector<const SectionInfo*> sections;
+	for (const auto& p : _sections)
+		sections.push_back(&p.second);
+	std::sort(
+			sections.begin(),
+			sections.end(),
+			[](const SectionInfo* a, const SectionInfo* b) { return a->header < b->header; });
+
+	std::string compactFilename = _filename + ".compact";
+
+	int fd = open(compactFilename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	if (fd < 0)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"could not create " << compactFilename << ": " << std::strerror(errno));
+
+	try {
+
+		// sections store their offsets relative to their header, and their
+		// lengths are multiples of Alignment, so they can be copied as they
+		// are
+		writeAt(fd, 0, _map, sizeof(BinaryFileHeader));
+
+		uint64_t position = sizeof(BinaryFileHeader);
+		for (const SectionInfo* info : sections) {
+
+			writeAt(fd, position, _map + info->header, info->length);
+			position += info->length;
+		}
+
+		if (fsync(fd) != 0 || std::rename(compactFilename.c_str(), _filename.c_str()) != 0)
+			UTIL_THROW_EXCEPTION(
+					IOError,
+					"could not replace " << _filename << " by " << compactFilename << ": " << std::strerror(errno));
+
+	} catch (...) {
+
+		close(fd);
+		unlink(compactFilename.c_str());
+		throw;
+	}
+
+	unmap();
+	close(_fd);
+	_fd = fd;
+
+	map();
+}
+
+uint64_t
+BinarySectionFile::dataOffset(const std::string& name) {
+
+	return align(sizeof(BinarySectionHeader) + name.size());
+}
+
+const BinarySectionFile::SectionInfo&
+BinarySectionFile::section(const std::string& name, uint32_t type) const {
+
+	auto i = _sections.find(name);
+
+	if (i == _sections.end())
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"section " << name << " does not exist in " << _filename);
+
+	if (i->second.type != type)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"section " << name << " in " << _filename << " has a different element type");
+
+	return i->second;
+}
+
+void
+BinarySectionFile::map() {
+
+	unmap();
+
+	struct stat s;
+	if (fstat(_fd, &s) != 0)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"could not stat " << _filename << ": " << std::strerror(errno));
+
+	_mapSize = s.st_size;
+
+	if (_mapSize < sizeof(BinaryFileHeader))
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				_filename << " is not a binary section file");
+
+	void* map = mmap(0, _mapSize, PROT_READ, MAP_SHARED, _fd, 0);
+
+	if (map == MAP_FAILED)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"could not map " << _filename << ": " << std::strerror(errno));
+
+	_map = static_cast<const char*>(map);
+
+	const BinaryFileHeader* fileHeader = reinterpret_cast<const BinaryFileHeader*>(_map);
+
+	if (std::memcmp(fileHeader->magic, FileMagic, sizeof(FileMagic)) != 0)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				_filename << " is not a binary section file");
+
+	if (fileHeader->version > Version)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				_filename << " was written by a newer version (" << fileHeader->version << ")");
+
+	// only the headers are touched here, the data of the sections is not read
+
+	_sections.clear();
+	_unused = 0;
+
+	uint64_t position = sizeof(BinaryFileHeader);
+	while (position + sizeof(BinarySectionHeader) <= _mapSize) {
+
+		const BinarySectionHeader* header = reinterpret_cast<const BinarySectionHeader*>(_map + position);
+
+		// end of the file, or an incomplete section
+		if (header->magic != SectionMagic || header->end > _mapSize - position)
+			break;
+
+		if (header->version > Version)
+			UTIL_THROW_EXCEPTION(
+					IOError,
+					_filename << " contains sections of a newer version (" << header->version << ")");
+
+		// a section has to contain at least its header and name, and the data
+		// of the section has to fit into it
+		if (
+				header->end         <  sizeof(BinarySectionHeader)                 ||
+				header->data        >  header->end                                 ||
+				header->data        <  sizeof(BinarySectionHeader)                 ||
+				header->nameLength  >  header->data - sizeof(BinarySectionHeader)  ||
+				header->elementSize == 0                                           ||
+				header->size        >  (header->end - header->data)/header->elementSize)
+			UTIL_THROW_EXCEPTION(
+					IOError,
+					_filename << " contains a corrupt section header at position " << position);
+
+		SectionInfo info;
+		info.header      = position;
+		info.data        = position + header->data;
+		info.length      = header->end;
+		info.type        = header->type;
+		info.elementSize = header->elementSize;
+		info.size        = header->size;
+		info.cols        = header->cols;
+
+		std::string name(_map + position + sizeof(BinarySectionHeader), header->nameLength);
+
+		// later sections replace earlier ones of the same name
+		auto previous = _sections.find(name);
+		if (previous != _sections.end()) {
+
+			_unused += previous->second.length;
+			_sections.erase(previous);
+		}
+
+		if (header->type == RemovedType)
+			_unused += info.length;
+		else
+			_sections[name] = info;
+
+		position += header->end;
+	}
+
+	if (position < _mapSize)
+		LOG_DEBUG(binarysectionfilelog)
+				<< "ignoring " << (_mapSize - position) << " bytes at the end of "
+				<< _filename << std::endl;
+
+	// appended sections replace incomplete ones
+	_end = position;
+}
+
+void
+BinarySectionFile::unmap() {
+
+	if (_map)
+		munmap(const_cast<char*>(_map), _mapSize);
+
+	_map = 0;
+}
+
+void
+BinarySectionFile::writeAt(int fd, uint64_t position, const void* data, std::size_t size) {
+
+	const char* p = static_cast<const char*>(data);
+
+	while (size > 0) {
+
+		ssize_t written = pwrite(fd, p, size, position);
+
+		if (written < 0) {
+
+			if (errno == EINTR)
+				continue;
+
+			UTIL_THROW_EXCEPTION(
+					IOError,
+					"could not write to " << _filename << ": " << std::strerror(errno));
+		}
+
+		p        += written;
+		size     -= written;
+		position += written;
+	}
+}
@@ -0,0 +1,295 @@
+#ifndef CANDIDATE_MC_IO_BINARY_SECTION_FILE_H__
+#define CANDIDATE_MC_IO_BINARY_SECTION_FILE_H__
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <util/exceptions.h>
+
+/**
+ * A file of named, flat arrays ("sections"), which are read through a
+ * read-only memory map. Reading a section does not copy it, pages of the file
+ * are only loaded when they are accessed.
+ *
+ * Each section has an element type, a number of elements, and a number of
+ * columns (for matrices stored row-major). Sections start at multiples of
+ * Alignment bytes and are versioned, such that future changes to the layout
+ * of a section can be detected.
+ *
+ * Sections are always appended to the file, such that data that was written
+ * before is never modified. Writing a section that exists already appends a
+ * new copy that replaces the old one. The space of replaced and removed
+ * sections is reclaimed by compact(), which happens automatically after a
+ * write once more than half of a sufficiently large file is unused.
+ */
+class BinarySectionFile {
+
+public:
+
+	/**
+	 * A read-only view on the elements of a section. Views are invalidated by
+	 * the next write to the file.
+	 */
+	template <typename T>
+	class View {
+
+	public:
+
+		View() : _data(0), _size(0), _cols(1) {}
+
+		View(const T* data, std::size_t size, std::size_t cols) :
+			_data(data),
+			_size(size),
+			_cols(cols) {}
+
+		const T* begin() const { return _data; }
+		const T* end()   const { return _data + _size; }
+		const T* data()  const { return _data; }
+
+		std::size_t size() const { return _size; }
+		bool       empty() const { return _size == 0; }
+
+		/**
+		 * The number of columns and rows, if this section stores a matrix.
+		 */
+		std::size_t cols() const { return _cols; }
+		std::size_t rows() const { return (_cols == 0 ? 0 : _size/_cols); }
+
+		const T& operator[](std::size_t i) const { return _data[i]; }
+
+		/**
+		 * Pointer to the first element of the given row.
+		 */
+		const T* row(std::size_t i) const { return _data + i*_cols; }
+
+	private:
+
+		const T*    _data;
+		std::size_t _size;
+		std::size_t _cols;
+	};
+
+	/**
+	 * Writes a section incrementally, such that its elements do not have to
+	 * be held in memory at once. The section is always appended, and it
+	 * becomes visible (replacing an existing section of the same name) only
+	 * after finish() was called. No other section can be written to the file
+	 * while a writer is active.
+	 */
+	template <typename T>
+	class SectionWriter {
+
+	public:
+
+		SectionWriter(BinarySectionFile& file, std::string name, std::size_t cols = 1) :
+			_file(file),
+			_name(name),
+			_cols(cols),
+			_size(0),
+			_finished(false) {
+
+			_file.beginSection(_name);
+		}
+
+		~SectionWriter() {
+
+			if (!_finished)
+				_file._writing = false;
+		}
+
+		/**
+		 * Append elements to the section.
+		 */
+		void append(const T* data, std::size_t size) {
+
+			_file.appendSection(_name, _size*sizeof(T), data, size*sizeof(T));
+			_size += size;
+		}
+
+		void append(const std::vector<T>& data) {
+
+			append(data.data(), data.size());
+		}
+
+		/**
+		 * The number of elements appended so far.
+		 */
+		std::size_t size() const { return _size; }
+
+		/**
+		 * Complete the section and make it visible.
+		 */
+		void finish() {
+
+			_file.finishSection(_name, ElementType<T>::Id, sizeof(T), _size, _cols);
+			_finished = true;
+		}
+
+	private:
+
+		BinarySectionFile& _file;
+		std::string        _name;
+		std::size_t        _cols;
+		std::size_t        _size;
+		bool               _finished;
+	};
+
+	// the current version of the file and section layout
+	static const uint32_t Version = 1;
+
+	// sections start at multiples of this many bytes
+	static const std::size_t Alignment = 64;
+
+	// files are compacted after a write only if at least this many bytes are
+	// unused
+	static const uint64_t MinUnusedSize = 64*1024*1024;
+
+	/**
+	 * Open the given file, or create it if it does not exist.
+	 */
+	BinarySectionFile(std::string filename);
+
+	~BinarySectionFile();
+
+	/**
+	 * Write a section of the given name. If cols is larger than one, the
+	 * section is a row-major matrix with size/cols rows.
+	 */
+	template <typename T>
+	void write(std::string name, const T* data, std::size_t size, std::size_t cols = 1) {
+
+		writeSection(name, ElementType<T>::Id, sizeof(T), data, size, cols);
+	}
+
+	template <typename T>
+	void write(std::string name, const std::vector<T>& data, std::size_t cols = 1) {
+
+		write(name, data.data(), data.size(), cols);
+	}
+
+	/**
+	 * Get a view on the section of the given name. Throws an IOError if there
+	 * is no such section, or if it stores elements of a different type.
+	 */
+	template <typename T>
+	View<T> read(std::string name) const {
+
+		const SectionInfo& info = section(name, ElementType<T>::Id);
+
+		return View<T>(reinterpret_cast<const T*>(_map + info.data), info.size, info.cols);
+	}
+
+	/**
+	 * Remove the section of the given name, if it exists. This appends a 
+	 * marker that hides all earlier sections of this name.
+	 */
+	void remove(std::string name);
+
+	/**
+	 * Rewrite the file with only the current sections, dropping replaced and
+	 * removed ones. The compacted file is written next to this one and
+	 * replaces it atomically once it is complete. Like a write, this
+	 * invalidates all views.
+	 */
+	void compact();
+
+	/**
+	 * The number of bytes in this file that are taken by replaced or removed
+	 * sections.
+	 */
+	uint64_t getUnusedSize() const { return _unused; }
+
+	/**
+	 * Check whether a section of the given name exists.
+	 */
+	bool exists(std::string name) const { return _sections.count(name) > 0; }
+
+	/**
+	 * Get the names of all sections in this file.
+	 */
+	std::vector<std::string> getSectionNames() const;
+
+	/**
+	 * The name of this file.
+	 */
+	const std::string& getFilename() const { return _filename; }
+
+private:
+
+	template <typename T> struct ElementType {};
+
+	struct SectionInfo {
+
+		// position of the section header and data in the file, and the size
+		// of the section including its header
+		uint64_t header;
+		uint64_t data;
+		uint64_t length;
+
+		uint32_t    type;
+		std::size_t elementSize;
+		std::size_t size;
+		std::size_t cols;
+	};
+
+	void writeSection(
+			const std::string& name,
+			uint32_t           type,
+			std::size_t        elementSize,
+			const void*        data,
+			std::size_t        size,
+			std::size_t        cols);
+
+	// append a section of the given name, see SectionWriter
+	void beginSection(const std::string& name);
+	void appendSection(const std::string& name, uint64_t offset, const void* data, std::size_t size);
+	void finishSection(
+			const std::string& name,
+			uint32_t           type,
+			std::size_t        elementSize,
+			std::size_t        size,
+			std::size_t        cols);
+
+	// the position of the data of a section of the given name, relative to
+	// its header
+	static uint64_t dataOffset(const std::string& name);
+
+	const SectionInfo& section(const std::string& name, uint32_t type) const;
+
+	// (re-)create the memory map and the section table
+	void map();
+	void unmap();
+
+	void writeAt(uint64_t position, const void* data, std::size_t size) { writeAt(_fd, position, data, size); }
+	void writeAt(int fd, uint64_t position, const void* data, std::size_t size);
+
+	static uint64_t align(uint64_t position) { return (position + Alignment - 1)/Alignment*Alignment; }
+
+	std::string _filename;
+
+	int _fd;
+
+	const char* _map;
+	uint64_t    _mapSize;
+
+	// the end of the last complete section
+	uint64_t _end;
+
+	// the number of bytes of replaced and removed sections
+	uint64_t _unused;
+
+	// a SectionWriter is active
+	bool _writing;
+
+	std::map<std::string, SectionInfo> _sections;
+};
+
+template <> struct BinarySectionFile::ElementType<unsigned char> { static const uint32_t Id = 1; };
+template <> struct BinarySectionFile::ElementType<int32_t>       { static const uint32_t Id = 2; };
+template <> struct BinarySectionFile::ElementType<int64_t>       { static const uint32_t Id = 3; };
+template <> struct BinarySectionFile::ElementType<float>         { static const uint32_t Id = 4; };
+template <> struct BinarySectionFile::ElementType<double>        { static const uint32_t Id = 5; };
+
+#endif // CANDIDATE_MC_IO_BINARY_SECTION_FILE_H__
+
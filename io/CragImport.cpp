@@ -1,10 +1,15 @@
 #include <fstream>
 #include <limits>
+#include <unordered_map>
 #include <vigra/impex.hxx>
 #include <util/Logger.h>
 #include <util/ProgramOptions.h>
 #include <crag/MergeTreeParser.h>
+#include <crag/CragBuilder.h>
+#include <crag/Parallel.h>
 #include "CragImport.h"
+#include "LabelOverlap.h"
+#include "MergeHistory.h"
 
 util::ProgramOption optionMaxMerges(
 		util::_long_name        = "maxMerges",
@@ -32,6 +37,11 @@ util::ProgramOption option2dSupervoxels(
 		                          "a CRAG with SliceNodes instead of VolumeNodes. SliceNodes have more features that only apply "
 		                          "to 2D objects.");
 
+util::ProgramOption optionSupervoxelLabelVolume(
+		util::_long_name        = "supervoxelLabelVolume",
+		util::_description_text = "Keep the supervoxel volume as a label volume for the candidate volumes, instead of "
+		                          "creating a separate mask for each supervoxel.");
+
 void
 CragImport::readCrag(
 		std::string           filename,
@@ -81,6 +91,31 @@ CragImport::readCragFromMergeHistory(
 
 	std::map<int, Crag::Node> idToNode = readSupervoxels(ids, crag, volumes, resolution, offset);
 
+	if (optionMinRegionSize || optionMaxRegionSize) {
+
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"when reading from a merge history, options minRegionSize and maxRegionSize can not be set");
+	}
+
+	LOG_USER(logger::out) << "parsing merge history..." << std::endl;
+
+	MergeHistory history(mergeHistory, optionMergeHistoryWithScores.as<bool>());
+
+	addMerges(history, idToNode, is2D, crag, volumes, mergeCosts);
+
+	LOG_USER(logger::out) << "merge history imported" << std::endl;
+}
+
+void
+CragImport::addMerges(
+		const MergeHistory&              history,
+		const std::map<int, Crag::Node>& idToNode,
+		bool                             is2D,
+		Crag&                            crag,
+		CragVolumes&                     volumes,
+		Costs&                           mergeCosts) {
+
 	// get the highest id
 	int maxId = -1;
 	for (auto& p : idToNode) {
@@ -93,42 +128,32 @@ CragImport::readCragFromMergeHistory(
 	if (optionMaxMerges)
 		maxMerges = optionMaxMerges;
 
-	bool useScores = optionMergeHistoryWithScores.as<bool>();
-
-	std::ifstream file(mergeHistory);
-	if (file.fail()) {
-
-		LOG_ERROR(logger::out) << "could not read merge history" << std::endl;
-		return;
-	}
+	bool useScores = history.hasScores();
 
 	double maxScore = std::numeric_limits<double>::max();
 	if (optionMaxMergeScore)
 		maxScore = optionMaxMergeScore.as<double>();
 
-	if (optionMinRegionSize || optionMaxRegionSize) {
-
-		UTIL_THROW_EXCEPTION(
-				UsageError,
-				"when reading from a merge history, options minRegionSize and maxRegionSize can not be set");
-	}
+	std::unordered_map<int, int> newIdMap;
 
-	LOG_USER(logger::out) << "parsing merge history..." << std::endl;
+	// collect the new nodes and arcs in a builder, with slots for the 
+	// supervoxel nodes
+	CragBuilder builder(crag);
+	std::unordered_map<int, CragBuilder::Slot> idToSlot;
+	for (const auto& p : idToNode)
+		idToSlot[p.first] = builder.existing(p.second);
 
-	std::map<int, int> newIdMap;
+	// levels and scores of the slots (supervoxels are at level 0)
+	std::vector<int>    levels(builder.numSlots(), 0);
+	std::vector<double> scores(builder.numSlots(), 0);
 
 	int numAdded = 0;
-	while (true) {
-		int a, b, c;
-		file >> a;
-		file >> b;
-		file >> c;
-		double score = 0;
-		if (useScores)
-			file >> score;
-
-		if (!file.good())
-			break;
+	for (std::size_t i = 0; i < history.size(); i++) {
+
+		int a = history.a(i);
+		int b = history.b(i);
+		int c = history.c(i);
+		double score = history.score(i);
 
 		// some merge histories are re-using ids, we translate them to new ones
 		// on-the-fly
@@ -149,17 +174,19 @@ CragImport::readCragFromMergeHistory(
 
 		// we might encounter ids that we didn't add, since they are too high in 
 		// the merge tree or have a score exceeding maxScore
-		if (!idToNode.count(a))
+		auto slotA = idToSlot.find(a);
+		auto slotB = idToSlot.find(b);
+		if (slotA == idToSlot.end())
 			continue;
-		if (!idToNode.count(b))
+		if (slotB == idToSlot.end())
 			continue;
 
 		// are we limiting the number of merges?
 		if (maxMerges >= 0) {
 
-			if (crag.getLevel(idToNode[a]) >= maxMerges)
+			if (levels[slotA->second] >= maxMerges)
 				continue;
-			if (crag.getLevel(idToNode[b]) >= maxMerges)
+			if (levels[slotB->second] >= maxMerges)
 				continue;
 		}
 
@@ -167,27 +194,24 @@ CragImport::readCragFromMergeHistory(
 		if (useScores && score >= maxScore)
 			continue;
 
-		Crag::Node n = crag.addNode(is2D ? Crag::SliceNode : Crag::VolumeNode);
-		idToNode[c] = n;
-		if (useScores)
-			mergeCosts.node[n] = score;
-
-		if (!idToNode.count(a))
-			std::cerr << "node " << a << " is used for merging, but was not encountered before" << std::endl;
-		if (!idToNode.count(b))
-			std::cerr << "node " << b << " is used for merging, but was not encountered before" << std::endl;
+		CragBuilder::Slot n = builder.addNode(is2D ? Crag::SliceNode : Crag::VolumeNode);
+		levels.push_back(std::max(levels[slotA->second], levels[slotB->second]) + 1);
+		scores.push_back(score);
 
 		LOG_ALL(logger::out) << "merging " << a << " and " << b << " to " << c << std::endl;
 
-		crag.addSubsetArc(
-				idToNode[a],
-				n);
-		crag.addSubsetArc(
-				idToNode[b],
-				n);
+		builder.addSubsetArc(slotA->second, n);
+		builder.addSubsetArc(slotB->second, n);
+		idToSlot[c] = n;
 		numAdded++;
 	}
 
+	std::vector<Crag::CragNode> nodes = builder.build();
+
+	if (useScores)
+		for (std::size_t i = idToNode.size(); i < nodes.size(); i++)
+			mergeCosts.node[nodes[i]] = scores[i];
+
 	LOG_USER(logger::out) << "history parsed, " << numAdded << " candidates added" << std::endl;
 
 	if (option2dSupervoxels) {
@@ -202,8 +226,6 @@ CragImport::readCragFromMergeHistory(
 						"option '2dSupervoxels' was given, but after import, CRAG contains a node with depth " << volume.depth() << ". Check if the initial supervoxels are really 2D, and that the merge history only merges in 2D.");
 		}
 	}
-
-	LOG_USER(logger::out) << "merge history imported" << std::endl;
 }
 
 void
@@ -229,57 +251,50 @@ CragImport::readCragFromCandidateSegmentation(
 	ExplicitVolume<int> segmentation;
 	readVolumeFromOption(segmentation, candidateSegmentation);
 
-	// get all segments
-	std::set<int> segmentIds;
-	for (int id : segmentation.data())
-		if (id != 0)
-			segmentIds.insert(id);
-
-	LOG_USER(logger::out) << "found " << segmentIds.size() << " segments" << std::endl;
 	LOG_USER(logger::out) << "assigning supervoxels to segments" << std::endl;
 
-	// get overlap of each supervoxel with segments
-	std::map<int /*sv id*/, std::map<int /*segment id*/, int /*size*/>> overlap;
-	for (unsigned int z = 0; z < ids.depth(); z++)
-	for (unsigned int y = 0; y < ids.height(); y++)
-	for (unsigned int x = 0; x < ids.width(); x++) {
+	// get overlap of each supervoxel with segments, sorted by supervoxel id
+	std::vector<LabelOverlap::Overlap> overlaps = LabelOverlap::count(ids, segmentation);
 
-		int svId  = ids(x, y, z);
-		int segId = segmentation(x, y, z);
+	std::set<int> segmentIds;
+	for (const LabelOverlap::Overlap& overlap : overlaps)
+		segmentIds.insert(overlap.b);
 
-		if (segId != 0)
-			overlap[svId][segId]++;
-	}
+	LOG_USER(logger::out) << "found " << segmentIds.size() << " segments" << std::endl;
 
 	// create a node for each segment (that has overlapping supervoxels) and 
 	// link to max-overlap nodes
-	std::map<int, Crag::Node> segIdToNode;
-	for (const auto& nodeSegOverlap : overlap) {
+	CragBuilder builder(crag);
+	std::map<int, CragBuilder::Slot> segIdToSlot;
+	for (auto begin = overlaps.begin(); begin != overlaps.end();) {
 
-		int svId = nodeSegOverlap.first;
-		int maxOverlap = 0;
+		int svId = begin->a;
+		std::size_t maxOverlap = 0;
 		int maxSegmentId = 0;
 
-		for (const auto& segOverlap : nodeSegOverlap.second) {
-
-			int segId = segOverlap.first;
-			int overlap = segOverlap.second;
+		auto end = begin;
+		for (; end != overlaps.end() && end->a == svId; end++) {
 
-			if (segId != 0 && overlap >= maxOverlap) {
+			if (end->size >= maxOverlap) {
 
-				maxOverlap = overlap;
-				maxSegmentId = segId;
+				maxOverlap = end->size;
+				maxSegmentId = end->b;
 			}
 		}
 
-		if (!segIdToNode.count(maxSegmentId)) {
+		begin = end;
 
-			Crag::Node candidate = crag.addNode(is2D ? Crag::SliceNode : Crag::VolumeNode);
-			segIdToNode[maxSegmentId] = candidate;
-		}
+		// background
+		if (svId == 0)
+			continue;
+
+		if (!segIdToSlot.count(maxSegmentId))
+			segIdToSlot[maxSegmentId] = builder.addNode(is2D ? Crag::SliceNode : Crag::VolumeNode);
 
-		crag.addSubsetArc(svIdToNode[svId], segIdToNode[maxSegmentId]);
+		builder.addSubsetArc(builder.existing(svIdToNode[svId]), segIdToSlot[maxSegmentId]);
 	}
+
+	builder.build();
 }
 
 std::map<int, Crag::Node>
@@ -294,56 +309,156 @@ CragImport::readSupervoxels(
 	if (ids.depth() == 1 || option2dSupervoxels)
 		is2D = true;
 
-	int minId, maxId;
-	ids.data().minmax(&minId, &maxId);
+	// the volume is processed in slabs of rows (along x), in parallel
+	const std::size_t width       = ids.width();
+	const std::size_t height      = ids.height();
+	const std::size_t numRows     = height*ids.depth();
+	const std::size_t numSlabs    = std::min(numRows, static_cast<std::size_t>(4*numThreads()));
+	const std::size_t rowsPerSlab = (numSlabs == 0 ? 0 : (numRows + numSlabs - 1)/numSlabs);
 
-	LOG_USER(logger::out) << "supervoxels stack contains ids between " << minId << " and " << maxId << std::endl;
+	const int* data = ids.data().data();
 
-	std::map<int, util::box<int, 3>> bbs;
-	for (unsigned int z = 0; z < ids.depth();  z++)
-	for (unsigned int y = 0; y < ids.height(); y++)
-	for (unsigned int x = 0; x < ids.width();  x++) {
+	// bounding boxes of the labels found in each slab, the hash map is only
+	// consulted once per run of equal labels within a row
+	std::vector<std::unordered_map<int, util::box<int, 3>>> slabBbs(numSlabs);
 
-		int id = ids(x, y, z);
+	parallelFor(numSlabs, [&](std::size_t s) {
 
-		if (id == 0)
-			continue;
+		std::unordered_map<int, util::box<int, 3>>& bbs = slabBbs[s];
 
-		bbs[id].fit(
-				util::box<int, 3>(
-						x,   y,   z,
-						x+1, y+1, z+1));
-	}
+		std::size_t end = std::min(numRows, (s + 1)*rowsPerSlab);
+		for (std::size_t row = s*rowsPerSlab; row < end; row++) {
+
+			const int* labels = data + row*width;
+			int y = row%height;
+			int z = row/height;
+
+			std::size_t x = 0;
+			while (x < width) {
+
+				int id = labels[x];
+				std::size_t begin = x;
+				while (x < width && labels[x] == id)
+					x++;
+
+				if (id == 0)
+					continue;
+
+				util::box<int, 3> run(begin, y, z, x, y + 1, z + 1);
+
+				auto i = bbs.find(id);
+				if (i == bbs.end())
+					bbs.emplace(id, run);
+				else
+					i->second.fit(run);
+			}
+		}
+	});
+
+	std::map<int, util::box<int, 3>> bbs;
+	for (const auto& slab : slabBbs)
+		for (const auto& p : slab) {
+
+			auto i = bbs.find(p.first);
+			if (i == bbs.end())
+				bbs.emplace(p.first, p.second);
+			else
+				i->second.fit(p.second);
+		}
+	slabBbs.clear();
+
+	if (bbs.empty())
+		LOG_USER(logger::out) << "supervoxels stack does not contain any supervoxels" << std::endl;
+	else
+		LOG_USER(logger::out)
+				<< "supervoxels stack contains " << bbs.size() << " supervoxels with ids between "
+				<< bbs.begin()->first << " and " << bbs.rbegin()->first << std::endl;
 
 	LOG_USER(logger::out) << "allocating candidates..." << std::endl;
 
+	CragBuilder builder(crag);
+	builder.addNodes(bbs.size(), is2D ? Crag::SliceNode : Crag::VolumeNode);
+	std::vector<Crag::CragNode> nodes = builder.build();
+
 	std::map<int, Crag::Node> idToNode;
+	auto node = nodes.begin();
+	for (const auto& p : bbs)
+		idToNode[p.first] = *(node++);
+
+	if (optionSupervoxelLabelVolume) {
+
+		// candidate volumes are views on the supervoxel volume
+		auto labels = std::make_shared<ExplicitVolume<int>>(ids);
+		labels->setResolution(resolution);
+		labels->setOffset(offset);
+		volumes.setLabelVolume(labels);
+
+		for (const auto& p : bbs)
+			volumes.setLeafLabel(
+					idToNode[p.first],
+					p.first,
+					util::box<unsigned int, 3>(
+							p.second.min().x(), p.second.min().y(), p.second.min().z(),
+							p.second.max().x(), p.second.max().y(), p.second.max().z()));
+
+		LOG_USER(logger::out) << "supervoxels parsed" << std::endl;
+
+		return idToNode;
+	}
+
+	// allocate all masks first, such that they can be filled in parallel
+	std::unordered_map<int, std::size_t> labelIndex;
+	std::vector<CragVolume*>             masks;
+	std::vector<util::point<int, 3>>     maskOffsets;
+	labelIndex.reserve(bbs.size());
+	masks.reserve(bbs.size());
+	maskOffsets.reserve(bbs.size());
+
 	for (const auto& p : bbs) {
 
 		const int& id               = p.first;
 		const util::box<int, 3>& bb = p.second;
 
-		Crag::Node n = crag.addNode(is2D ? Crag::SliceNode : Crag::VolumeNode);
 		std::shared_ptr<CragVolume> volume = std::make_shared<CragVolume>(bb.width(), bb.height(), bb.depth(), 0);
 		volume->setResolution(resolution);
 		volume->setOffset(offset + bb.min()*resolution);
-		volumes.setVolume(n, volume);
-		idToNode[id] = n;
+		volumes.setVolume(idToNode[id], volume);
+
+		labelIndex[id] = masks.size();
+		masks.push_back(volume.get());
+		maskOffsets.push_back(bb.min());
 	}
 
-	for (unsigned int z = 0; z < ids.depth();  z++)
-	for (unsigned int y = 0; y < ids.height(); y++)
-	for (unsigned int x = 0; x < ids.width();  x++) {
+	// slabs write to disjoint rows of the masks
+	parallelFor(numSlabs, [&](std::size_t s) {
 
-		int id = ids(x, y, z);
+		std::size_t end = std::min(numRows, (s + 1)*rowsPerSlab);
+		for (std::size_t row = s*rowsPerSlab; row < end; row++) {
 
-		if (id == 0)
-			continue;
+			const int* labels = data + row*width;
+			int y = row%height;
+			int z = row/height;
 
-		Crag::Node n = idToNode[id];
+			std::size_t x = 0;
+			while (x < width) {
 
-		(*volumes[n])(x - bbs[id].min().x(), y - bbs[id].min().y(), z - bbs[id].min().z()) = 1;
-	}
+				int id = labels[x];
+				std::size_t begin = x;
+				while (x < width && labels[x] == id)
+					x++;
+
+				if (id == 0)
+					continue;
+
+				std::size_t i = labelIndex.find(id)->second;
+				CragVolume&                mask = *masks[i];
+				const util::point<int, 3>& min  = maskOffsets[i];
+
+				for (std::size_t vx = begin; vx < x; vx++)
+					mask(vx - min.x(), y - min.y(), z - min.z()) = 1;
+			}
+		}
+	});
 
 	LOG_USER(logger::out) << "supervoxels parsed" << std::endl;
 
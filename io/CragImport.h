@@ -2,12 +2,20 @@
 #define CANDIDATE_MC_IO_CRAG_IMPORT_H__
 
 #include <map>
+#include <utility>
+#include <util/Logger.h>
+#include <util/ProgramOptions.h>
 #include <crag/Crag.h>
 #include <crag/CragVolumes.h>
+#include <crag/LeafAdjacencyPropagator.h>
 #include <io/Hdf5VolumeReader.h>
 #include <inference/Costs.h>
+#include <mergetree/IterativeRegionMerging.h>
+#include "MergeHistory.h"
 #include "volumes.h"
 
+extern util::ProgramOption option2dSupervoxels;
+
 template <typename T>
 void
 readVolumeFromOption(ExplicitVolume<T>& volume, std::string option) {
@@ -94,6 +102,43 @@ public:
 			util::point<float, 3> offset,
 			Costs&                mergeCosts);
 
+	/**
+	 * Create a CRAG directly from an iterative region merging, without writing 
+	 * and parsing a merge history. The leaf nodes and their adjacency edges 
+	 * (including the affiliated grid edges) are taken from the region 
+	 * adjacency graph of the merging, such that the adjacency of the leaf 
+	 * nodes does not have to be annotated again. Adjacencies of 
+	 * super-candidates are propagated according to option cragType.
+	 *
+	 * @param supervoxels
+	 *              The supervoxel volume the merging was created for.
+	 * @param merging
+	 *              An iterative region merging on the supervoxels, on which 
+	 *              createMergeTree() was not called yet.
+	 * @param scoringFunction
+	 *              The scoring function to create the merge tree with.
+	 * @param crag
+	 *              The CRAG to fill.
+	 * @param volumes
+	 *              A node map for the leaf node volmes.
+	 * @param resolution
+	 *              The resolution of the volume, to be stored in the volumes.
+	 * @param offset
+	 *              The offset of the volume, to be stored in the volumes.
+	 * @param mergeCosts
+	 *              The merge-score of each candidate.
+	 */
+	template <typename ScoringFunction>
+	void readCragFromRegionMerging(
+			const ExplicitVolume<int>& supervoxels,
+			IterativeRegionMerging<3>& merging,
+			ScoringFunction&           scoringFunction,
+			Crag&                      crag,
+			CragVolumes&               volumes,
+			util::point<float, 3>      resolution,
+			util::point<float, 3>      offset,
+			Costs&                     mergeCosts);
+
 	/**
 	 * Import a CRAG of depth 1 from a supervoxel image or volume and a 
 	 * segmentation image or volume.
@@ -145,7 +190,113 @@ public:
 			CragVolumes&               volumes,
 			util::point<float, 3>      resolution,
 			util::point<float, 3>      offset);
+
+private:
+
+	// add a node for each merge of the history to a CRAG with the given 
+	// supervoxel nodes
+	void addMerges(
+			const MergeHistory&              history,
+			const std::map<int, Crag::Node>& idToNode,
+			bool                             is2D,
+			Crag&                            crag,
+			CragVolumes&                     volumes,
+			Costs&                           mergeCosts);
 };
 
+template <typename ScoringFunction>
+void
+CragImport::readCragFromRegionMerging(
+		const ExplicitVolume<int>& supervoxels,
+		IterativeRegionMerging<3>& merging,
+		ScoringFunction&           scoringFunction,
+		Crag&                      crag,
+		CragVolumes&               volumes,
+		util::point<float, 3>      resolution,
+		util::point<float, 3>      offset,
+		Costs&                     mergeCosts) {
+
+	std::map<int, Crag::Node> idToNode = readSupervoxels(supervoxels, crag, volumes, resolution, offset);
+
+	if (optionCragType.as<std::string>() != "empty") {
+
+		typedef IterativeRegionMerging<3>::RagType RagType;
+
+		// the initial regions of the merging are the supervoxels, their grid 
+		// edges have to be taken before merging moves them to merged regions
+		RagType& rag = merging.getRag();
+
+		// the grid of the merging spans the whole supervoxel volume, the grid 
+		// of the CRAG only the bounding box of the candidates (as in 
+		// PlanarAdjacencyAnnotator), which is smaller if there is background 
+		// at the border
+		const vigra::GridGraph<3>& mergingGrid = merging.getGridGraph();
+
+		util::box<float, 3> cragBB = volumes.getBoundingBox();
+
+		vigra::Shape3 origin;
+		vigra::Shape3 shape;
+		for (int d = 0; d < 3; d++) {
+
+			origin[d] = (cragBB.min()[d] - offset[d])/resolution[d] + 0.5;
+			shape[d]  = (cragBB.max()[d] - cragBB.min()[d])/resolution[d] + 0.5;
+		}
+
+		vigra::GridGraph<3> grid(shape, mergingGrid.neighborhoodType());
+		crag.setGridGraph(grid);
+
+		std::size_t numAffiliatedEdges = 0;
+		for (RagType::EdgeIt e(rag); e != lemon::INVALID; ++e)
+			numAffiliatedEdges += merging.getGridEdges(*e).size();
+		crag.reserveAffiliatedEdges(numAffiliatedEdges);
+
+		std::vector<int64_t> ids;
+
+		unsigned int numAdded = 0;
+		for (RagType::EdgeIt e(rag); e != lemon::INVALID; ++e) {
+
+			auto u = idToNode.find(rag.id(rag.u(*e)));
+			auto v = idToNode.find(rag.id(rag.v(*e)));
+
+			// background
+			if (u == idToNode.end() || v == idToNode.end())
+				continue;
+
+			// both voxels of the grid edges belong to candidates, and are 
+			// therefore within the CRAG grid
+			ids.clear();
+			for (const vigra::GridGraph<3>::Edge& edge : merging.getGridEdges(*e))
+				ids.push_back(
+						grid.id(
+								grid.findEdge(
+										mergingGrid.u(edge) - origin,
+										mergingGrid.v(edge) - origin)));
+
+			Crag::CragEdge newEdge = crag.addAdjacencyEdge(u->second, v->second);
+			crag.setAffiliatedEdgeIds(newEdge, ids.data(), ids.data() + ids.size());
+			numAdded++;
+		}
+
+		LOG_USER(logger::out) << "added " << numAdded << " leaf node adjacency edges" << std::endl;
+	}
+
+	merging.createMergeTree(scoringFunction);
+
+	std::vector<int>   merges;
+	std::vector<float> scores;
+	merging.getMergeHistory(merges, scores);
+
+	MergeHistory history(std::move(merges), std::move(scores));
+
+	bool is2D = (supervoxels.depth() == 1 || option2dSupervoxels);
+
+	addMerges(history, idToNode, is2D, crag, volumes, mergeCosts);
+
+	LeafAdjacencyPropagator propagator;
+	propagator.annotate(crag, volumes);
+
+	LOG_USER(logger::out) << "region merging imported" << std::endl;
+}
+
 #endif // CANDIDATE_MC_IO_CRAG_IMPORT_H__
 
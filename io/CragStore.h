@@ -80,6 +80,12 @@ public:
 	 */
 	virtual void retrieveVolumes(CragVolumes& volumes) = 0;
 
+	/**
+	 * Retrieve the volume of a single leaf node. Returns a null pointer if 
+	 * there is no volume stored for n.
+	 */
+	virtual std::shared_ptr<CragVolume> retrieveVolume(const Crag& crag, Crag::CragNode n) = 0;
+
 	/**
 	 * Retrieve features for the candidates (i.e., the nodes) of the CRAG 
 	 * associated to this store.
@@ -118,6 +124,11 @@ public:
 	 */
 	virtual void retrieveCosts(const Crag& crag, Costs& costs, std::string name) = 0;
 
+	/**
+	 * Get a list of the names of all stored costs.
+	 */
+	virtual std::vector<std::string> getCostsNames() = 0;
+
 	/**
 	 * Store a solution with a given name.
 	 */
@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <sys/stat.h>
+#include <util/Logger.h>
+#include <util/ProgramOptions.h>
+#include "BinaryCragStore.h"
+#include "CragStoreFactory.h"
+#include "Hdf5CragStore.h"
+
+logger::LogChannel cragstorefactorylog("cragstorefactorylog", "[CragStoreFactory] ");
+
+util::ProgramOption optionBinaryCragStore(
+		util::_long_name        = "binaryCragStore",
+		util::_description_text = "Read and write the CRAG, volumes, features, weights, costs, and solutions from this "
+		                          "memory-mapped binary file instead of the project file. The file is a one-way cache: "
+		                          "It is created from the project file if it does not exist or is older than the project "
+		                          "file, but results written to it (e.g., by cmc_solve or cmc_train) are not written back "
+		                          "to the project file. If the binary file contains costs, solutions, or feature weights "
+		                          "that the project file does not, it is not recreated and an error is reported instead.");
+
+CragStore*
+CragStoreFactory::createCragStore(std::string projectFile) {
+
+	if (!optionBinaryCragStore)
+		return new Hdf5CragStore(projectFile);
+
+	std::string binaryFile = optionBinaryCragStore.as<std::string>();
+
+	struct stat projectStat;
+	struct stat binaryStat;
+	bool hasProject = (stat(projectFile.c_str(), &projectStat) == 0);
+	bool hasBinary  = (stat(binaryFile.c_str(),  &binaryStat)  == 0);
+
+	if (hasProject && (!hasBinary || binaryStat.st_mtime < projectStat.st_mtime)) {
+
+		// results are only written to the binary store, do not discard them
+		if (hasBinary) {
+
+			std::vector<std::string> unsaved;
+			{
+				Hdf5CragStore   project(projectFile);
+				BinaryCragStore binary(binaryFile);
+
+				unsaved = findUnsavedResults(binary, project);
+			}
+
+			if (!unsaved.empty()) {
+
+				std::stringstream names;
+				for (const std::string& name : unsaved)
+					names << " " << name;
+
+				UTIL_THROW_EXCEPTION(
+						UsageError,
+						"project file " << projectFile << " is newer than binary CRAG store " << binaryFile <<
+						", but the binary CRAG store contains results that are not in the project file:" <<
+						names.str() << ". Remove " << binaryFile << " to recreate it from the project file.");
+			}
+		}
+
+		LOG_USER(cragstorefactorylog)
+				<< "creating binary CRAG store " << binaryFile
+				<< " from " << projectFile << std::endl;
+
+		// convert into a temporary file first, such that an interrupted 
+		// conversion does not leave an incomplete store behind
+		std::string tmpFile = binaryFile + ".tmp";
+		std::remove(tmpFile.c_str());
+
+		{
+			Hdf5CragStore   source(projectFile);
+			BinaryCragStore target(tmpFile);
+
+			convert(source, target);
+		}
+
+		if (std::rename(tmpFile.c_str(), binaryFile.c_str()) != 0)
+			UTIL_THROW_EXCEPTION(
+					IOError,
+					"could not move " << tmpFile << " to " << binaryFile);
+	}
+
+	return new BinaryCragStore(binaryFile);
+}
+
+std::vector<std::string>
+CragStoreFactory::findUnsavedResults(CragStore& binary, CragStore& project) {
+
+	std::vector<std::string> unsaved;
+
+	std::vector<std::string> projectCosts     = project.getCostsNames();
+	std::vector<std::string> projectSolutions = project.getSolutionNames();
+
+	for (std::string name : binary.getCostsNames())
+		if (std::find(projectCosts.begin(), projectCosts.end(), name) == projectCosts.end())
+			unsaved.push_back("costs/" + name);
+
+	for (std::string name : binary.getSolutionNames())
+		if (std::find(projectSolutions.begin(), projectSolutions.end(), name) == projectSolutions.end())
+			unsaved.push_back("solutions/" + name);
+
+	// feature weights are overwritten by training, compare their values
+	FeatureWeights binaryWeights;
+	FeatureWeights projectWeights;
+	bool hasBinaryWeights  = true;
+	bool hasProjectWeights = true;
+
+	try {
+
+		binary.retrieveFeatureWeights(binaryWeights);
+
+	} catch (std::exception& e) {
+
+		hasBinaryWeights = false;
+	}
+
+	try {
+
+		project.retrieveFeatureWeights(projectWeights);
+
+	} catch (std::exception& e) {
+
+		hasProjectWeights = false;
+	}
+
+	if (hasBinaryWeights && (!hasProjectWeights || binaryWeights.exportToVector() != projectWeights.exportToVector()))
+		unsaved.push_back("feature_weights");
+
+	return unsaved;
+}
+
+void
+CragStoreFactory::convert(CragStore& source, CragStore& target) {
+
+	Crag        crag;
+	CragVolumes volumes(crag);
+
+	source.retrieveCrag(crag);
+	target.saveCrag(crag);
+
+	source.retrieveVolumes(volumes);
+	target.saveVolumes(volumes);
+
+	// all of the following are optional
+
+	try {
+
+		NodeFeatures nodeFeatures(crag);
+		EdgeFeatures edgeFeatures(crag);
+		source.retrieveNodeFeatures(crag, nodeFeatures);
+		source.retrieveEdgeFeatures(crag, edgeFeatures);
+		target.saveNodeFeatures(crag, nodeFeatures);
+		target.saveEdgeFeatures(crag, edgeFeatures);
+
+	} catch (std::exception& e) {
+
+		LOG_USER(cragstorefactorylog) << "no features found" << std::endl;
+	}
+
+	try {
+
+		FeatureWeights weights;
+		source.retrieveFeatureWeights(weights);
+		target.saveFeatureWeights(weights);
+
+	} catch (std::exception& e) {
+
+		LOG_USER(cragstorefactorylog) << "no feature weights found" << std::endl;
+	}
+
+	try {
+
+		FeatureWeights min, max;
+		source.retrieveFeaturesMin(min);
+		source.retrieveFeaturesMax(max);
+		target.saveFeaturesMin(min);
+		target.saveFeaturesMax(max);
+
+	} catch (std::exception& e) {
+
+		LOG_USER(cragstorefactorylog) << "no feature normalization found" << std::endl;
+	}
+
+	Skeletons skeletons(crag);
+	source.retrieveSkeletons(crag, skeletons);
+	target.saveSkeletons(crag, skeletons);
+
+	VolumeRays rays(crag);
+	source.retrieveVolumeRays(rays);
+	target.saveVolumeRays(rays);
+
+	for (std::string name : source.getCostsNames()) {
+
+		Costs costs(crag);
+		source.retrieveCosts(crag, costs, name);
+		target.saveCosts(crag, costs, name);
+	}
+
+	for (std::string name : source.getSolutionNames()) {
+
+		CragSolution solution(crag);
+		source.retrieveSolution(crag, solution, name);
+		target.saveSolution(crag, solution, name);
+	}
+}
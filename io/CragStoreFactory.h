@@ -0,0 +1,32 @@
+#ifndef CANDIDATE_MC_IO_CRAG_STORE_FACTORY_H__
+#define CANDIDATE_MC_IO_CRAG_STORE_FACTORY_H__
+
+#include "CragStore.h"
+
+class CragStoreFactory {
+
+public:
+
+	/**
+	 * Create a crag store for the given project file. If a binary CRAG store 
+	 * is requested via the program options, it is used instead, and created 
+	 * from the project file if it does not exist or is older than the project 
+	 * file. The binary CRAG store is a one-way cache, results saved to it are 
+	 * not written back to the project file. Throws a UsageError if an 
+	 * outdated binary CRAG store contains results that the project file does 
+	 * not, instead of recreating it.
+	 */
+	static CragStore* createCragStore(std::string projectFile);
+
+private:
+
+	// get the names of costs, solutions, and feature weights in binary that 
+	// are not (or differently) in project
+	static std::vector<std::string> findUnsavedResults(CragStore& binary, CragStore& project);
+
+	// copy everything from source to target
+	static void convert(CragStore& source, CragStore& target);
+};
+
+#endif // CANDIDATE_MC_IO_CRAG_STORE_FACTORY_H__
+
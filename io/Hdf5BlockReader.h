@@ -0,0 +1,209 @@
+#ifndef CANDIDATE_MC_IO_HDF5_BLOCK_READER_H__
+#define CANDIDATE_MC_IO_HDF5_BLOCK_READER_H__
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vigra/hdf5impex.hxx>
+#include <util/assert.h>
+#include <util/box.hpp>
+#include <util/exceptions.h>
+
+/**
+ * Reads blocks of 3D datasets from an HDF5 file, one chunk at a time. Chunks
+ * that have been read are kept in a least-recently-used cache of limited
+ * size, such that reading blocks in spatial order reads and decompresses each
+ * chunk only once.
+ *
+ * The reader does not synchronize itself. Concurrent users have to serialize 
+ * all calls together with any other access to the same HDF5 file.
+ */
+template <typename ValueType>
+class Hdf5BlockReader {
+
+public:
+
+	/**
+	 * Create a block reader for the given file, which caches at most
+	 * cacheSize bytes of chunks.
+	 */
+	Hdf5BlockReader(vigra::HDF5File& hdfFile, std::size_t cacheSize) :
+		_hdfFile(hdfFile),
+		_maxCacheSize(cacheSize),
+		_cacheSize(0) {}
+
+	/**
+	 * Get the shape of a dataset.
+	 */
+	vigra::Shape3 getShape(const std::string& dataset) {
+
+		return getInfo(dataset).shape;
+	}
+
+	/**
+	 * Read the part of a dataset within roi (in voxels) into block, which has
+	 * to have the size of roi.
+	 */
+	void read(
+			const std::string&                     dataset,
+			const util::box<unsigned int, 3>&      roi,
+			vigra::MultiArrayView<3, ValueType>    block) {
+
+		const DatasetInfo& info = getInfo(dataset);
+
+		for (int d = 0; d < 3; d++)
+			if (roi.max()[d] > info.shape[d] || roi.min()[d] > roi.max()[d])
+				UTIL_THROW_EXCEPTION(
+						UsageError,
+						"region of interest " << roi << " is not within dataset " << dataset <<
+						" of shape " << info.shape);
+
+		vigra::Shape3 begin(roi.min().x(), roi.min().y(), roi.min().z());
+		vigra::Shape3 end(roi.max().x(), roi.max().y(), roi.max().z());
+
+		UTIL_ASSERT(block.shape() == end - begin);
+
+		if (block.size() == 0)
+			return;
+
+		vigra::Shape3 firstChunk = begin/info.chunkShape;
+		vigra::Shape3 lastChunk  = (end - vigra::Shape3(1))/info.chunkShape;
+
+		vigra::Shape3 c;
+		for (c[2] = firstChunk[2]; c[2] <= lastChunk[2]; c[2]++)
+		for (c[1] = firstChunk[1]; c[1] <= lastChunk[1]; c[1]++)
+		for (c[0] = firstChunk[0]; c[0] <= lastChunk[0]; c[0]++) {
+
+			const vigra::MultiArray<3, ValueType>& chunk = getChunk(dataset, info, c);
+
+			// the overlap of the chunk and the block, in dataset coordinates
+			vigra::Shape3 chunkBegin = c*info.chunkShape;
+			vigra::Shape3 overlapBegin = max(begin, chunkBegin);
+			vigra::Shape3 overlapEnd   = min(end, chunkBegin + chunk.shape());
+
+			block.subarray(overlapBegin - begin, overlapEnd - begin) =
+					chunk.subarray(overlapBegin - chunkBegin, overlapEnd - chunkBegin);
+		}
+	}
+
+	/**
+	 * Remove all chunks from the cache. Has to be called after datasets have
+	 * been changed.
+	 */
+	void clear() {
+
+		_chunks.clear();
+		_lru.clear();
+		_datasets.clear();
+		_cacheSize = 0;
+	}
+
+private:
+
+	struct DatasetInfo {
+
+		vigra::Shape3 shape;
+		vigra::Shape3 chunkShape;
+	};
+
+	typedef std::tuple<std::string, int, int, int> ChunkKey;
+
+	struct CachedChunk {
+
+		vigra::MultiArray<3, ValueType>          data;
+		typename std::list<ChunkKey>::iterator lru;
+	};
+
+	const DatasetInfo& getInfo(const std::string& dataset) {
+
+		auto i = _datasets.find(dataset);
+		if (i != _datasets.end())
+			return i->second;
+
+		DatasetInfo info;
+
+		vigra::ArrayVector<hsize_t> shape = _hdfFile.getDatasetShape(dataset);
+
+		if (shape.size() != 3)
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"dataset " << dataset << " is not three-dimensional");
+
+		for (int d = 0; d < 3; d++)
+			info.shape[d] = shape[d];
+
+		// read along the chunks of the dataset, or blocks of 256^3 voxels for
+		// contiguous datasets
+		info.chunkShape = vigra::Shape3(256);
+
+		vigra::HDF5Handle datasetHandle = _hdfFile.getDatasetHandle(dataset);
+		vigra::HDF5Handle properties(
+				H5Dget_create_plist(datasetHandle),
+				&H5Pclose,
+				"Hdf5BlockReader: could not get dataset creation properties");
+
+		hsize_t chunkDims[3];
+		if (H5Pget_layout(properties) == H5D_CHUNKED && H5Pget_chunk(properties, 3, chunkDims) == 3)
+			for (int d = 0; d < 3; d++)
+				// HDF5 stores dimensions in reverse order
+				info.chunkShape[d] = chunkDims[2 - d];
+
+		return _datasets[dataset] = info;
+	}
+
+	const vigra::MultiArray<3, ValueType>& getChunk(
+			const std::string&   dataset,
+			const DatasetInfo&   info,
+			const vigra::Shape3& c) {
+
+		ChunkKey key(dataset, c[0], c[1], c[2]);
+
+		auto i = _chunks.find(key);
+
+		if (i != _chunks.end()) {
+
+			// move to the front of the LRU list
+			_lru.splice(_lru.begin(), _lru, i->second.lru);
+			return i->second.data;
+		}
+
+		vigra::Shape3 offset = c*info.chunkShape;
+		vigra::Shape3 shape  = min(info.chunkShape, info.shape - offset);
+
+		CachedChunk& chunk = _chunks[key];
+		chunk.data.reshape(shape);
+		_hdfFile.readBlock(dataset, offset, shape, chunk.data);
+
+		_lru.push_front(key);
+		chunk.lru = _lru.begin();
+		_cacheSize += chunk.data.size()*sizeof(ValueType);
+
+		// evict least recently used chunks, but keep the one just read
+		while (_cacheSize > _maxCacheSize && _lru.size() > 1) {
+
+			auto evict = _chunks.find(_lru.back());
+			_cacheSize -= evict->second.data.size()*sizeof(ValueType);
+			_chunks.erase(evict);
+			_lru.pop_back();
+		}
+
+		return chunk.data;
+	}
+
+	vigra::HDF5File& _hdfFile;
+
+	std::map<std::string, DatasetInfo> _datasets;
+
+	std::map<ChunkKey, CachedChunk> _chunks;
+
+	// most recently used chunks first
+	std::list<ChunkKey> _lru;
+
+	std::size_t _maxCacheSize;
+	std::size_t _cacheSize;
+};
+
+#endif // CANDIDATE_MC_IO_HDF5_BLOCK_READER_H__
+
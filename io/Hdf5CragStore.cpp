@@ -1,13 +1,35 @@
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <boost/lexical_cast.hpp>
 #include <util/Logger.h>
+#include <util/ProgramOptions.h>
 #include <util/assert.h>
+#include <crag/CragBuilder.h>
 #include "Hdf5CragStore.h"
+#include "Hdf5StreamWriter.h"
 
 logger::LogChannel hdf5storelog("hdf5storelog", "[Hdf5CragStore] ");
 
+util::ProgramOption optionLazyVolumes(
+		util::_long_name        = "lazyVolumes",
+		util::_description_text = "Read candidate volumes from the project file only when they are needed, instead of "
+		                          "reading all of them when the project is opened.");
+
+util::ProgramOption optionFeaturePrecision(
+		util::_long_name        = "featurePrecision",
+		util::_description_text = "The number of bits (64, 32, or 16) per value when storing features in the project file. "
+		                          "Lower precisions make the project file smaller and faster to read.",
+		util::_default_value    = 64);
+
 void
 Hdf5CragStore::saveCrag(const Crag& crag) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd_mk("crag");
 
@@ -45,14 +67,16 @@ Hdf5CragStore::saveCrag(const Crag& crag) {
 	_hdfFile.cd_mk("affiliated_edges");
 	int numEdges = 0;
 
-	// list of affilitated edges:
+	// affilitated edges are stored in two datasets:
 	//
-	// u v n id_1 ... id_n
+	// edges: u v n (for each leaf edge)
+	// ids:   id_1 ... id_n (concatenated for all leaf edges)
 	//
 	// (u, v) ajacency edge
 	// n      number of affiliated edges
-	// id_i   id of ith affiliated edge
-	std::vector<int> aeIds;
+	// id_i   id of ith affiliated edge (64 bit)
+	std::vector<int>     aeEdges;
+	std::vector<int64_t> aeIds;
 	for (Crag::CragEdge e : crag.edges()) {
 
 		if (!crag.isLeafEdge(e))
@@ -61,11 +85,12 @@ Hdf5CragStore::saveCrag(const Crag& crag) {
 		if (numEdges%100 == 0)
 			LOG_USER(hdf5storelog) << logger::delline << numEdges << " affiliated egde lists prepared" << std::flush;
 
-		aeIds.push_back(crag.id(crag.u(e)));
-		aeIds.push_back(crag.id(crag.v(e)));
-		aeIds.push_back(crag.getAffiliatedEdges(e).size());
-		for (vigra::GridGraph<3>::Edge ae : crag.getAffiliatedEdges(e))
-			aeIds.push_back(crag.getGridGraph().id(ae));
+		Crag::AffiliatedEdges affiliatedEdges = crag.getAffiliatedEdges(e);
+
+		aeEdges.push_back(crag.id(crag.u(e)));
+		aeEdges.push_back(crag.id(crag.v(e)));
+		aeEdges.push_back(affiliatedEdges.size());
+		aeIds.insert(aeIds.end(), affiliatedEdges.beginIds(), affiliatedEdges.endIds());
 
 		numEdges++;
 	}
@@ -76,26 +101,69 @@ Hdf5CragStore::saveCrag(const Crag& crag) {
 
 	LOG_USER(hdf5storelog) << "writing affiliated edge lists..." << std::flush;
 	_hdfFile.write(
-			"list",
-			vigra::ArrayVectorView<int>(aeIds.size(), const_cast<int*>(&aeIds[0])));
+			"edges",
+			vigra::ArrayVectorView<int>(aeEdges.size(), const_cast<int*>(&aeEdges[0])));
+	_hdfFile.write(
+			"ids",
+			vigra::ArrayVectorView<int64_t>(aeIds.size(), const_cast<int64_t*>(&aeIds[0])));
 	LOG_USER(hdf5storelog) << " done." << std::endl;
 }
 
 void
 Hdf5CragStore::retrieveCrag(Crag& crag) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd("crag");
 
+	// read the graph structure as flat arrays, such that the CRAG can be 
+	// created in one pass
+
+	int numNodes = 0;
+	vigra::ArrayVector<int> edges; // stored in pairs
+	vigra::ArrayVector<int> arcs;  // stored in pairs
+	vigra::ArrayVector<int> nodeTypes;
+
 	_hdfFile.cd("adjacencies");
-	readGraph(crag.getAdjacencyGraph());
+	if (_hdfFile.existsDataset("num_nodes")) {
+
+		vigra::ArrayVector<int> nodes;
+		_hdfFile.readAndResize("num_nodes", nodes);
+		numNodes = nodes[0];
+	}
+	if (_hdfFile.existsDataset("edges"))
+		_hdfFile.readAndResize("edges", edges);
 
 	_hdfFile.cd("/crag");
 	_hdfFile.cd("subsets");
-	readDigraph(crag.getSubsetGraph());
+	if (_hdfFile.existsDataset("arcs"))
+		_hdfFile.readAndResize("arcs", arcs);
 
 	_hdfFile.cd("/crag");
-	Hdf5GraphReader::readNodeMap(crag, crag.nodeTypes(), "node_types", Hdf5GraphReader::DefaultConverter<int, Crag::NodeType>());
+	if (_hdfFile.existsDataset("node_types"))
+		_hdfFile.readAndResize("node_types", nodeTypes);
+
+	// node ids are stored contiguously, the slots of the builder are therefore 
+	// the node ids
+
+	CragBuilder builder(crag);
+	builder.reserveNodes(numNodes);
+	builder.reserveEdges(edges.size()/2);
+	builder.reserveArcs(arcs.size()/2);
+
+	for (int i = 0; i < numNodes; i++)
+		builder.addNode(
+				i < static_cast<int>(nodeTypes.size()) ?
+				static_cast<Crag::NodeType>(nodeTypes[i]) :
+				Crag::VolumeNode);
+	builder.addAdjacencyEdges(edges.begin(), edges.end());
+	builder.addSubsetArcs(arcs.begin(), arcs.end());
+
+	std::vector<Crag::CragNode> nodes = builder.build();
+
+	for (int i = 0; i < numNodes; i++)
+		UTIL_ASSERT_REL(crag.id(nodes[i]), ==, i);
 
 	if (_hdfFile.existsDataset("edge_types")) {
 
@@ -112,12 +180,9 @@ Hdf5CragStore::retrieveCrag(Crag& crag) {
 			i += 3;
 
 			// find edge in CRAG and set type
-			for (Crag::IncEdgeIt e(crag, u); e != lemon::INVALID; ++e)
-				if (crag.getAdjacencyGraph().oppositeNode(u, e) == v) {
-
-					crag.edgeTypes()[e] = type;
-					break;
-				}
+			Crag::CragEdge e = crag.findEdge(u, v);
+			if (e != lemon::INVALID)
+				crag.edgeTypes()[e] = type;
 		}
 	}
 
@@ -137,6 +202,38 @@ Hdf5CragStore::retrieveCrag(Crag& crag) {
 		_hdfFile.cd("/crag");
 		_hdfFile.cd("affiliated_edges");
 
+		if (_hdfFile.existsDataset("ids")) {
+
+			vigra::ArrayVector<int>     aeEdges;
+			vigra::ArrayVector<int64_t> aeIds;
+			_hdfFile.readAndResize("edges", aeEdges);
+			_hdfFile.readAndResize("ids", aeIds);
+
+			crag.reserveAffiliatedEdges(aeIds.size());
+
+			const int64_t* ids = aeIds.data();
+			for (unsigned int i = 0; i < aeEdges.size(); i += 3) {
+
+				Crag::CragNode u = crag.nodeFromId(aeEdges[i]);
+				Crag::CragNode v = crag.nodeFromId(aeEdges[i+1]);
+				int n = aeEdges[i+2];
+
+				// find edge in CRAG and set affiliated edge list
+				if (n > 0) {
+
+					Crag::CragEdge e = crag.findEdge(u, v);
+					if (e != lemon::INVALID)
+						crag.setAffiliatedEdgeIds(e, ids, ids + n);
+				}
+
+				ids += n;
+			}
+
+			return;
+		}
+
+		// legacy format: one list of 32 bit ints "u v n id_1 ... id_n"
+
 		if (!_hdfFile.existsDataset("list"))
 			return;
 
@@ -145,6 +242,7 @@ Hdf5CragStore::retrieveCrag(Crag& crag) {
 				"list",
 				aeIds);
 
+		std::vector<int64_t> ids;
 		for (unsigned int i = 0; i < aeIds.size();) {
 
 			Crag::CragNode u = crag.nodeFromId(aeIds[i]);
@@ -152,19 +250,16 @@ Hdf5CragStore::retrieveCrag(Crag& crag) {
 			int n = aeIds[i+2];
 			i += 3;
 
-			std::vector<vigra::GridGraph<3>::Edge> affiliatedEdges;
-			for (int j = 0; j < n; j++)
-				affiliatedEdges.push_back(crag.getGridGraph().edgeFromId(aeIds[i+j]));
+			ids.assign(aeIds.begin() + i, aeIds.begin() + i + n);
 			i += n;
 
 			// find edge in CRAG and set affiliated edge list
-			if (affiliatedEdges.size()  > 0)
-				for (Crag::CragEdge e : crag.adjEdges(u))
-					if (crag.getAdjacencyGraph().oppositeNode(u, e) == v) {
+			if (ids.size() > 0) {
 
-						crag.setAffiliatedEdges(e, affiliatedEdges);
-						break;
-					}
+				Crag::CragEdge e = crag.findEdge(u, v);
+				if (e != lemon::INVALID)
+					crag.setAffiliatedEdgeIds(e, ids.data(), ids.data() + ids.size());
+			}
 		}
 
 	} catch (std::exception& e) {
@@ -176,26 +271,76 @@ Hdf5CragStore::retrieveCrag(Crag& crag) {
 void
 Hdf5CragStore::saveVolumes(const CragVolumes& volumes) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	if (volumes.hasLabelVolume()) {
+
+		_hdfFile.cd_mk("/crag");
+		_hdfFile.cd_mk("volumes");
+
+		// only one representation of the volumes is kept, retrieveVolumes() 
+		// would otherwise prefer the label volume even if it is outdated
+		for (std::string name : { "serialized", "meta", "offsets", "resolutions", "index" })
+			removeDataset(name);
+		_volumeIndex.clear();
+
+		saveLabelVolumes(volumes);
+		return;
+	}
+
+	const Crag& crag = volumes.getCrag();
+
+	// produce the leaf node volumes one by one, lazily loaded volumes have to 
+	// be read from the calling thread
+	Crag::NodeIt next(crag);
+	saveVolumes(crag, [&](Crag::CragNode& n, std::shared_ptr<CragVolume>& volume) {
+
+		// only store leaf node volumes
+		while (next != lemon::INVALID && !crag.isLeafNode(next))
+			++next;
+
+		if (next == lemon::INVALID)
+			return false;
+
+		n = next;
+		volume = volumes[n];
+		++next;
+
+		return true;
+	},
+	!volumes.hasVolumeLoader());
+}
+
+void
+Hdf5CragStore::saveVolumes(const Crag& crag, VolumeProducer producer, bool concurrent) {
+
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.cd_mk("/crag");
 	_hdfFile.cd_mk("volumes");
 
-	std::vector<unsigned char> serialized;
+	removeDataset("labels");
+	removeDataset("leaf_labels");
+
+	_volumeIndex.clear();
+
 	std::vector<int> meta;
 	std::vector<float> offsets;
 	std::vector<float> resolutions;
+	std::vector<int64_t> index;
+
+	// chunked and compressed, such that single volumes can be read without 
+	// reading the whole dataset
+	Hdf5StreamWriter serialized(_hdfFile, "/crag/volumes", "serialized", VolumeChunkSize, VolumeCompressionLevel);
 
 	int numNodes = 0;
-	for (Crag::NodeIt n(volumes.getCrag()); n != lemon::INVALID; ++n) {
 
-		// only store leaf node volumes
-		if (!volumes.getCrag().isLeafNode(n))
-			continue;
+	auto write = [&](int id, const CragVolume& volume) {
 
 		if (numNodes%100 == 0)
-			LOG_USER(hdf5storelog) << logger::delline << numNodes << " node volumes prepared for writing" << std::flush;
+			LOG_USER(hdf5storelog) << logger::delline << numNodes << " node volumes written" << std::flush;
 
-		const CragVolume& volume = *volumes[n];
-		meta.push_back(volumes.getCrag().id(n));
+		meta.push_back(id);
 		meta.push_back(volume.width());
 		meta.push_back(volume.height());
 		meta.push_back(volume.depth());
@@ -205,27 +350,122 @@ Hdf5CragStore::saveVolumes(const CragVolumes& volumes) {
 		resolutions.push_back(volume.getResolution().x());
 		resolutions.push_back(volume.getResolution().y());
 		resolutions.push_back(volume.getResolution().z());
-		std::copy(volume.data().begin(), volume.data().end(), std::back_inserter(serialized));
+		index.push_back(serialized.size());
+		serialized.append(volume.data().data(), volume.data().size());
 
 		numNodes++;
+	};
+
+	if (!concurrent) {
+
+		// the producer might read from an HDF5 file (this one, or another one 
+		// through a non-thread-safe HDF5 library), call it from this thread
+		Crag::CragNode              n;
+		std::shared_ptr<CragVolume> volume;
+
+		while (producer(n, volume))
+			write(crag.id(n), *volume);
+
+		serialized.flush();
+
+	} else {
+
+		// volumes are produced in a separate thread and handed over through a 
+		// bounded queue, such that producing and writing overlap
+		std::deque<std::pair<int, std::shared_ptr<CragVolume>>> queue;
+		std::mutex              mutex;
+		std::condition_variable changed;
+		bool                    produced = false;
+		bool                    aborted  = false;
+		std::exception_ptr      producerError;
+
+		std::thread producerThread([&]() {
+
+			try {
+
+				Crag::CragNode              n;
+				std::shared_ptr<CragVolume> volume;
+
+				while (producer(n, volume)) {
+
+					std::unique_lock<std::mutex> lock(mutex);
+					changed.wait(lock, [&]{ return queue.size() < MaxQueuedVolumes || aborted; });
+
+					if (aborted)
+						break;
+
+					queue.emplace_back(crag.id(n), volume);
+					changed.notify_all();
+				}
+
+			} catch (...) {
+
+				producerError = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			produced = true;
+			changed.notify_all();
+		});
+
+		try {
+
+			while (true) {
+
+				std::pair<int, std::shared_ptr<CragVolume>> next;
+
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					changed.wait(lock, [&]{ return !queue.empty() || produced; });
+
+					if (queue.empty())
+						break;
+
+					next = queue.front();
+					queue.pop_front();
+					changed.notify_all();
+				}
+
+				write(next.first, *next.second);
+			}
+
+			serialized.flush();
+
+		} catch (...) {
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				aborted = true;
+				changed.notify_all();
+			}
+
+			producerThread.join();
+			throw;
+		}
+
+		producerThread.join();
+
+		if (producerError)
+			std::rethrow_exception(producerError);
 	}
 
-	LOG_USER(hdf5storelog) << logger::delline << numNodes << " node volumes prepared for writing" << std::endl;
+	LOG_USER(hdf5storelog) << logger::delline << numNodes << " node volumes written" << std::endl;
 
-	LOG_USER(hdf5storelog) << "writing node volumes... " << std::flush;
+	LOG_USER(hdf5storelog) << "writing node volume index... " << std::flush;
 
+	_hdfFile.cd("/crag/volumes");
 	_hdfFile.write(
-			"serialized",
-			vigra::ArrayVectorView<unsigned char>(serialized.size(), const_cast<unsigned char*>(&serialized[0])));
+			"index",
+			vigra::ArrayVectorView<int64_t>(index.size(), const_cast<int64_t*>(index.data())));
 	_hdfFile.write(
 			"meta",
-			vigra::ArrayVectorView<int>(meta.size(), const_cast<int*>(&meta[0])));
+			vigra::ArrayVectorView<int>(meta.size(), const_cast<int*>(meta.data())));
 	_hdfFile.write(
 			"offsets",
-			vigra::ArrayVectorView<float>(offsets.size(), const_cast<float*>(&offsets[0])));
+			vigra::ArrayVectorView<float>(offsets.size(), const_cast<float*>(offsets.data())));
 	_hdfFile.write(
 			"resolutions",
-			vigra::ArrayVectorView<float>(resolutions.size(), const_cast<float*>(&resolutions[0])));
+			vigra::ArrayVectorView<float>(resolutions.size(), const_cast<float*>(resolutions.data())));
 
 	LOG_USER(hdf5storelog) << "done." << std::endl;
 }
@@ -233,10 +473,40 @@ Hdf5CragStore::saveVolumes(const CragVolumes& volumes) {
 void
 Hdf5CragStore::retrieveVolumes(CragVolumes& volumes) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd("/crag");
 	_hdfFile.cd("volumes");
 
+	if (_hdfFile.existsDataset("labels")) {
+
+		retrieveLabelVolumes(volumes);
+		return;
+	}
+
+	if (optionLazyVolumes) {
+
+		readVolumeIndex();
+
+		const Crag& crag = volumes.getCrag();
+
+		for (const auto& p : _volumeIndex) {
+
+			const VolumeInfo& info = p.second;
+
+			volumes.setLeafBoundingBox(
+					crag.nodeFromId(p.first),
+					util::box<float, 3>(
+							info.offset,
+							info.offset + info.size*info.resolution));
+		}
+
+		volumes.setVolumeLoader([this, &crag](Crag::CragNode n) { return retrieveVolume(crag, n); });
+
+		return;
+	}
+
 	vigra::MultiArray<1, unsigned char> serialized;
 	vigra::MultiArray<1, int> meta;
 	vigra::MultiArray<1, float> offsets;
@@ -283,42 +553,161 @@ Hdf5CragStore::retrieveVolumes(CragVolumes& volumes) {
 	}
 }
 
+std::shared_ptr<CragVolume>
+Hdf5CragStore::retrieveVolume(const Crag& crag, Crag::CragNode n) {
+
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	readVolumeIndex();
+
+	auto i = _volumeIndex.find(crag.id(n));
+	if (i == _volumeIndex.end())
+		return std::shared_ptr<CragVolume>();
+
+	const VolumeInfo& info = i->second;
+
+	auto volume = std::make_shared<CragVolume>(info.size.x(), info.size.y(), info.size.z());
+	volume->setResolution(info.resolution);
+	volume->setOffset(info.offset);
+
+	// read only the hyperslab of this volume
+	vigra::Shape1 begin(info.begin);
+	vigra::Shape1 shape(static_cast<std::size_t>(info.size.x())*info.size.y()*info.size.z());
+
+	if (shape[0] > 0)
+		_hdfFile.readBlock(
+				"/crag/volumes/serialized",
+				begin,
+				shape,
+				vigra::MultiArrayView<1, unsigned char>(shape, volume->data().data()));
+
+	return volume;
+}
+
+void
+Hdf5CragStore::readVolumeIndex() {
+
+	if (!_volumeIndex.empty())
+		return;
+
+	_hdfFile.cd("/crag/volumes");
+
+	vigra::MultiArray<1, int> meta;
+	vigra::MultiArray<1, float> offsets;
+	vigra::MultiArray<1, float> resolutions;
+	vigra::ArrayVector<int64_t> index;
+
+	_hdfFile.readAndResize("meta", meta);
+	_hdfFile.readAndResize("offsets", offsets);
+	_hdfFile.readAndResize("resolutions", resolutions);
+
+	// projects without an index store the volumes in the order of meta
+	if (_hdfFile.existsDataset("index"))
+		_hdfFile.readAndResize("index", index);
+
+	UTIL_ASSERT_REL(meta.size() % 4, ==, 0);
+	UTIL_ASSERT_REL(meta.size()/4, ==, offsets.size()/3);
+	UTIL_ASSERT_REL(meta.size()/4, ==, resolutions.size()/3);
+
+	int64_t begin = 0;
+	for (std::size_t i = 0; i < meta.size()/4; i++) {
+
+		VolumeInfo info;
+		info.size       = util::point<unsigned int, 3>(meta[4*i + 1], meta[4*i + 2], meta[4*i + 3]);
+		info.offset     = util::point<float, 3>(offsets[3*i], offsets[3*i + 1], offsets[3*i + 2]);
+		info.resolution = util::point<float, 3>(resolutions[3*i], resolutions[3*i + 1], resolutions[3*i + 2]);
+		info.begin      = (index.size() > 0 ? index[i] : begin);
+
+		begin = info.begin + static_cast<int64_t>(info.size.x())*info.size.y()*info.size.z();
+
+		_volumeIndex[meta[4*i]] = info;
+	}
+}
+
+void
+Hdf5CragStore::saveLabelVolumes(const CragVolumes& volumes) {
+
+	LOG_USER(hdf5storelog) << "writing label volume... " << std::flush;
+
+	writeVolume(*volumes.getLabelVolume(), "labels");
+
+	// id, label, and bounding box of each leaf node
+	std::vector<int> leafLabels;
+	for (Crag::CragNode n : volumes.getCrag().nodes()) {
+
+		if (!volumes.getCrag().isLeafNode(n))
+			continue;
+
+		const util::box<unsigned int, 3>& bb = volumes.getLeafLabelBoundingBox(n);
+
+		leafLabels.push_back(volumes.getCrag().id(n));
+		leafLabels.push_back(volumes.getLeafLabel(n));
+		leafLabels.push_back(bb.min().x());
+		leafLabels.push_back(bb.min().y());
+		leafLabels.push_back(bb.min().z());
+		leafLabels.push_back(bb.max().x());
+		leafLabels.push_back(bb.max().y());
+		leafLabels.push_back(bb.max().z());
+	}
+
+	_hdfFile.write(
+			"leaf_labels",
+			vigra::ArrayVectorView<int>(leafLabels.size(), const_cast<int*>(leafLabels.data())));
+
+	LOG_USER(hdf5storelog) << "done." << std::endl;
+}
+
+void
+Hdf5CragStore::retrieveLabelVolumes(CragVolumes& volumes) {
+
+	auto labels = std::make_shared<ExplicitVolume<int>>();
+	readVolume(*labels, "labels");
+	volumes.setLabelVolume(labels);
+
+	vigra::MultiArray<1, int> leafLabels;
+	_hdfFile.readAndResize("leaf_labels", leafLabels);
+
+	UTIL_ASSERT_REL(leafLabels.size() % 8, ==, 0);
+
+	for (std::size_t i = 0; i < leafLabels.size(); i += 8)
+		volumes.setLeafLabel(
+				volumes.getCrag().nodeFromId(leafLabels[i]),
+				leafLabels[i + 1],
+				util::box<unsigned int, 3>(
+						leafLabels[i + 2], leafLabels[i + 3], leafLabels[i + 4],
+						leafLabels[i + 5], leafLabels[i + 6], leafLabels[i + 7]));
+}
+
 void
 Hdf5CragStore::saveNodeFeatures(const Crag& crag, const NodeFeatures& features) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	LOG_USER(hdf5storelog) << "saving node features... " << std::flush;
 
 	_hdfFile.root();
 	_hdfFile.cd_mk("crag");
 	_hdfFile.cd_mk("features");
 
+	// the features of each type are stored as the ids of the nodes and the
+	// feature matrix with one column per node, which is the in-memory layout
+	// of Features
+
 	for (Crag::NodeType type : Crag::NodeTypes) {
 
-		int numNodes = 0;
-		for (Crag::CragNode n : crag.nodes())
-			if (crag.type(n) == type)
-				numNodes++;
+		const NodeFeatures::FeaturesType& typeFeatures = features.getFeatures(type);
 
-		if (numNodes == 0)
+		if (typeFeatures.keys().empty() || typeFeatures.dims() == 0)
 			continue;
 
-		vigra::MultiArray<2, double> allFeatures(vigra::Shape2(features.dims(type) + 1, numNodes));
-
-		int nodeNum = 0;
-		for (Crag::CragNode n : crag.nodes()) {
+		vigra::MultiArray<1, int> ids(vigra::Shape1(typeFeatures.keys().size()));
+		for (std::size_t i = 0; i < typeFeatures.keys().size(); i++)
+			ids[i] = crag.id(typeFeatures.keys()[i]);
 
-			if (crag.type(n) != type)
-				continue;
+		std::string name = std::string("nodes_") + boost::lexical_cast<std::string>(type);
 
-			allFeatures(0, nodeNum) = crag.id(n);
-			std::copy(
-					features[n].begin(),
-					features[n].end(),
-					allFeatures.bind<1>(nodeNum).begin() + 1);
-			nodeNum++;
-		}
-
-		_hdfFile.write(std::string("nodes_") + boost::lexical_cast<std::string>(type), allFeatures);
+		_hdfFile.write(name + "_ids", ids);
+		writeFeatures(name, typeFeatures.data(), ids.size(), typeFeatures.dims(), typeFeatures.stride());
 	}
 
 	LOG_USER(hdf5storelog) << "done." << std::endl;
@@ -327,74 +716,91 @@ Hdf5CragStore::saveNodeFeatures(const Crag& crag, const NodeFeatures& features)
 void
 Hdf5CragStore::retrieveNodeFeatures(const Crag& crag, NodeFeatures& features) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd("crag");
 	_hdfFile.cd("features");
 
-	vigra::MultiArray<2, double> allFeatures;
-
 	for (Crag::NodeType type : Crag::NodeTypes) {
 
-		if (!_hdfFile.existsDataset(std::string("nodes_") + boost::lexical_cast<std::string>(type)))
+		std::string name = std::string("nodes_") + boost::lexical_cast<std::string>(type);
+
+		if (!_hdfFile.existsDataset(name))
 			continue;
 
-		_hdfFile.readAndResize(std::string("nodes_") + boost::lexical_cast<std::string>(type), allFeatures);
+		// features with the ids in the first row
+		if (!_hdfFile.existsDataset(name + "_ids")) {
+
+			vigra::MultiArray<2, double> allFeatures;
+			_hdfFile.readAndResize(name, allFeatures);
 
-		int dims     = allFeatures.shape(0) - 1;
-		int numNodes = allFeatures.shape(1);
+			int dims     = allFeatures.shape(0) - 1;
+			int numNodes = allFeatures.shape(1);
 
-		for (int i = 0; i < numNodes; i++) {
+			for (int i = 0; i < numNodes; i++) {
 
-			Crag::CragNode n = crag.nodeFromId(allFeatures(0, i));
+				Crag::CragNode n = crag.nodeFromId(allFeatures(0, i));
 
-			std::vector<double> f;
-			f.resize(dims);
-			std::copy(
-					allFeatures.bind<1>(i).begin() + 1,
-					allFeatures.bind<1>(i).end(),
-					f.begin());
-			features.set(n, f);
+				std::vector<double> f;
+				f.resize(dims);
+				std::copy(
+						allFeatures.bind<1>(i).begin() + 1,
+						allFeatures.bind<1>(i).end(),
+						f.begin());
+				features.set(n, f);
+			}
+
+			continue;
 		}
+
+		vigra::MultiArray<1, int> ids;
+		_hdfFile.readAndResize(name + "_ids", ids);
+
+		std::vector<Crag::CragNode> nodes;
+		nodes.reserve(ids.size());
+		for (int id : ids)
+			nodes.push_back(crag.nodeFromId(id));
+
+		unsigned int dims = _hdfFile.getDatasetShape(name)[0];
+
+		readFeatures(name, features.getFeatures(type).reset(nodes, dims), nodes.size(), dims);
 	}
 }
 
 void
 Hdf5CragStore::saveEdgeFeatures(const Crag& crag, const EdgeFeatures& features) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	LOG_USER(hdf5storelog) << "saving edge features... " << std::flush;
 
 	_hdfFile.root();
 	_hdfFile.cd_mk("crag");
 	_hdfFile.cd_mk("features");
 
+	// as for nodes, but edges are identified by the ids of their nodes
+
 	for (Crag::EdgeType type : Crag::EdgeTypes) {
 
-		int numEdges = 0;
-		for (Crag::CragEdge e : crag.edges())
-			if (crag.type(e) == type)
-				numEdges++;
+		const EdgeFeatures::FeaturesType& typeFeatures = features.getFeatures(type);
 
-		if (numEdges == 0)
+		if (typeFeatures.keys().empty() || typeFeatures.dims() == 0)
 			continue;
 
-		vigra::MultiArray<2, double> allFeatures(vigra::Shape2(features.dims(type) + 2, numEdges));
-
-		int edgeNum = 0;
-		for (Crag::CragEdge e : crag.edges()) {
+		vigra::MultiArray<2, int> ids(vigra::Shape2(2, typeFeatures.keys().size()));
+		for (std::size_t i = 0; i < typeFeatures.keys().size(); i++) {
 
-			if (crag.type(e) != type)
-				continue;
+			Crag::CragEdge e = typeFeatures.keys()[i];
 
-			allFeatures(0, edgeNum) = crag.id(e.u());
-			allFeatures(1, edgeNum) = crag.id(e.v());
-			std::copy(
-					features[e].begin(),
-					features[e].end(),
-					allFeatures.bind<1>(edgeNum).begin() + 2);
-			edgeNum++;
+			ids(0, i) = crag.id(e.u());
+			ids(1, i) = crag.id(e.v());
 		}
 
-		_hdfFile.write(std::string("edges_") + boost::lexical_cast<std::string>(type), allFeatures);
+		std::string name = std::string("edges_") + boost::lexical_cast<std::string>(type);
+
+		_hdfFile.write(name + "_ids", ids);
+		writeFeatures(name, typeFeatures.data(), typeFeatures.keys().size(), typeFeatures.dims(), typeFeatures.stride());
 	}
 
 	LOG_USER(hdf5storelog) << "done." << std::endl;
@@ -403,73 +809,307 @@ Hdf5CragStore::saveEdgeFeatures(const Crag& crag, const EdgeFeatures& features)
 void
 Hdf5CragStore::retrieveEdgeFeatures(const Crag& crag, EdgeFeatures& features) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd("crag");
 	_hdfFile.cd("features");
 
 	for (Crag::EdgeType type : Crag::EdgeTypes) {
 
-		if (!_hdfFile.existsDataset(std::string("edges_") + boost::lexical_cast<std::string>(type)))
+		std::string name = std::string("edges_") + boost::lexical_cast<std::string>(type);
+
+		if (!_hdfFile.existsDataset(name))
 			continue;
 
-		vigra::MultiArray<2, double> allFeatures;
+		// features with the ids of u and v in the first two rows
+		if (!_hdfFile.existsDataset(name + "_ids")) {
+
+			vigra::MultiArray<2, double> allFeatures;
+			_hdfFile.readAndResize(name, allFeatures);
+
+			int dims     = allFeatures.shape(0) - 2;
+			int numEdges = allFeatures.shape(1);
+
+			for (int i = 0; i < numEdges; i++) {
+
+				Crag::CragEdge e = findEdge(crag, allFeatures(0, i), allFeatures(1, i));
+
+				std::vector<double> f;
+				f.resize(dims);
+				std::copy(
+						allFeatures.bind<1>(i).begin() + 2,
+						allFeatures.bind<1>(i).end(),
+						f.begin());
+				features.set(e, f);
+			}
+
+			continue;
+		}
+
+		vigra::MultiArray<2, int> ids;
+		_hdfFile.readAndResize(name + "_ids", ids);
+
+		std::vector<Crag::CragEdge> edges;
+		edges.reserve(ids.shape(1));
+		for (int i = 0; i < ids.shape(1); i++)
+			edges.push_back(findEdge(crag, ids(0, i), ids(1, i)));
+
+		unsigned int dims = _hdfFile.getDatasetShape(name)[0];
+
+		readFeatures(name, features.getFeatures(type).reset(edges, dims), edges.size(), dims);
+	}
+}
+
+Crag::CragEdge
+Hdf5CragStore::findEdge(const Crag& crag, int uId, int vId) {
+
+	Crag::CragNode u = crag.nodeFromId(uId);
+	Crag::CragNode v = crag.nodeFromId(vId);
+
+	Crag::CragEdge e = crag.findEdge(u, v);
+
+	if (e == lemon::INVALID)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"can not find edge for nodes " << uId << " and " << vId);
 
-		_hdfFile.readAndResize(std::string("edges_") + boost::lexical_cast<std::string>(type), allFeatures);
+	return e;
+}
+
+void
+Hdf5CragStore::writeFeatures(std::string name, const double* values, std::size_t num, unsigned int dims, std::size_t stride) {
 
-		int dims     = allFeatures.shape(0) - 2;
-		int numEdges = allFeatures.shape(1);
+	vigra::Shape2 shape(dims, num);
 
-		for (int i = 0; i < numEdges; i++) {
+	// rows of the feature matrix (columns in the file) might be padded
+	vigra::MultiArrayView<2, double, vigra::StridedArrayTag> view(
+			shape,
+			vigra::Shape2(1, stride),
+			const_cast<double*>(values));
 
-			Crag::CragNode u = crag.nodeFromId(allFeatures(0, i));
-			Crag::CragNode v = crag.nodeFromId(allFeatures(1, i));
+	int precision = optionFeaturePrecision;
 
-			auto e = crag.adjEdges(u).begin();
-			for (; e != crag.adjEdges(u).end(); e++)
-				if ((*e).opposite(u) == v)
-					break;
+	if (precision == 64) {
 
-			if (e == crag.adjEdges(u).end())
-				UTIL_THROW_EXCEPTION(
-						IOError,
-						"can not find edge for nodes " << crag.id(u) << " and " << crag.id(v));
+		if (stride == dims) {
 
-			std::vector<double> f;
-			f.resize(dims);
-			std::copy(
-					allFeatures.bind<1>(i).begin() + 2,
-					allFeatures.bind<1>(i).end(),
-					f.begin());
-			features.set(*e, f);
+			_hdfFile.write(name, vigra::MultiArrayView<2, double>(shape, const_cast<double*>(values)));
+
+		} else {
+
+			vigra::MultiArray<2, double> compact(view);
+			_hdfFile.write(name, compact);
 		}
+
+	} else if (precision == 32) {
+
+		vigra::MultiArray<2, float> converted(view);
+		_hdfFile.write(name, converted);
+
+	} else if (precision == 16) {
+
+		vigra::MultiArray<2, vigra::UInt16> converted(shape);
+		std::transform(view.begin(), view.end(), converted.begin(), &Hdf5CragStore::toHalf);
+		_hdfFile.write(name, converted);
+
+	} else {
+
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"unsupported feature precision " << precision << ", use 64, 32, or 16");
+	}
+}
+
+void
+Hdf5CragStore::readFeatures(std::string name, double* values, std::size_t num, unsigned int dims) {
+
+	vigra::Shape2 shape(dims, num);
+
+	std::string type = _hdfFile.getDatasetType(name);
+
+	if (type == "DOUBLE") {
+
+		_hdfFile.read(name, vigra::MultiArrayView<2, double>(shape, values));
+
+	} else if (type == "FLOAT") {
+
+		vigra::MultiArray<2, float> stored(shape);
+		_hdfFile.read(name, stored);
+		std::copy(stored.begin(), stored.end(), values);
+
+	} else if (type == "UINT16") {
+
+		vigra::MultiArray<2, vigra::UInt16> stored(shape);
+		_hdfFile.read(name, stored);
+		std::transform(stored.begin(), stored.end(), values, &Hdf5CragStore::fromHalf);
+
+	} else {
+
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"features " << name << " are stored with unsupported type " << type);
+	}
+}
+
+vigra::UInt16
+Hdf5CragStore::toHalf(double value) {
+
+	float f = value;
+	uint32_t bits;
+	std::memcpy(&bits, &f, sizeof(bits));
+
+	uint32_t sign     = (bits >> 16) & 0x8000;
+	uint32_t mantissa = bits & 0x7fffff;
+	int      exponent = static_cast<int>((bits >> 23) & 0xff) - 127 + 15;
+
+	// infinity and nan
+	if (((bits >> 23) & 0xff) == 0xff)
+		return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+
+	// too large, becomes infinity
+	if (exponent >= 31)
+		return sign | 0x7c00;
+
+	uint32_t half;
+	uint32_t rest;
+	uint32_t halfway;
+
+	if (exponent <= 0) {
+
+		// too small, becomes zero
+		if (exponent < -10)
+			return sign;
+
+		// subnormal, the implicit leading one becomes explicit
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+
+		half    = mantissa >> shift;
+		rest    = mantissa & ((1u << shift) - 1);
+		halfway = 1u << (shift - 1);
+
+	} else {
+
+		half    = (exponent << 10) | (mantissa >> 13);
+		rest    = mantissa & 0x1fff;
+		halfway = 0x1000;
 	}
+
+	// round to nearest even, a carry into the exponent is correct
+	if (rest > halfway || (rest == halfway && (half & 1)))
+		half++;
+
+	return sign | half;
+}
+
+double
+Hdf5CragStore::fromHalf(vigra::UInt16 half) {
+
+	uint32_t sign     = (half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1f;
+	uint32_t mantissa = half & 0x3ff;
+
+	// subnormal
+	if (exponent == 0) {
+
+		double value = std::ldexp(static_cast<double>(mantissa), -24);
+		return (sign ? -value : value);
+	}
+
+	uint32_t bits;
+	if (exponent == 0x1f)
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+
+	float f;
+	std::memcpy(&f, &bits, sizeof(f));
+
+	return f;
 }
 
 void
 Hdf5CragStore::saveSkeletons(const Crag& crag, const Skeletons& skeletons) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd_mk("crag");
 	_hdfFile.cd_mk("skeletons");
 
-	for (Crag::NodeIt n(crag); n != lemon::INVALID; ++n) {
+	_skeletonNodes.rows.clear();
+	_skeletonEdges.rows.clear();
 
-		int id                   = crag.id(n);
-		const Skeleton& skeleton = skeletons[n];
-		std::string     name     = boost::lexical_cast<std::string>(id);
+	// the skeletons of all nodes are concatenated:
+	//
+	// ids:          id_1 ... id_k (the CRAG nodes with a skeleton)
+	// node_offsets: begin of the skeleton nodes of each CRAG node, k+1 entries
+	// edge_offsets: begin of the skeleton edges of each CRAG node, k+1 entries
+	// positions:    x y z (for each skeleton node)
+	// diameters:    d (for each skeleton node)
+	// edges:        u v (for each skeleton edge, local to the skeleton)
+	// geometry:     offset and resolution (6 for each CRAG node)
+	std::vector<int>     ids;
+	std::vector<int64_t> nodeOffsets(1, 0);
+	std::vector<int64_t> edgeOffsets(1, 0);
+	std::vector<float>   positions;
+	std::vector<double>  diameters;
+	std::vector<int>     edges;
+	std::vector<float>   geometry;
+
+	for (Crag::CragNode n : crag.nodes()) {
+
+		const Skeleton&          skeleton = skeletons[n];
+		const Hdf5GraphWriter::Graph& graph = skeleton.graph();
+
+		if (Hdf5GraphWriter::Graph::NodeIt(graph) == lemon::INVALID)
+			continue;
 
-		_hdfFile.cd_mk(name);
+		std::vector<int> localIds(graph.maxNodeId() + 1);
+		int numSkeletonNodes = 0;
 
-		writeGraphVolume(skeleton);
-		Hdf5GraphWriter::writeNodeMap(skeleton.graph(), skeleton.diameters(), "diameters");
+		for (Hdf5GraphWriter::Graph::NodeIt node(graph); node != lemon::INVALID; ++node) {
 
-		_hdfFile.cd_up();
+			localIds[graph.id(node)] = numSkeletonNodes++;
+
+			for (int i = 0; i < 3; i++)
+				positions.push_back(skeleton.positions()[node][i]);
+			diameters.push_back(skeleton.diameters()[node]);
+		}
+
+		for (Hdf5GraphWriter::Graph::EdgeIt edge(graph); edge != lemon::INVALID; ++edge) {
+
+			edges.push_back(localIds[graph.id(graph.u(edge))]);
+			edges.push_back(localIds[graph.id(graph.v(edge))]);
+		}
+
+		ids.push_back(crag.id(n));
+		nodeOffsets.push_back(diameters.size());
+		edgeOffsets.push_back(edges.size()/2);
+
+		geometry.push_back(skeleton.getOffset().x());
+		geometry.push_back(skeleton.getOffset().y());
+		geometry.push_back(skeleton.getOffset().z());
+		geometry.push_back(skeleton.getResolutionX());
+		geometry.push_back(skeleton.getResolutionY());
+		geometry.push_back(skeleton.getResolutionZ());
 	}
+
+	writeRagged("ids", ids);
+	writeRagged("node_offsets", nodeOffsets);
+	writeRagged("edge_offsets", edgeOffsets);
+	writeRagged("positions", positions);
+	writeRagged("diameters", diameters);
+	writeRagged("edges", edges);
+	writeRagged("geometry", geometry);
 }
 
 void
 Hdf5CragStore::retrieveSkeletons(const Crag& crag, Skeletons& skeletons) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	try {
 
 		_hdfFile.cd("/crag/skeletons");
@@ -479,6 +1119,124 @@ Hdf5CragStore::retrieveSkeletons(const Crag& crag, Skeletons& skeletons) {
 		return;
 	}
 
+	if (!_hdfFile.existsDataset("node_offsets")) {
+
+		retrieveLegacySkeletons(crag, skeletons);
+		return;
+	}
+
+	// read all skeletons at once
+
+	vigra::ArrayVector<int>     ids;
+	vigra::ArrayVector<int64_t> nodeOffsets;
+	vigra::ArrayVector<int64_t> edgeOffsets;
+	vigra::ArrayVector<float>   positions;
+	vigra::ArrayVector<double>  diameters;
+	vigra::ArrayVector<int>     edges;
+	vigra::ArrayVector<float>   geometry;
+
+	_hdfFile.readAndResize("node_offsets", nodeOffsets);
+	_hdfFile.readAndResize("edge_offsets", edgeOffsets);
+	readRagged("ids", ids);
+	readRagged("positions", positions);
+	readRagged("diameters", diameters);
+	readRagged("edges", edges);
+	readRagged("geometry", geometry);
+
+	UTIL_ASSERT_REL(nodeOffsets.size(), ==, ids.size() + 1);
+	UTIL_ASSERT_REL(edgeOffsets.size(), ==, ids.size() + 1);
+
+	for (std::size_t i = 0; i < ids.size(); i++) {
+
+		Skeleton skeleton;
+		createSkeleton(
+				skeleton,
+				positions.data() + 3*nodeOffsets[i],
+				diameters.data() +   nodeOffsets[i],
+				nodeOffsets[i + 1] - nodeOffsets[i],
+				edges.data()     + 2*edgeOffsets[i],
+				edgeOffsets[i + 1] - edgeOffsets[i],
+				geometry.data()  + 6*i);
+
+		skeletons[crag.nodeFromId(ids[i])] = std::move(skeleton);
+	}
+}
+
+bool
+Hdf5CragStore::retrieveSkeleton(const Crag& crag, Crag::CragNode n, Skeleton& skeleton) {
+
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	if (_skeletonNodes.rows.empty()) {
+
+		try {
+
+			_hdfFile.cd("/crag/skeletons");
+
+		} catch (vigra::PreconditionViolation& e) {
+
+			return false;
+		}
+
+		if (!_hdfFile.existsDataset("node_offsets"))
+			return false;
+
+		readRaggedIndex("ids", "node_offsets", _skeletonNodes);
+		readRaggedIndex("ids", "edge_offsets", _skeletonEdges);
+	}
+
+	auto i = _skeletonNodes.rows.find(crag.id(n));
+	if (i == _skeletonNodes.rows.end())
+		return false;
+
+	std::size_t row = i->second;
+
+	// read only the parts of this skeleton
+
+	int64_t nodesBegin = _skeletonNodes.offsets[row];
+	int64_t numNodes   = _skeletonNodes.offsets[row + 1] - nodesBegin;
+	int64_t edgesBegin = _skeletonEdges.offsets[row];
+	int64_t numEdges   = _skeletonEdges.offsets[row + 1] - edgesBegin;
+
+	vigra::MultiArray<1, float>  positions(vigra::Shape1(3*numNodes));
+	vigra::MultiArray<1, double> diameters(vigra::Shape1(numNodes));
+	vigra::MultiArray<1, int>    edges(vigra::Shape1(2*numEdges));
+	vigra::MultiArray<1, float>  geometry(vigra::Shape1(6));
+
+	vigra::Shape1 begin;
+	vigra::Shape1 shape;
+
+	begin[0] = 3*nodesBegin; shape = positions.shape();
+	_hdfFile.readBlock("/crag/skeletons/positions", begin, shape, positions);
+	begin[0] = nodesBegin;   shape = diameters.shape();
+	_hdfFile.readBlock("/crag/skeletons/diameters", begin, shape, diameters);
+	begin[0] = 6*row;        shape = geometry.shape();
+	_hdfFile.readBlock("/crag/skeletons/geometry", begin, shape, geometry);
+
+	if (numEdges > 0) {
+
+		begin[0] = 2*edgesBegin; shape = edges.shape();
+		_hdfFile.readBlock("/crag/skeletons/edges", begin, shape, edges);
+	}
+
+	skeleton = Skeleton();
+	createSkeleton(
+			skeleton,
+			positions.data(),
+			diameters.data(),
+			numNodes,
+			edges.data(),
+			numEdges,
+			geometry.data());
+
+	return true;
+}
+
+void
+Hdf5CragStore::retrieveLegacySkeletons(const Crag& crag, Skeletons& skeletons) {
+
+	// one group per node
+
 	for (Crag::NodeIt n(crag); n != lemon::INVALID; ++n) {
 
 		LOG_ALL(hdf5storelog) << "reading skeleton for node " << crag.id(n) << std::endl;
@@ -503,43 +1261,93 @@ Hdf5CragStore::retrieveSkeletons(const Crag& crag, Skeletons& skeletons) {
 	}
 }
 
+void
+Hdf5CragStore::createSkeleton(
+		Skeleton&     skeleton,
+		const float*  positions,
+		const double* diameters,
+		std::size_t   numNodes,
+		const int*    edges,
+		std::size_t   numEdges,
+		const float*  geometry) {
+
+	Hdf5GraphReader::Graph& graph = skeleton.graph();
+
+	std::vector<Hdf5GraphReader::Graph::Node> nodes;
+	nodes.reserve(numNodes);
+
+	for (std::size_t i = 0; i < numNodes; i++) {
+
+		Hdf5GraphReader::Graph::Node node = graph.addNode();
+
+		Skeleton::Position position;
+		for (int d = 0; d < 3; d++)
+			position[d] = positions[3*i + d];
+
+		skeleton.positions()[node] = position;
+		skeleton.diameters()[node] = diameters[i];
+		nodes.push_back(node);
+	}
+
+	for (std::size_t i = 0; i < numEdges; i++)
+		graph.addEdge(nodes[edges[2*i]], nodes[edges[2*i + 1]]);
+
+	skeleton.setOffset(geometry[0], geometry[1], geometry[2]);
+	skeleton.setResolution(geometry[3], geometry[4], geometry[5]);
+}
+
 void
 Hdf5CragStore::saveVolumeRays(const VolumeRays& rays) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd_mk("crag");
 	_hdfFile.cd_mk("volume_rays");
 
-	for (Crag::CragNode n : rays.getCrag().nodes()) {
+	_volumeRays.rows.clear();
 
-		int         id   = rays.getCrag().id(n);
-		std::string name = boost::lexical_cast<std::string>(id);
+	// the rays of all nodes are concatenated:
+	//
+	// ids:        id_1 ... id_k (the CRAG nodes with rays)
+	// offsets:    begin of the rays of each CRAG node, k+1 entries
+	// positions:  x y z (for each ray)
+	// directions: x y z (for each ray)
+	std::vector<int>     ids;
+	std::vector<int64_t> offsets(1, 0);
+	std::vector<float>   positions;
+	std::vector<float>   directions;
 
-		_hdfFile.cd_mk(name);
+	for (Crag::CragNode n : rays.getCrag().nodes()) {
 
-		std::vector<double> data;
-		for (auto ray : rays[n]) {
+		if (rays[n].empty())
+			continue;
 
-			data.push_back(ray.position().x());
-			data.push_back(ray.position().y());
-			data.push_back(ray.position().z());
-			data.push_back(ray.direction().x());
-			data.push_back(ray.direction().y());
-			data.push_back(ray.direction().z());
-		}
+		for (const util::ray<float, 3>& ray : rays[n]) {
 
-		if (data.size() > 0)
-			_hdfFile.write(
-					"rays",
-					vigra::ArrayVectorView<double>(data.size(), const_cast<double*>(&data[0])));
+			positions.push_back(ray.position().x());
+			positions.push_back(ray.position().y());
+			positions.push_back(ray.position().z());
+			directions.push_back(ray.direction().x());
+			directions.push_back(ray.direction().y());
+			directions.push_back(ray.direction().z());
+		}
 
-		_hdfFile.cd_up();
+		ids.push_back(rays.getCrag().id(n));
+		offsets.push_back(positions.size()/3);
 	}
+
+	writeRagged("ids", ids);
+	writeRagged("offsets", offsets);
+	writeRagged("positions", positions);
+	writeRagged("directions", directions);
 }
 
 void
 Hdf5CragStore::retrieveVolumeRays(VolumeRays& rays) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	try {
 
 		_hdfFile.cd("/crag/volume_rays");
@@ -549,6 +1357,83 @@ Hdf5CragStore::retrieveVolumeRays(VolumeRays& rays) {
 		return;
 	}
 
+	if (!_hdfFile.existsDataset("offsets")) {
+
+		retrieveLegacyVolumeRays(rays);
+		return;
+	}
+
+	vigra::ArrayVector<int>     ids;
+	vigra::ArrayVector<int64_t> offsets;
+	vigra::ArrayVector<float>   positions;
+	vigra::ArrayVector<float>   directions;
+
+	_hdfFile.readAndResize("offsets", offsets);
+	readRagged("ids", ids);
+	readRagged("positions", positions);
+	readRagged("directions", directions);
+
+	UTIL_ASSERT_REL(offsets.size(), ==, ids.size() + 1);
+
+	for (std::size_t i = 0; i < ids.size(); i++)
+		createVolumeRays(
+				rays[rays.getCrag().nodeFromId(ids[i])],
+				positions.data()  + 3*offsets[i],
+				directions.data() + 3*offsets[i],
+				offsets[i + 1] - offsets[i]);
+}
+
+bool
+Hdf5CragStore::retrieveVolumeRays(const Crag& crag, Crag::CragNode n, std::vector<util::ray<float, 3>>& rays) {
+
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	if (_volumeRays.rows.empty()) {
+
+		try {
+
+			_hdfFile.cd("/crag/volume_rays");
+
+		} catch (vigra::PreconditionViolation& e) {
+
+			return false;
+		}
+
+		if (!_hdfFile.existsDataset("offsets"))
+			return false;
+
+		readRaggedIndex("ids", "offsets", _volumeRays);
+	}
+
+	auto i = _volumeRays.rows.find(crag.id(n));
+	if (i == _volumeRays.rows.end())
+		return false;
+
+	int64_t begin   = _volumeRays.offsets[i->second];
+	int64_t numRays = _volumeRays.offsets[i->second + 1] - begin;
+
+	// read only the rays of this node
+
+	vigra::MultiArray<1, float> positions(vigra::Shape1(3*numRays));
+	vigra::MultiArray<1, float> directions(vigra::Shape1(3*numRays));
+
+	vigra::Shape1 blockBegin(3*begin);
+	vigra::Shape1 blockShape(3*numRays);
+
+	_hdfFile.readBlock("/crag/volume_rays/positions",  blockBegin, blockShape, positions);
+	_hdfFile.readBlock("/crag/volume_rays/directions", blockBegin, blockShape, directions);
+
+	rays.clear();
+	createVolumeRays(rays, positions.data(), directions.data(), numRays);
+
+	return true;
+}
+
+void
+Hdf5CragStore::retrieveLegacyVolumeRays(VolumeRays& rays) {
+
+	// one group per node
+
 	for (Crag::CragNode n : rays.getCrag().nodes()) {
 
 		LOG_ALL(hdf5storelog) << "reading volume rays for node " << rays.getCrag().id(n) << std::endl;
@@ -571,7 +1456,7 @@ Hdf5CragStore::retrieveVolumeRays(VolumeRays& rays) {
 
 		for (unsigned int i = 0; i < data.size();) {
 
-			util::ray<float, 3> ray;
+			util::ray<float,3> ray;
 			ray.position().x() = data[i]; i++;
 			ray.position().y() = data[i]; i++;
 			ray.position().z() = data[i]; i++;
@@ -586,10 +1471,50 @@ Hdf5CragStore::retrieveVolumeRays(VolumeRays& rays) {
 	}
 }
 
+void
+Hdf5CragStore::createVolumeRays(
+		std::vector<util::ray<float, 3>>& rays,
+		const float*                      positions,
+		const float*                      directions,
+		std::size_t                       numRays) {
+
+	rays.reserve(rays.size() + numRays);
+
+	for (std::size_t i = 0; i < numRays; i++) {
+
+		util::ray<float, 3> ray;
+		ray.position().x()  = positions[3*i];
+		ray.position().y()  = positions[3*i + 1];
+		ray.position().z()  = positions[3*i + 2];
+		ray.direction().x() = directions[3*i];
+		ray.direction().y() = directions[3*i + 1];
+		ray.direction().z() = directions[3*i + 2];
+
+		rays.push_back(ray);
+	}
+}
+
+void
+Hdf5CragStore::readRaggedIndex(std::string ids, std::string offsets, RaggedIndex& index) {
+
+	vigra::ArrayVector<int> i;
+	vigra::ArrayVector<int64_t> o;
+	readRagged(ids, i);
+	_hdfFile.readAndResize(offsets, o);
+
+	UTIL_ASSERT_REL(o.size(), ==, i.size() + 1);
+
+	index.rows.clear();
+	for (std::size_t row = 0; row < i.size(); row++)
+		index.rows[i[row]] = row;
+	index.offsets.assign(o.begin(), o.end());
+}
 
 void
 Hdf5CragStore::saveFeatureWeights(const FeatureWeights& weights) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd_mk("/crag");
 	writeWeights(weights, "feature_weights");
@@ -598,6 +1523,8 @@ Hdf5CragStore::saveFeatureWeights(const FeatureWeights& weights) {
 void
 Hdf5CragStore::retrieveFeatureWeights(FeatureWeights& weights) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.cd("/crag");
 	readWeights(weights, "feature_weights");
 }
@@ -605,6 +1532,8 @@ Hdf5CragStore::retrieveFeatureWeights(FeatureWeights& weights) {
 void
 Hdf5CragStore::saveFeaturesMin(const FeatureWeights& min) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd_mk("/crag");
 	writeWeights(min, "features_min");
@@ -613,6 +1542,8 @@ Hdf5CragStore::saveFeaturesMin(const FeatureWeights& min) {
 void
 Hdf5CragStore::retrieveFeaturesMin(FeatureWeights& min) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.cd("/crag");
 	readWeights(min, "features_min");
 }
@@ -620,6 +1551,8 @@ Hdf5CragStore::retrieveFeaturesMin(FeatureWeights& min) {
 void
 Hdf5CragStore::saveFeaturesMax(const FeatureWeights& max) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd_mk("/crag");
 	writeWeights(max, "features_max");
@@ -628,6 +1561,8 @@ Hdf5CragStore::saveFeaturesMax(const FeatureWeights& max) {
 void
 Hdf5CragStore::retrieveFeaturesMax(FeatureWeights& max) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.cd("/crag");
 	readWeights(max, "features_max");
 }
@@ -635,6 +1570,8 @@ Hdf5CragStore::retrieveFeaturesMax(FeatureWeights& max) {
 void
 Hdf5CragStore::saveCosts(const Crag& crag, const Costs& costs, std::string name) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd_mk("/crag");
 	_hdfFile.cd_mk("costs");
@@ -656,6 +1593,8 @@ Hdf5CragStore::saveCosts(const Crag& crag, const Costs& costs, std::string name)
 void
 Hdf5CragStore::retrieveCosts(const Crag& crag, Costs& costs, std::string name) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.cd("/crag");
 	_hdfFile.cd("costs");
 	Hdf5GraphReader::readNodeMap(crag, costs.node, name + "_nodes");
@@ -675,22 +1614,47 @@ Hdf5CragStore::retrieveCosts(const Crag& crag, Costs& costs, std::string name) {
 			i += 3;
 
 			// find edge in CRAG and set costs
-			for (Crag::IncEdgeIt e(crag, u); e != lemon::INVALID; ++e)
-				if (crag.getAdjacencyGraph().oppositeNode(u, e) == v) {
-
-					costs.edge[e] = cost;
-					break;
-				}
+			Crag::CragEdge e = crag.findEdge(u, v);
+			if (e != lemon::INVALID)
+				costs.edge[e] = cost;
 		}
 	}
 }
 
+std::vector<std::string>
+Hdf5CragStore::getCostsNames() {
+
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	std::vector<std::string> names;
+
+	try {
+
+		_hdfFile.root();
+		_hdfFile.cd("/crag/costs");
+
+	} catch (std::exception& e) {
+
+		return names;
+	}
+
+	// costs are stored as "<name>_nodes" and "<name>_edges"
+	const std::string suffix = "_nodes";
+	for (const std::string& dataset : _hdfFile.ls())
+		if (dataset.size() > suffix.size() && dataset.compare(dataset.size() - suffix.size(), suffix.size(), suffix) == 0)
+			names.push_back(dataset.substr(0, dataset.size() - suffix.size()));
+
+	return names;
+}
+
 void
 Hdf5CragStore::saveSolution(
 		const Crag&         crag,
 		const CragSolution& solution,
 		std::string         name) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd_mk("solutions");
 	_hdfFile.cd_mk(name);
@@ -721,6 +1685,8 @@ Hdf5CragStore::retrieveSolution(
 		CragSolution& solution,
 		std::string   name) {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd("solutions");
 	_hdfFile.cd(name);
@@ -745,18 +1711,17 @@ Hdf5CragStore::retrieveSolution(
 		Crag::CragNode v = crag.nodeFromId(selectedEdges[i+1]);
 
 		// find edge in CRAG
-		for (Crag::CragEdge e : crag.adjEdges(u))
-			if (e.opposite(u) == v) {
-
-				solution.setSelected(e, true);
-				break;
-			}
+		Crag::CragEdge e = crag.findEdge(u, v);
+		if (e != lemon::INVALID)
+			solution.setSelected(e, true);
 	}
 }
 
 std::vector<std::string>
 Hdf5CragStore::getSolutionNames() {
 
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 	try {
 
 		_hdfFile.root();
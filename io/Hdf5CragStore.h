@@ -1,6 +1,10 @@
 #ifndef CANDIDATE_MC_IO_HDF_CRAG_STORE_H__
 #define CANDIDATE_MC_IO_HDF_CRAG_STORE_H__
 
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <vigra/hdf5impex.hxx>
 #include "Hdf5GraphReader.h"
 #include "Hdf5GraphWriter.h"
@@ -10,6 +14,11 @@
 #include "Hdf5VolumeWriter.h"
 #include "CragStore.h"
 
+/**
+ * A crag store for HDF5 project files. All access to the project file is
+ * serialized, such that the methods of the store can be called from several
+ * threads, e.g., by leaf node volumes that are loaded on demand.
+ */
 class Hdf5CragStore :
 		public CragStore,
 		public Hdf5GraphReader,
@@ -40,10 +49,28 @@ public:
 
 	/**
 	 * Save CRAG volumes. This will only store the volumes of leaf nodes, others 
-	 * can be assembled from them.
+	 * can be assembled from them. Volumes backed by a label volume are stored 
+	 * as the label volume and the labels of the leaf nodes.
 	 */
 	void saveVolumes(const CragVolumes& volumes) override;
 
+	/**
+	 * A function that provides the next leaf node and its volume to store. 
+	 * Returns false if there are no more volumes.
+	 */
+	typedef std::function<bool(Crag::CragNode&, std::shared_ptr<CragVolume>&)> VolumeProducer;
+
+	/**
+	 * Save leaf node volumes as they are provided by producer. Each volume is 
+	 * written as soon as it is available, without keeping a copy of all 
+	 * volumes in memory. If concurrent is set, the producer is called from a 
+	 * separate thread, such that producing and writing overlap. In this case, 
+	 * the producer must not read from any HDF5 file (including volumes that 
+	 * are lazily loaded from one), otherwise it is called from the calling 
+	 * thread.
+	 */
+	void saveVolumes(const Crag& crag, VolumeProducer producer, bool concurrent = false);
+
 	/**
 	 * Store features for the candidates (i.e., the nodes) of a CRAG.
 	 */
@@ -89,10 +116,20 @@ public:
 	/**
 	 * Retrieve the volumes of CRAG candidates. For that, only the leaf node 
 	 * volumes of the given CragVolumes are set, other volumes will later be 
-	 * created on demand.
+	 * created on demand. If leaf node volumes are loaded on demand (program 
+	 * option lazyVolumes), they are read from this store when they are first 
+	 * accessed, this store and the CRAG have therefore to outlive the given 
+	 * volumes.
 	 */
 	void retrieveVolumes(CragVolumes& volumes) override;
 
+	/**
+	 * Retrieve the volume of a single leaf node, reading only the part of the 
+	 * project file that stores it. Returns a null pointer if there is no 
+	 * volume stored for n.
+	 */
+	std::shared_ptr<CragVolume> retrieveVolume(const Crag& crag, Crag::CragNode n) override;
+
 	/**
 	 * Retrieve features for the candidates (i.e., the nodes) of the CRAG 
 	 * associated to this store.
@@ -116,11 +153,25 @@ public:
 	 */
 	void retrieveSkeletons(const Crag& crag, Skeletons& skeletons) override;
 
+	/**
+	 * Retrieve the skeleton of a single node, reading only the part of the 
+	 * project file that stores it. Returns false if there is no skeleton 
+	 * stored for n.
+	 */
+	bool retrieveSkeleton(const Crag& crag, Crag::CragNode n, Skeleton& skeleton);
+
 	/**
 	 * Retrieve volume rays for the candidates of the CRAG.
 	 */
 	void retrieveVolumeRays(VolumeRays& rays) override;
 
+	/**
+	 * Retrieve the volume rays of a single node, reading only the part of the 
+	 * project file that stores them. Returns false if there are no rays 
+	 * stored for n.
+	 */
+	bool retrieveVolumeRays(const Crag& crag, Crag::CragNode n, std::vector<util::ray<float, 3>>& rays);
+
 	/**
 	 * Retrieve feature weights.
 	 */
@@ -131,6 +182,11 @@ public:
 	 */
 	void retrieveCosts(const Crag& crag, Costs& costs, std::string name);
 
+	/**
+	 * Get a list of the names of all stored costs.
+	 */
+	std::vector<std::string> getCostsNames() override;
+
 	/**
 	 * Store a solution with a given name.
 	 */
@@ -185,10 +241,126 @@ private:
 	void writeGraphVolume(const GraphVolume& graphVolume);
 	void readGraphVolume(GraphVolume& graphVolume);
 
+	// the rows of a ragged array for each node id, and the offsets of the 
+	// rows in the concatenated datasets
+	struct RaggedIndex {
+
+		std::map<int, std::size_t> rows;
+		std::vector<int64_t>       offsets;
+	};
+
+	void readRaggedIndex(std::string ids, std::string offsets, RaggedIndex& index);
+
+	// remove a dataset from the current group, if it exists
+	void removeDataset(std::string name) {
+
+		if (_hdfFile.existsDataset(name))
+			H5Ldelete(_hdfFile.getGroupHandle(_hdfFile.pwd()), name.c_str(), H5P_DEFAULT);
+	}
+
+	// write a concatenated dataset, empty datasets are removed
+	template <typename T>
+	void writeRagged(std::string name, const std::vector<T>& data) {
+
+		if (data.empty()) {
+
+			removeDataset(name);
+			return;
+		}
+
+		_hdfFile.write(
+				name,
+				vigra::MultiArrayView<1, T>(vigra::Shape1(data.size()), const_cast<T*>(data.data())),
+				std::min(data.size(), static_cast<std::size_t>(RaggedChunkSize)),
+				RaggedCompressionLevel);
+	}
+
+	// read a concatenated dataset, missing datasets are empty
+	template <typename T>
+	void readRagged(std::string name, vigra::ArrayVector<T>& data) {
+
+		if (_hdfFile.existsDataset(name))
+			_hdfFile.readAndResize(name, data);
+		else
+			data.clear();
+	}
+
+	// find the edge between the nodes with the given ids, throws if there is
+	// none
+	static Crag::CragEdge findEdge(const Crag& crag, int uId, int vId);
+
+	// write a feature matrix with dims rows and num columns, whose columns 
+	// start stride values apart, using the precision given by the program 
+	// options
+	void writeFeatures(std::string name, const double* values, std::size_t num, unsigned int dims, std::size_t stride);
+
+	// read a feature matrix into values, converting from the stored precision
+	void readFeatures(std::string name, double* values, std::size_t num, unsigned int dims);
+
+	// conversion from and to IEEE half precision floats
+	static vigra::UInt16 toHalf(double value);
+	static double fromHalf(vigra::UInt16 half);
+
+	// read skeletons and volume rays stored in one group per node
+	void retrieveLegacySkeletons(const Crag& crag, Skeletons& skeletons);
+	void retrieveLegacyVolumeRays(VolumeRays& rays);
+
+	static void createSkeleton(
+			Skeleton&     skeleton,
+			const float*  positions,
+			const double* diameters,
+			std::size_t   numNodes,
+			const int*    edges,
+			std::size_t   numEdges,
+			const float*  geometry);
+
+	static void createVolumeRays(
+			std::vector<util::ray<float, 3>>& rays,
+			const float*                      positions,
+			const float*                      directions,
+			std::size_t                       numRays);
+
+	// location of a leaf node volume in the serialized dataset
+	struct VolumeInfo {
+
+		int64_t                      begin;
+		util::point<unsigned int, 3> size;
+		util::point<float, 3>        offset;
+		util::point<float, 3>        resolution;
+	};
+
+	// read the volume infos of all leaf nodes, if not done already
+	void readVolumeIndex();
+
+	// store and retrieve volumes backed by a label volume
+	void saveLabelVolumes(const CragVolumes& volumes);
+	void retrieveLabelVolumes(CragVolumes& volumes);
+
 	void writeWeights(const FeatureWeights& weights, std::string name);
 	void readWeights(FeatureWeights& weights, std::string name);
 
+	// chunk size and compression level (0 to 9) of the serialized volumes
+	static const int VolumeChunkSize        = 64*1024;
+	static const int VolumeCompressionLevel = 3;
+
+	// the maximal number of produced volumes waiting to be written
+	static const std::size_t MaxQueuedVolumes = 64;
+
+	// chunk size and compression level of concatenated skeletons and rays
+	static const int RaggedChunkSize        = 16*1024;
+	static const int RaggedCompressionLevel = 3;
+
+	std::map<int, VolumeInfo> _volumeIndex;
+
+	RaggedIndex _skeletonNodes;
+	RaggedIndex _skeletonEdges;
+	RaggedIndex _volumeRays;
+
 	vigra::HDF5File _hdfFile;
+
+	// serializes all access to _hdfFile and the indices above, recursive since 
+	// public methods call each other
+	std::recursive_mutex _mutex;
 };
 
 #endif // CANDIDATE_MC_IO_HDF_CRAG_STORE_H__
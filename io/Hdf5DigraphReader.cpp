@@ -23,6 +23,9 @@ Hdf5DigraphReader::readDigraph(Digraph& digraph) {
 				"arcs",
 				arcs);
 
+	digraph.reserveNode(numNodes);
+	digraph.reserveArc(arcs.size()/2);
+
 	for (int i = 0; i < numNodes; i++) {
 
 		Digraph::Node node = digraph.addNode();
@@ -23,6 +23,9 @@ Hdf5GraphReader::readGraph(Graph& graph) {
 				"edges",
 				edges);
 
+	graph.reserveNode(numNodes);
+	graph.reserveEdge(edges.size()/2);
+
 	for (int i = 0; i < numNodes; i++) {
 
 		Graph::Node node = graph.addNode();
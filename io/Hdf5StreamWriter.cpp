@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <util/exceptions.h>
+#include "Hdf5StreamWriter.h"
+
+Hdf5StreamWriter::Hdf5StreamWriter(
+		vigra::HDF5File& hdfFile,
+		std::string      group,
+		std::string      dataset,
+		std::size_t      chunkSize,
+		int              compressionLevel) :
+	_chunkSize(std::max(chunkSize, static_cast<std::size_t>(1))),
+	_written(0) {
+
+	_buffer.reserve(_chunkSize);
+
+	vigra::HDF5Handle groupHandle = hdfFile.getGroupHandle(group);
+
+	if (H5Lexists(groupHandle, dataset.c_str(), H5P_DEFAULT) > 0)
+		if (H5Ldelete(groupHandle, dataset.c_str(), H5P_DEFAULT) < 0)
+			UTIL_THROW_EXCEPTION(
+					IOError,
+					"could not remove existing dataset " << group << "/" << dataset);
+
+	// an empty dataset that can be extended indefinitely
+	hsize_t dims      = 0;
+	hsize_t maxDims   = H5S_UNLIMITED;
+	hsize_t chunkDims = _chunkSize;
+
+	vigra::HDF5Handle space(
+			H5Screate_simple(1, &dims, &maxDims),
+			&H5Sclose,
+			"Hdf5StreamWriter: could not create dataspace");
+
+	vigra::HDF5Handle properties(
+			H5Pcreate(H5P_DATASET_CREATE),
+			&H5Pclose,
+			"Hdf5StreamWriter: could not create property list");
+
+	H5Pset_chunk(properties, 1, &chunkDims);
+	if (compressionLevel > 0)
+		H5Pset_deflate(properties, compressionLevel);
+
+	_dataset = vigra::HDF5Handle(
+			H5Dcreate2(groupHandle, dataset.c_str(), H5T_NATIVE_UCHAR, space, H5P_DEFAULT, properties, H5P_DEFAULT),
+			&H5Dclose,
+			"Hdf5StreamWriter: could not create dataset");
+}
+
+void
+Hdf5StreamWriter::append(const unsigned char* data, std::size_t size) {
+
+	if (_buffer.size() + size > _chunkSize)
+		flush();
+
+	// large pieces are written directly
+	if (size >= _chunkSize) {
+
+		write(data, size);
+		return;
+	}
+
+	_buffer.insert(_buffer.end(), data, data + size);
+}
+
+void
+Hdf5StreamWriter::flush() {
+
+	if (_buffer.empty())
+		return;
+
+	write(_buffer.data(), _buffer.size());
+	_buffer.clear();
+}
+
+void
+Hdf5StreamWriter::write(const unsigned char* data, std::size_t size) {
+
+	hsize_t offset  = _written;
+	hsize_t count   = size;
+	hsize_t newSize = _written + size;
+
+	if (H5Dset_extent(_dataset, &newSize) < 0)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"could not extend dataset to " << newSize << " elements");
+
+	vigra::HDF5Handle fileSpace(
+			H5Dget_space(_dataset),
+			&H5Sclose,
+			"Hdf5StreamWriter: could not get dataspace");
+
+	vigra::HDF5Handle memSpace(
+			H5Screate_simple(1, &count, 0),
+			&H5Sclose,
+			"Hdf5StreamWriter: could not create dataspace");
+
+	H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, &offset, 0, &count, 0);
+
+	if (H5Dwrite(_dataset, H5T_NATIVE_UCHAR, memSpace, fileSpace, H5P_DEFAULT, data) < 0)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"could not write " << size << " elements to dataset");
+
+	_written = newSize;
+}
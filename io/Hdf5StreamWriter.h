@@ -0,0 +1,62 @@
+#ifndef CANDIDATE_MC_IO_HDF5_STREAM_WRITER_H__
+#define CANDIDATE_MC_IO_HDF5_STREAM_WRITER_H__
+
+#include <string>
+#include <vector>
+#include <vigra/hdf5impex.hxx>
+
+/**
+ * Writes a one-dimensional, chunked, and compressed unsigned char dataset of
+ * unknown final size, by appending data to it. Appended data is buffered up
+ * to the size of one chunk, such that memory usage does not depend on the
+ * size of the dataset.
+ */
+class Hdf5StreamWriter {
+
+public:
+
+	/**
+	 * Create a new dataset in the given group. An existing dataset with the
+	 * same name will be replaced.
+	 *
+	 * @param chunkSize
+	 *              The number of elements per chunk.
+	 * @param compressionLevel
+	 *              The deflate compression level, between 0 (none) and 9.
+	 */
+	Hdf5StreamWriter(
+			vigra::HDF5File& hdfFile,
+			std::string      group,
+			std::string      dataset,
+			std::size_t      chunkSize,
+			int              compressionLevel);
+
+	/**
+	 * Append size elements to the dataset.
+	 */
+	void append(const unsigned char* data, std::size_t size);
+
+	/**
+	 * Write all buffered elements to the file.
+	 */
+	void flush();
+
+	/**
+	 * The number of elements appended so far.
+	 */
+	std::size_t size() const { return _written + _buffer.size(); }
+
+private:
+
+	void write(const unsigned char* data, std::size_t size);
+
+	vigra::HDF5Handle _dataset;
+
+	std::size_t _chunkSize;
+	std::size_t _written;
+
+	std::vector<unsigned char> _buffer;
+};
+
+#endif // CANDIDATE_MC_IO_HDF5_STREAM_WRITER_H__
+
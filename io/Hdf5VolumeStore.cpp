@@ -1,30 +1,59 @@
+#include <util/ProgramOptions.h>
 #include "Hdf5VolumeStore.h"
 
+util::ProgramOption optionChunkCacheSize(
+		util::_module           = "io",
+		util::_long_name        = "chunkCacheSize",
+		util::_description_text = "The size in MB of the cache for chunks of volumes read from the project file, when only "
+		                          "parts of the volumes are requested.",
+		util::_default_value    = 1024);
+
+Hdf5VolumeStore::Hdf5VolumeStore(std::string projectFile) :
+	Hdf5VolumeReader(_hdfFile),
+	Hdf5VolumeWriter(_hdfFile),
+	_hdfFile(
+			projectFile,
+			vigra::HDF5File::OpenMode::ReadWrite),
+	_floatBlocks(_hdfFile, optionChunkCacheSize.as<std::size_t>()*1024*1024),
+	_intBlocks(_hdfFile, optionChunkCacheSize.as<std::size_t>()*1024*1024) {}
+
 void
 Hdf5VolumeStore::saveIntensities(const ExplicitVolume<float>& intensities) {
 
+	std::lock_guard<std::mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd_mk("volumes");
 
 	writeVolume(intensities, "intensities");
+
+	clearCaches();
 }
 
 void
 Hdf5VolumeStore::saveBoundaries(const ExplicitVolume<float>& boundaries) {
 
+	std::lock_guard<std::mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd_mk("volumes");
 
 	writeVolume(boundaries, "boundaries");
+
+	clearCaches();
 }
 
 void
 Hdf5VolumeStore::saveGroundTruth(const ExplicitVolume<int>& labels) {
 
+	std::lock_guard<std::mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd_mk("volumes");
 
 	writeVolume(labels, "groundtruth");
+
+	clearCaches();
 }
 
 void
@@ -33,6 +62,8 @@ Hdf5VolumeStore::saveAffinities(
 		const ExplicitVolume<float>& yAffinities,
 		const ExplicitVolume<float>& zAffinities) {
 
+	std::lock_guard<std::mutex> lock(_mutex);
+
 	_hdfFile.root();
 	_hdfFile.cd_mk("volumes");
 
@@ -40,11 +71,14 @@ Hdf5VolumeStore::saveAffinities(
 	writeVolume(yAffinities, "yAffinities");
 	writeVolume(zAffinities, "zAffinities");
 
+	clearCaches();
 }
 
 void
 Hdf5VolumeStore::retrieveIntensities(ExplicitVolume<float>& intensities) {
 
+	std::lock_guard<std::mutex> lock(_mutex);
+
 	_hdfFile.cd("/volumes");
 	readVolume(intensities, "intensities");
 }
@@ -52,6 +86,8 @@ Hdf5VolumeStore::retrieveIntensities(ExplicitVolume<float>& intensities) {
 void
 Hdf5VolumeStore::retrieveBoundaries(ExplicitVolume<float>& boundaries) {
 
+	std::lock_guard<std::mutex> lock(_mutex);
+
 	_hdfFile.cd("/volumes");
 	readVolume(boundaries, "boundaries");
 }
@@ -59,6 +95,8 @@ Hdf5VolumeStore::retrieveBoundaries(ExplicitVolume<float>& boundaries) {
 void
 Hdf5VolumeStore::retrieveGroundTruth(ExplicitVolume<int>& labels) {
 
+	std::lock_guard<std::mutex> lock(_mutex);
+
 	_hdfFile.cd("/volumes");
 	readVolume(labels, "groundtruth");
 }
@@ -69,8 +107,53 @@ Hdf5VolumeStore::retrieveAffinities(
 		ExplicitVolume<float>& yAffinities,
 		ExplicitVolume<float>& zAffinities) {
 
+	std::lock_guard<std::mutex> lock(_mutex);
+
 	_hdfFile.cd("/volumes");
 	readVolume(xAffinities, "xAffinities");
 	readVolume(yAffinities, "yAffinities");
 	readVolume(zAffinities, "zAffinities");
 }
+
+void
+Hdf5VolumeStore::retrieveIntensities(
+		ExplicitVolume<float>&            intensities,
+		const util::box<unsigned int, 3>& roi) {
+
+	readVolumeBlock(_floatBlocks, intensities, "/volumes/intensities", roi);
+}
+
+void
+Hdf5VolumeStore::retrieveBoundaries(
+		ExplicitVolume<float>&            boundaries,
+		const util::box<unsigned int, 3>& roi) {
+
+	readVolumeBlock(_floatBlocks, boundaries, "/volumes/boundaries", roi);
+}
+
+void
+Hdf5VolumeStore::retrieveGroundTruth(
+		ExplicitVolume<int>&              labels,
+		const util::box<unsigned int, 3>& roi) {
+
+	readVolumeBlock(_intBlocks, labels, "/volumes/groundtruth", roi);
+}
+
+void
+Hdf5VolumeStore::retrieveAffinities(
+		ExplicitVolume<float>&            xAffinities,
+		ExplicitVolume<float>&            yAffinities,
+		ExplicitVolume<float>&            zAffinities,
+		const util::box<unsigned int, 3>& roi) {
+
+	readVolumeBlock(_floatBlocks, xAffinities, "/volumes/xAffinities", roi);
+	readVolumeBlock(_floatBlocks, yAffinities, "/volumes/yAffinities", roi);
+	readVolumeBlock(_floatBlocks, zAffinities, "/volumes/zAffinities", roi);
+}
+
+void
+Hdf5VolumeStore::clearCaches() {
+
+	_floatBlocks.clear();
+	_intBlocks.clear();
+}
@@ -1,7 +1,9 @@
 #ifndef CANDIDATE_MC_IO_HDF5_VOLUME_STORE_H__
 #define CANDIDATE_MC_IO_HDF5_VOLUME_STORE_H__
 
+#include <mutex>
 #include "VolumeStore.h"
+#include "Hdf5BlockReader.h"
 #include "Hdf5VolumeReader.h"
 #include "Hdf5VolumeWriter.h"
 
@@ -9,12 +11,16 @@ class Hdf5VolumeStore : public VolumeStore, public Hdf5VolumeReader, public Hdf5
 
 public:
 
-	Hdf5VolumeStore(std::string projectFile) :
-		Hdf5VolumeReader(_hdfFile),
-		Hdf5VolumeWriter(_hdfFile),
-		_hdfFile(
-				projectFile,
-				vigra::HDF5File::OpenMode::ReadWrite) {}
+	/**
+	 * Create a volume store for the given project file. Regions of interest
+	 * are read through a cache of the most recently used chunks, its size is
+	 * set by the program option chunkCacheSize.
+	 *
+	 * The methods of a store can be called from several threads. This does 
+	 * not extend to other objects accessing HDF5 files at the same time, 
+	 * unless the HDF5 library was built thread-safe.
+	 */
+	Hdf5VolumeStore(std::string projectFile);
 
 	void saveIntensities(const ExplicitVolume<float>& intensities) override;
 
@@ -36,14 +42,71 @@ public:
 							ExplicitVolume<float>& yAffinities,
 							ExplicitVolume<float>& zAffinities) override;
 
+	void retrieveIntensities(
+			ExplicitVolume<float>&            intensities,
+			const util::box<unsigned int, 3>& roi) override;
+
+	void retrieveBoundaries(
+			ExplicitVolume<float>&            boundaries,
+			const util::box<unsigned int, 3>& roi) override;
+
+	void retrieveGroundTruth(
+			ExplicitVolume<int>&              groundTruth,
+			const util::box<unsigned int, 3>& roi) override;
+
+	void retrieveAffinities(
+			ExplicitVolume<float>&            xAffinities,
+			ExplicitVolume<float>&            yAffinities,
+			ExplicitVolume<float>&            zAffinities,
+			const util::box<unsigned int, 3>& roi) override;
+
 	void retrieveVolume(ExplicitVolume<int>& volume, std::string name) {
 
+		std::lock_guard<std::mutex> lock(_mutex);
+
 		readVolume(volume, std::string("/volumes/") + name);
 	}
 
 private:
 
+	template <typename ValueType>
+	void readVolumeBlock(
+			Hdf5BlockReader<ValueType>&       blocks,
+			ExplicitVolume<ValueType>&        volume,
+			std::string                       dataset,
+			const util::box<unsigned int, 3>& roi) {
+
+		// the meta data and the chunks are read from the same file
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		// resolution and offset of the whole volume
+		volume.setOffset(0, 0, 0);
+		readVolume(volume, dataset, true);
+
+		volume.data().reshape(
+				vigra::Shape3(
+						roi.max().x() - roi.min().x(),
+						roi.max().y() - roi.min().y(),
+						roi.max().z() - roi.min().z()));
+
+		blocks.read(dataset, roi, volume.data());
+
+		volume.setOffset(
+				volume.getOffset().x() + roi.min().x()*volume.getResolutionX(),
+				volume.getOffset().y() + roi.min().y()*volume.getResolutionY(),
+				volume.getOffset().z() + roi.min().z()*volume.getResolutionZ());
+	}
+
+	// chunks of the stored volumes need to be read again after saving
+	void clearCaches();
+
 	vigra::HDF5File _hdfFile;
+
+	Hdf5BlockReader<float> _floatBlocks;
+	Hdf5BlockReader<int>   _intBlocks;
+
+	// serializes all access to _hdfFile and the block readers
+	std::mutex _mutex;
 };
 
 #endif // CANDIDATE_MC_IO_HDF5_VOLUME_STORE_H__
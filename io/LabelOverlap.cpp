@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <util/exceptions.h>
+#include <crag/Parallel.h>
+#include "LabelOverlap.h"
+
+std::vector<LabelOverlap::Overlap>
+LabelOverlap::count(
+		const ExplicitVolume<int>& a,
+		const ExplicitVolume<int>& b) {
+
+	if (a.width() != b.width() || a.height() != b.height() || a.depth() != b.depth())
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"label volumes of different sizes can not be overlapped");
+
+	// blocks of rows (along x)
+	const std::size_t width        = a.width();
+	const std::size_t numRows      = a.height()*a.depth();
+	const std::size_t numBlocks    = std::min(numRows, static_cast<std::size_t>(4*numThreads()));
+	const std::size_t rowsPerBlock = (numBlocks == 0 ? 0 : (numRows + numBlocks - 1)/numBlocks);
+
+	const int* dataA = a.data().data();
+	const int* dataB = b.data().data();
+
+	std::vector<PairCounts> blockCounts(numBlocks);
+
+	parallelFor(numBlocks, [&](std::size_t block) {
+
+		PairCounts& counts = blockCounts[block];
+
+		std::size_t begin = block*rowsPerBlock*width;
+		std::size_t end   = std::min(numRows, (block + 1)*rowsPerBlock)*width;
+
+		// runs of equal pairs are counted before they are added
+		uint64_t    current = 0;
+		std::size_t run     = 0;
+
+		for (std::size_t i = begin; i < end; i++) {
+
+			if (dataB[i] == 0)
+				continue;
+
+			uint64_t key = pack(dataA[i], dataB[i]);
+
+			if (run > 0 && key != current) {
+
+				counts.add(current, run);
+				run = 0;
+			}
+
+			current = key;
+			run++;
+		}
+
+		if (run > 0)
+			counts.add(current, run);
+	});
+
+	// reduce pairwise, in parallel
+	for (std::size_t step = 1; step < numBlocks; step *= 2)
+		parallelFor((numBlocks + 2*step - 1)/(2*step), [&](std::size_t i) {
+
+			std::size_t target = 2*step*i;
+			if (target + step < numBlocks)
+				blockCounts[target].add(blockCounts[target + step]);
+		});
+
+	std::vector<std::pair<uint64_t, std::size_t>> counts;
+	if (numBlocks > 0)
+		blockCounts[0].getCounts(counts);
+
+	// sort by a, then b
+	std::sort(
+			counts.begin(),
+			counts.end(),
+			[](const std::pair<uint64_t, std::size_t>& x, const std::pair<uint64_t, std::size_t>& y) {
+
+				if (first(x.first) != first(y.first))
+					return first(x.first) < first(y.first);
+				return second(x.first) < second(y.first);
+			});
+
+	std::vector<Overlap> overlaps;
+	overlaps.reserve(counts.size());
+	for (const auto& p : counts) {
+
+		Overlap overlap;
+		overlap.a    = first(p.first);
+		overlap.b    = second(p.first);
+		overlap.size = p.second;
+		overlaps.push_back(overlap);
+	}
+
+	return overlaps;
+}
+
+void
+LabelOverlap::PairCounts::add(const PairCounts& other) {
+
+	for (std::size_t i = 0; i < other._keys.size(); i++)
+		if (other._counts[i] != 0)
+			add(other._keys[i], other._counts[i]);
+}
+
+void
+LabelOverlap::PairCounts::getCounts(std::vector<std::pair<uint64_t, std::size_t>>& counts) const {
+
+	counts.reserve(counts.size() + _size);
+
+	for (std::size_t i = 0; i < _keys.size(); i++)
+		if (_counts[i] != 0)
+			counts.push_back(std::make_pair(_keys[i], _counts[i]));
+}
+
+void
+LabelOverlap::PairCounts::resize(std::size_t capacity) {
+
+	std::vector<uint64_t>    keys;
+	std::vector<std::size_t> counts;
+	keys.swap(_keys);
+	counts.swap(_counts);
+
+	_keys.assign(capacity, 0);
+	_counts.assign(capacity, 0);
+	_mask = capacity - 1;
+	_size = 0;
+
+	for (std::size_t i = 0; i < keys.size(); i++)
+		if (counts[i] != 0)
+			add(keys[i], counts[i]);
+}
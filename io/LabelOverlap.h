@@ -0,0 +1,108 @@
+#ifndef CANDIDATE_MC_IO_LABEL_OVERLAP_H__
+#define CANDIDATE_MC_IO_LABEL_OVERLAP_H__
+
+#include <cstdint>
+#include <vector>
+#include <imageprocessing/ExplicitVolume.h>
+
+/**
+ * Counts the number of voxels shared by pairs of labels of two label volumes
+ * of the same size.
+ */
+class LabelOverlap {
+
+public:
+
+	struct Overlap {
+
+		int         a;
+		int         b;
+		std::size_t size;
+	};
+
+	/**
+	 * Get the overlap of each pair of labels (a, b) with at least one shared
+	 * voxel, sorted by a and then b. Voxels with label 0 in b are ignored.
+	 *
+	 * The volumes are counted in blocks in parallel, using one open-addressing
+	 * hash table of label pairs per block.
+	 */
+	static std::vector<Overlap> count(
+			const ExplicitVolume<int>& a,
+			const ExplicitVolume<int>& b);
+
+private:
+
+	/**
+	 * A hash table of counts for pairs of labels, packed into 64-bit keys.
+	 */
+	class PairCounts {
+
+	public:
+
+		PairCounts() : _size(0) { resize(1024); }
+
+		/**
+		 * Add n to the count of the given key.
+		 */
+		void add(uint64_t key, std::size_t n) {
+
+			std::size_t i = hash(key) & _mask;
+
+			// slots with a count of zero are empty
+			while (_counts[i] != 0 && _keys[i] != key)
+				i = (i + 1) & _mask;
+
+			if (_counts[i] == 0) {
+
+				_keys[i] = key;
+				_size++;
+			}
+
+			_counts[i] += n;
+
+			if (2*_size > _keys.size())
+				resize(2*_keys.size());
+		}
+
+		/**
+		 * Add all counts of another table.
+		 */
+		void add(const PairCounts& other);
+
+		/**
+		 * Append the key and count of all non-empty slots.
+		 */
+		void getCounts(std::vector<std::pair<uint64_t, std::size_t>>& counts) const;
+
+	private:
+
+		static uint64_t hash(uint64_t key) {
+
+			key ^= key >> 33;
+			key *= 0xff51afd7ed558ccdULL;
+			key ^= key >> 33;
+			key *= 0xc4ceb9fe1a85ec53ULL;
+			key ^= key >> 33;
+			return key;
+		}
+
+		void resize(std::size_t capacity);
+
+		std::vector<uint64_t>    _keys;
+		std::vector<std::size_t> _counts;
+
+		std::size_t _size;
+		std::size_t _mask;
+	};
+
+	static uint64_t pack(int a, int b) {
+
+		return (static_cast<uint64_t>(static_cast<uint32_t>(a)) << 32) | static_cast<uint32_t>(b);
+	}
+
+	static int first(uint64_t key)  { return static_cast<int>(static_cast<uint32_t>(key >> 32)); }
+	static int second(uint64_t key) { return static_cast<int>(static_cast<uint32_t>(key)); }
+};
+
+#endif // CANDIDATE_MC_IO_LABEL_OVERLAP_H__
@@ -0,0 +1,112 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include <util/Logger.h>
+#include "MergeHistory.h"
+
+logger::LogChannel mergehistorylog("mergehistorylog", "[MergeHistory] ");
+
+MergeHistory::MergeHistory(std::string filename, bool withScores) :
+	_hasScores(withScores) {
+
+	if (isBinary(filename)) {
+
+		LOG_DEBUG(mergehistorylog) << "reading binary merge history " << filename << std::endl;
+
+		_file.reset(new BinarySectionFile(filename));
+
+		_merges = _file->read<int32_t>("merge_history/merges");
+		_scores = _file->read<float>("merge_history/scores");
+
+		if (_merges.cols() != 3 || _scores.size() != _merges.rows())
+			UTIL_THROW_EXCEPTION(
+					IOError,
+					filename << " is not a valid merge history");
+
+		_hasScores = true;
+
+	} else {
+
+		readText(filename, withScores);
+	}
+}
+
+MergeHistory::MergeHistory(std::vector<int32_t> merges, std::vector<float> scores) :
+	_textMerges(std::move(merges)),
+	_textScores(std::move(scores)),
+	_hasScores(true) {
+
+	if (_textMerges.size() != 3*_textScores.size())
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"expected three ids and one score per merge");
+
+	_merges = BinarySectionFile::View<int32_t>(_textMerges.data(), _textMerges.size(), 3);
+	_scores = BinarySectionFile::View<float>(_textScores.data(), _textScores.size(), 1);
+}
+
+void
+MergeHistory::write(
+		std::string                 filename,
+		const std::vector<int32_t>& merges,
+		const std::vector<float>&   scores) {
+
+	if (merges.size() != 3*scores.size())
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"expected three ids and one score per merge");
+
+	// section files are appended to, start from scratch
+	std::remove(filename.c_str());
+
+	BinarySectionFile file(filename);
+	file.write("merge_history/merges", merges, 3);
+	file.write("merge_history/scores", scores);
+}
+
+bool
+MergeHistory::isBinary(std::string filename) {
+
+	std::ifstream file(filename.c_str(), std::ios::binary);
+
+	char magic[8];
+	if (!file.read(magic, sizeof(magic)))
+		return false;
+
+	return std::memcmp(magic, "CMCSECT", sizeof(magic)) == 0;
+}
+
+void
+MergeHistory::readText(std::string filename, bool withScores) {
+
+	std::ifstream file(filename.c_str());
+	if (file.fail())
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"could not read merge history " << filename);
+
+	while (true) {
+
+		int a, b, c;
+		file >> a;
+		file >> b;
+		file >> c;
+		float score = 0;
+		if (withScores)
+			file >> score;
+
+		if (!file.good())
+			break;
+
+		_textMerges.push_back(a);
+		_textMerges.push_back(b);
+		_textMerges.push_back(c);
+
+		if (withScores)
+			_textScores.push_back(score);
+	}
+
+	_merges = BinarySectionFile::View<int32_t>(_textMerges.data(), _textMerges.size(), 3);
+	_scores = BinarySectionFile::View<float>(_textScores.data(), _textScores.size(), 1);
+}
@@ -0,0 +1,84 @@
+#ifndef CANDIDATE_MC_IO_MERGE_HISTORY_H__
+#define CANDIDATE_MC_IO_MERGE_HISTORY_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "BinarySectionFile.h"
+
+/**
+ * A merge history, i.e., a list of merges of two candidates a and b into a
+ * new candidate c, each with an optional score.
+ *
+ * Merge histories are read either from text files with rows "a b c" (or
+ * "a b c score"), or from binary files written by write(). Binary files store
+ * the merges as fixed-width records in a BinarySectionFile and are read
+ * through a memory map without parsing.
+ */
+class MergeHistory {
+
+public:
+
+	/**
+	 * Open a merge history file. For text files, withScores indicates that
+	 * each row contains a score. Binary files always contain scores.
+	 */
+	MergeHistory(std::string filename, bool withScores = false);
+
+	/**
+	 * Create a merge history from merges and scores in memory, e.g., as 
+	 * provided by IterativeRegionMerging::getMergeHistory(). merges contains 
+	 * three ids (a, b, c) per merge, scores one value per merge.
+	 */
+	MergeHistory(std::vector<int32_t> merges, std::vector<float> scores);
+
+	/**
+	 * Write a binary merge history. merges contains three ids (a, b, c) per
+	 * merge, scores one value per merge.
+	 */
+	static void write(
+			std::string                 filename,
+			const std::vector<int32_t>& merges,
+			const std::vector<float>&   scores);
+
+	/**
+	 * Check whether the given file is a binary merge history.
+	 */
+	static bool isBinary(std::string filename);
+
+	/**
+	 * The number of merges.
+	 */
+	std::size_t size() const { return _merges.rows(); }
+
+	/**
+	 * The ids of the merged candidates and the new candidate of merge i.
+	 */
+	int a(std::size_t i) const { return _merges.row(i)[0]; }
+	int b(std::size_t i) const { return _merges.row(i)[1]; }
+	int c(std::size_t i) const { return _merges.row(i)[2]; }
+
+	/**
+	 * The score of merge i, 0 if the history does not contain scores.
+	 */
+	float score(std::size_t i) const { return (_hasScores ? _scores[i] : 0); }
+
+	bool hasScores() const { return _hasScores; }
+
+private:
+
+	void readText(std::string filename, bool withScores);
+
+	std::unique_ptr<BinarySectionFile> _file;
+
+	// merges and scores read from a text file or given in memory
+	std::vector<int32_t> _textMerges;
+	std::vector<float>   _textScores;
+
+	BinarySectionFile::View<int32_t> _merges;
+	BinarySectionFile::View<float>   _scores;
+
+	bool _hasScores;
+};
+
+#endif // CANDIDATE_MC_IO_MERGE_HISTORY_H__
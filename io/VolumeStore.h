@@ -2,6 +2,7 @@
 #define CANDIDATE_MC_IO_VOLUME_STORE_H__
 
 #include <imageprocessing/ExplicitVolume.h>
+#include <util/box.hpp>
 
 /**
  * Interface definition for volume stores.
@@ -54,6 +55,37 @@ public:
 									ExplicitVolume<float>& yAffinities,
 									ExplicitVolume<float>& zAffinities) = 0;
 
+	/**
+	 * Get the part of the intensity volume within roi (in voxels). The offset
+	 * of the returned volume is the position of roi.
+	 */
+	virtual void retrieveIntensities(
+			ExplicitVolume<float>&            intensities,
+			const util::box<unsigned int, 3>& roi) = 0;
+
+	/**
+	 * Get the part of the boundary prediction volume within roi (in voxels).
+	 */
+	virtual void retrieveBoundaries(
+			ExplicitVolume<float>&            boundaries,
+			const util::box<unsigned int, 3>& roi) = 0;
+
+	/**
+	 * Get the part of the ground-truth label volume within roi (in voxels).
+	 */
+	virtual void retrieveGroundTruth(
+			ExplicitVolume<int>&              groundTruth,
+			const util::box<unsigned int, 3>& roi) = 0;
+
+	/**
+	 * Get the parts of the affinities volumes within roi (in voxels).
+	 */
+	virtual void retrieveAffinities(
+			ExplicitVolume<float>&            xAffinities,
+			ExplicitVolume<float>&            yAffinities,
+			ExplicitVolume<float>&            zAffinities,
+			const util::box<unsigned int, 3>& roi) = 0;
+
 	/**
 	 * Get a volume by its name.
 	 */
@@ -1,3 +1,4 @@
+#include <crag/CragHierarchyIndex.h>
 #include <inference/CragSolverFactory.h>
 #include <util/ProgramOptions.h>
 #include <util/Logger.h>
@@ -100,7 +101,12 @@ BestEffort::getGroundTruthOverlaps(
 		const ExplicitVolume<int>&         groundTruth,
 		Crag::NodeMap<std::map<int, int>>& overlaps) {
 
-	for (Crag::CragNode n : crag.nodes()) {
+	const CragHierarchyIndex& index = crag.getHierarchyIndex();
+
+	// bottom-up, such that volumes can be materialized from their children
+	for (std::size_t r = 0; r < index.numNodes(); r++) {
+
+		Crag::CragNode n = index.nodeAtRank(r);
 
 		if (crag.type(n) == Crag::NoAssignmentNode)
 			continue;
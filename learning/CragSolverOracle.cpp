@@ -172,7 +172,7 @@ CragSolverOracle::accumulateGradient(FeatureWeights& gradient) {
 
 		int sign = _bestEffort.selected(n) - _mostViolatedSolution.selected(n);
 
-		const std::vector<double>& f = _nodeFeatures[n];
+		FeatureRow                 f = _nodeFeatures[n];
 		std::vector<double>&       g = gradient[_crag.type(n)];
 		for (unsigned int i = 0; i < f.size(); i++)
 			g[i] += f[i]*sign;
@@ -182,7 +182,7 @@ CragSolverOracle::accumulateGradient(FeatureWeights& gradient) {
 
 		int sign = _bestEffort.selected(e) - _mostViolatedSolution.selected(e);
 
-		const std::vector<double>& f = _edgeFeatures[e];
+		FeatureRow                 f = _edgeFeatures[e];
 		std::vector<double>&       g = gradient[_crag.type(e)];
 		for (unsigned int i = 0; i < f.size(); i++)
 			g[i] += f[i]*sign;
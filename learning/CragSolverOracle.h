@@ -59,7 +59,7 @@ private:
 		return dot(weights[_crag.type(e)], _edgeFeatures[e]);
 	}
 
-	inline double dot(const std::vector<double>& a, const std::vector<double>& b) const {
+	inline double dot(const std::vector<double>& a, const FeatureRow& b) const {
 
 		UTIL_ASSERT_REL(a.size(), ==, b.size());
 
@@ -57,11 +57,30 @@ public:
 
 	void storeMergeHistory(std::string filename);
 
+	/**
+	 * Get the merge history as the ids of the two merged regions and the new
+	 * region (three entries per merge), and the score of each merge.
+	 */
+	void getMergeHistory(std::vector<int>& merges, std::vector<float>& scores);
+
 	/**
 	 * Get the region adjacency graph.
 	 */
 	RagType& getRag() { return _rag; }
 
+	/**
+	 * Get the grid graph on which the initial regions are defined.
+	 */
+	const GridGraphType& getGridGraph() const { return _grid; }
+
+	/**
+	 * Get the grid edges between the two regions connected by the given RAG 
+	 * edge. For edges between initial regions, they are only available before 
+	 * calling createMergeTree(), since merging moves them to the edges of the 
+	 * merged regions.
+	 */
+	const std::vector<typename GridGraphType::Edge>& getGridEdges(RagType::Edge edge) { return _ragToGridEdges[edge]; }
+
 private:
 
 	typedef util::cont_map<RagType::Edge, std::vector<typename GridGraphType::Edge>, EdgeNumConverter<RagType> > GridEdgesType;
@@ -240,6 +259,24 @@ IterativeRegionMerging<D>::storeMergeHistory(std::string filename) {
 	}
 }
 
+template <int D>
+void
+IterativeRegionMerging<D>::getMergeHistory(std::vector<int>& merges, std::vector<float>& scores) {
+
+	merges.clear();
+	scores.clear();
+	merges.reserve(3*_mergeHistory.size());
+	scores.reserve(_mergeHistory.size());
+
+	for (const Merge& m : _mergeHistory) {
+
+		merges.push_back(_rag.id(m.u));
+		merges.push_back(_rag.id(m.v));
+		merges.push_back(_rag.id(m.parent));
+		scores.push_back(m.score);
+	}
+}
+
 template <int D>
 template <typename ScoringFunction>
 IterativeRegionMerging<D>::RagType::Node
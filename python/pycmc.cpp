@@ -36,6 +36,12 @@ void featuresSetter(Map& map, const K& k, const V& value) {
 	map.set(k, list_to_vec<D>(value));
 }
 
+template <typename Map, typename K>
+std::vector<double> featuresGetter(const Map& map, const K& k) {
+	FeatureRow f = map[k];
+	return std::vector<double>(f.begin(), f.end());
+}
+
 template <typename Map, typename K, typename V, typename D>
 void weightSetter(Map& map, const K& k, const V& value) { 
 	map[k] = list_to_vec<D>(value);
@@ -402,8 +408,7 @@ BOOST_PYTHON_MODULE(pycmc) {
 
 	// NodeFeatures
 	boost::python::class_<NodeFeatures>("NodeFeatures", boost::python::init<const Crag&>())
-			.def("__getitem__", &genericGetter<NodeFeatures, Crag::CragNode, std::vector<double>>,
-					boost::python::return_internal_reference<>())
+			.def("__getitem__", &featuresGetter<NodeFeatures, Crag::CragNode>)
 			.def("__setitem__", &featuresSetter<NodeFeatures, Crag::CragNode, boost::python::list, double>)
 			.def("dims", &NodeFeatures::dims)
 			.def("append", &NodeFeatures::append)
@@ -411,8 +416,7 @@ BOOST_PYTHON_MODULE(pycmc) {
 
 	// EdgeFeatures
 	boost::python::class_<EdgeFeatures>("EdgeFeatures", boost::python::init<const Crag&>())
-			.def("__getitem__", &genericGetter<EdgeFeatures, Crag::CragEdge, std::vector<double>>,
-					boost::python::return_internal_reference<>())
+			.def("__getitem__", &featuresGetter<EdgeFeatures, Crag::CragEdge>)
 			.def("__setitem__", &featuresSetter<EdgeFeatures, Crag::CragEdge, boost::python::list, double>)
 			.def("dims", &EdgeFeatures::dims)
 			.def("append", &EdgeFeatures::append)
@@ -446,7 +450,7 @@ BOOST_PYTHON_MODULE(pycmc) {
 	// CRAG store
 	boost::python::class_<Hdf5CragStore, boost::noncopyable>("Hdf5CragStore", boost::python::init<std::string>())
 			.def("saveCrag", &Hdf5CragStore::saveCrag)
-			.def("saveVolumes", &Hdf5CragStore::saveVolumes)
+			.def("saveVolumes", static_cast<void(Hdf5CragStore::*)(const CragVolumes&)>(&Hdf5CragStore::saveVolumes))
 			.def("saveNodeFeatures", &Hdf5CragStore::saveNodeFeatures)
 			.def("saveEdgeFeatures", &Hdf5CragStore::saveEdgeFeatures)
 			//.def("saveSkeletons", &Hdf5CragStore::saveSkeletons)
@@ -473,9 +477,9 @@ BOOST_PYTHON_MODULE(pycmc) {
 			.def("saveIntensities", &Hdf5VolumeStore::saveIntensities)
 			.def("saveBoundaries", &Hdf5VolumeStore::saveBoundaries)
 			.def("saveGroundTruth", &Hdf5VolumeStore::saveGroundTruth)
-			.def("retrieveIntensities", &Hdf5VolumeStore::retrieveIntensities)
-			.def("retrieveBoundaries", &Hdf5VolumeStore::retrieveBoundaries)
-			.def("retrieveGroundTruth", &Hdf5VolumeStore::retrieveGroundTruth)
+			.def("retrieveIntensities", static_cast<void(Hdf5VolumeStore::*)(ExplicitVolume<float>&)>(&Hdf5VolumeStore::retrieveIntensities))
+			.def("retrieveBoundaries", static_cast<void(Hdf5VolumeStore::*)(ExplicitVolume<float>&)>(&Hdf5VolumeStore::retrieveBoundaries))
+			.def("retrieveGroundTruth", static_cast<void(Hdf5VolumeStore::*)(ExplicitVolume<int>&)>(&Hdf5VolumeStore::retrieveGroundTruth))
 			;
 
 	// RandomForest